@@ -0,0 +1,121 @@
+#include"AllocationCounter.h"
+#include<atomic>
+#include<cstdlib>
+#include<new>
+
+// Replaces the global operator new/delete so every allocation of the program goes through a counter.
+// The counters are plain integers and atomics, counting can't allocate itself
+static std::atomic<uint64_t> totalAllocations(0);
+static std::atomic<uint64_t> totalBytes(0);
+static thread_local uint64_t threadAllocations = 0;
+
+uint64_t AllocationCounter::Total()
+{
+	return totalAllocations.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::TotalBytes()
+{
+	return totalBytes.load(std::memory_order_relaxed);
+}
+
+uint64_t AllocationCounter::ThisThread()
+{
+	return threadAllocations;
+}
+
+static void* countedAlloc(size_t size)
+{
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+	threadAllocations++;
+	return std::malloc(size ? size : 1);
+}
+
+static void* countedAlignedAlloc(size_t size, size_t alignment)
+{
+	totalAllocations.fetch_add(1, std::memory_order_relaxed);
+	totalBytes.fetch_add(size, std::memory_order_relaxed);
+	threadAllocations++;
+	size = size ? size : 1;
+#ifdef _MSC_VER
+	return _aligned_malloc(size, alignment);
+#else
+	// aligned_alloc wants a multiple of the alignment
+	return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+}
+
+static void alignedFree(void* memory)
+{
+#ifdef _MSC_VER
+	_aligned_free(memory);
+#else
+	std::free(memory);
+#endif
+}
+
+void* operator new(size_t size)
+{
+	void* memory = countedAlloc(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size)
+{
+	void* memory = countedAlloc(size);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+	return countedAlloc(size);
+}
+
+void* operator new(size_t size, std::align_val_t alignment)
+{
+	void* memory = countedAlignedAlloc(size, (size_t)alignment);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new[](size_t size, std::align_val_t alignment)
+{
+	void* memory = countedAlignedAlloc(size, (size_t)alignment);
+	if (!memory)
+		throw std::bad_alloc();
+	return memory;
+}
+
+void* operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAlignedAlloc(size, (size_t)alignment);
+}
+
+void* operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept
+{
+	return countedAlignedAlloc(size, (size_t)alignment);
+}
+
+void operator delete(void* memory) noexcept { std::free(memory); }
+void operator delete[](void* memory) noexcept { std::free(memory); }
+void operator delete(void* memory, size_t) noexcept { std::free(memory); }
+void operator delete[](void* memory, size_t) noexcept { std::free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { std::free(memory); }
+void operator delete(void* memory, std::align_val_t) noexcept { alignedFree(memory); }
+void operator delete[](void* memory, std::align_val_t) noexcept { alignedFree(memory); }
+void operator delete(void* memory, size_t, std::align_val_t) noexcept { alignedFree(memory); }
+void operator delete[](void* memory, size_t, std::align_val_t) noexcept { alignedFree(memory); }
+void operator delete(void* memory, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(memory); }
+void operator delete[](void* memory, std::align_val_t, const std::nothrow_t&) noexcept { alignedFree(memory); }
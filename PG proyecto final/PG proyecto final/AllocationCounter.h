@@ -0,0 +1,17 @@
+#ifndef ALLOCATION_COUNTER_CLASS_H
+#define ALLOCATION_COUNTER_CLASS_H
+
+#include<cstddef>
+#include<cstdint>
+
+// Heap allocations made through operator new, counted by the replacement operators in AllocationCounter.cpp
+class AllocationCounter
+{
+public:
+	// Allocations (and bytes requested) by every thread since the program started
+	static uint64_t Total();
+	static uint64_t TotalBytes();
+	// Allocations by the calling thread, the difference between two calls is what ran in between
+	static uint64_t ThisThread();
+};
+#endif
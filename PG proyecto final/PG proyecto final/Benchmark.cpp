@@ -0,0 +1,251 @@
+#include"Benchmark.h"
+#include<algorithm>
+#include<cmath>
+#include<fstream>
+#include<iostream>
+#include<sstream>
+
+// Loads "time px py pz tx ty tz" lines, '#' starts a comment
+bool CameraPath::Load(const std::string& file)
+{
+	std::ifstream in(file);
+	if (!in)
+	{
+		std::cerr << "ERROR: Failed to open camera path " << file << std::endl;
+		return false;
+	}
+
+	keys.clear();
+	std::string line;
+	while (std::getline(in, line))
+	{
+		line = line.substr(0, line.find('#'));
+		std::istringstream values(line);
+		CameraKey key;
+		if (values >> key.time >> key.position.x >> key.position.y >> key.position.z >> key.target.x >> key.target.y >> key.target.z)
+			keys.push_back(key);
+	}
+	std::sort(keys.begin(), keys.end(), [](const CameraKey& a, const CameraKey& b) { return a.time < b.time; });
+
+	if (keys.empty())
+	{
+		std::cerr << "ERROR: Camera path " << file << " has no keys" << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Walk past every exhibit of the gallery, used when no path file is given
+CameraPath CameraPath::Default()
+{
+	CameraPath path;
+	path.keys = {
+		{ 0.0f, glm::vec3(0.0f, 2.5f, 48.0f), glm::vec3(0.32f, 3.5f, 32.9f) },      // David
+		{ 4.0f, glm::vec3(0.0f, 2.5f, 40.0f), glm::vec3(0.32f, 3.5f, 32.9f) },
+		{ 8.0f, glm::vec3(-8.0f, 2.5f, 38.0f), glm::vec3(-17.0f, 2.6f, 45.7f) },    // Torso
+		{ 12.0f, glm::vec3(-10.0f, 2.5f, 26.0f), glm::vec3(-13.9f, 2.3f, 18.5f) },  // Pieta
+		{ 16.0f, glm::vec3(-3.0f, 2.5f, 21.0f), glm::vec3(-5.3f, 2.5f, 15.5f) },    // Mona Lisa
+		{ 20.0f, glm::vec3(3.0f, 2.5f, 21.0f), glm::vec3(6.8f, 2.5f, 15.5f) },      // Starry night
+		{ 24.0f, glm::vec3(10.0f, 2.5f, 24.0f), glm::vec3(16.5f, 3.6f, 16.5f) },    // Athena
+		{ 28.0f, glm::vec3(10.0f, 2.5f, 40.0f), glm::vec3(14.8f, 3.8f, 49.6f) },    // Doryphoros
+		{ 32.0f, glm::vec3(4.0f, 2.5f, 44.0f), glm::vec3(8.5f, 2.2f, 49.9f) },      // Aphrodite
+		{ 36.0f, glm::vec3(-4.0f, 2.5f, 44.0f), glm::vec3(-8.5f, 1.7f, 50.3f) },    // Moses
+		{ 40.0f, glm::vec3(0.0f, 2.5f, 48.0f), glm::vec3(0.32f, 3.5f, 32.9f) },
+	};
+	return path;
+}
+
+float CameraPath::Duration() const
+{
+	return keys.empty() ? 0.0f : keys.back().time - keys.front().time;
+}
+
+static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+{
+	float t2 = t * t;
+	float t3 = t2 * t;
+	return 0.5f * (2.0f * p1 + (p2 - p0) * t + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * t2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * t3);
+}
+
+// Camera position and viewing direction at the given time
+void CameraPath::Evaluate(float time, glm::vec3& position, glm::vec3& orientation) const
+{
+	if (keys.size() < 2)
+	{
+		position = keys.empty() ? glm::vec3(0.0f) : keys[0].position;
+		orientation = keys.empty() ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::normalize(keys[0].target - keys[0].position);
+		return;
+	}
+
+	time = std::min(std::max(time, keys.front().time), keys.back().time);
+	size_t i = 1;
+	while (i < keys.size() - 1 && keys[i].time < time)
+		i++;
+
+	// Segment keys[i - 1] -> keys[i], the end keys are repeated to close the spline
+	const CameraKey& k0 = keys[i >= 2 ? i - 2 : 0];
+	const CameraKey& k1 = keys[i - 1];
+	const CameraKey& k2 = keys[i];
+	const CameraKey& k3 = keys[std::min(i + 1, keys.size() - 1)];
+	float length = k2.time - k1.time;
+	float t = length > 0.0f ? (time - k1.time) / length : 0.0f;
+
+	position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+	glm::vec3 target = catmullRom(k0.target, k1.target, k2.target, k3.target, t);
+	glm::vec3 direction = target - position;
+	orientation = glm::length(direction) > 0.0001f ? glm::normalize(direction) : glm::vec3(0.0f, 0.0f, -1.0f);
+}
+
+// Creates the framebuffer, color is sRGB like the window's back buffer
+OffscreenTarget::OffscreenTarget(int width, int height)
+	: width(width), height(height)
+{
+	glGenFramebuffers(1, &ID);
+	glBindFramebuffer(GL_FRAMEBUFFER, ID);
+
+	glGenRenderbuffers(1, &color);
+	glBindRenderbuffer(GL_RENDERBUFFER, color);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_SRGB8_ALPHA8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depth);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		std::cerr << "ERROR: Offscreen framebuffer is incomplete" << std::endl;
+
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenTarget::Bind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, ID);
+	glViewport(0, 0, width, height);
+}
+
+void OffscreenTarget::Unbind()
+{
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+}
+
+void OffscreenTarget::Delete()
+{
+	glDeleteRenderbuffers(1, &color);
+	glDeleteRenderbuffers(1, &depth);
+	glDeleteFramebuffers(1, &ID);
+}
+
+FrameStats FrameStats::Of(std::vector<double> samples)
+{
+	FrameStats stats;
+	samples.erase(std::remove_if(samples.begin(), samples.end(), [](double s) { return std::isnan(s); }), samples.end());
+	if (samples.empty())
+		return stats;
+
+	std::sort(samples.begin(), samples.end());
+	double sum = 0.0;
+	for (double sample : samples)
+		sum += sample;
+
+	// Nearest rank percentiles
+	auto percentile = [&](double p)
+	{
+		size_t rank = (size_t)std::ceil(p / 100.0 * samples.size());
+		return samples[std::min(std::max(rank, (size_t)1), samples.size()) - 1];
+	};
+	stats.mean = sum / samples.size();
+	stats.p50 = percentile(50.0);
+	stats.p95 = percentile(95.0);
+	stats.p99 = percentile(99.0);
+	stats.min = samples.front();
+	stats.max = samples.back();
+	return stats;
+}
+
+nlohmann::ordered_json FrameStats::ToJson() const
+{
+	nlohmann::ordered_json out;
+	out["mean"] = mean;
+	out["p50"] = p50;
+	out["p95"] = p95;
+	out["p99"] = p99;
+	out["min"] = min;
+	out["max"] = max;
+	return out;
+}
+
+FrameTimer::FrameTimer(unsigned int latency)
+	: queries(std::max(latency, 1u)), queryFrames(std::max(latency, 1u), -1)
+{
+	glGenQueries((GLsizei)queries.size(), queries.data());
+}
+
+void FrameTimer::BeginFrame()
+{
+	// The oldest query is reused, so its result (normally ready by now) is read first
+	if (queryFrames[next] >= 0)
+		collect(next);
+
+	frameStart = Clock::now();
+	if (!firstFrame)
+		frameMs.push_back(std::chrono::duration<double, std::milli>(frameStart - lastFrameStart).count());
+	lastFrameStart = frameStart;
+	firstFrame = false;
+
+	glBeginQuery(GL_TIME_ELAPSED, queries[next]);
+}
+
+void FrameTimer::EndFrame()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+	cpuMs.push_back(std::chrono::duration<double, std::milli>(Clock::now() - frameStart).count());
+	gpuMs.push_back(std::nan(""));
+	queryFrames[next] = (int)cpuMs.size() - 1;
+	next = (next + 1) % queries.size();
+}
+
+// Waits for the queries still in flight
+void FrameTimer::Finish()
+{
+	for (unsigned int i = 0; i < queries.size(); i++)
+	{
+		if (queryFrames[i] >= 0)
+			collect(i);
+	}
+}
+
+void FrameTimer::Delete()
+{
+	glDeleteQueries((GLsizei)queries.size(), queries.data());
+}
+
+nlohmann::ordered_json FrameTimer::Report() const
+{
+	nlohmann::ordered_json out;
+	out["frames"] = cpuMs.size();
+	out["cpu_ms"] = FrameStats::Of(cpuMs).ToJson();
+	out["gpu_ms"] = FrameStats::Of(gpuMs).ToJson();
+	out["frame_ms"] = FrameStats::Of(frameMs).ToJson();
+
+	nlohmann::ordered_json frames = nlohmann::ordered_json::array();
+	for (size_t i = 0; i < cpuMs.size(); i++)
+	{
+		nlohmann::ordered_json frame;
+		frame["cpu"] = cpuMs[i];
+		frame["gpu"] = std::isnan(gpuMs[i]) ? nlohmann::ordered_json() : nlohmann::ordered_json(gpuMs[i]);
+		frames.push_back(frame);
+	}
+	out["per_frame"] = frames;
+	return out;
+}
+
+void FrameTimer::collect(unsigned int slot)
+{
+	GLuint64 elapsed = 0;
+	glGetQueryObjectui64v(queries[slot], GL_QUERY_RESULT, &elapsed);
+	gpuMs[queryFrames[slot]] = elapsed / 1000000.0;
+	queryFrames[slot] = -1;
+}
@@ -0,0 +1,103 @@
+#ifndef BENCHMARK_CLASS_H
+#define BENCHMARK_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<json/json.h>
+#include<chrono>
+#include<string>
+#include<vector>
+
+// One point of a scripted camera path: where the camera is and what it looks at
+struct CameraKey
+{
+	float time;
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+// Camera path flown by the benchmark, keys are joined with Catmull-Rom splines
+class CameraPath
+{
+public:
+	std::vector<CameraKey> keys;
+
+	// Loads "time px py pz tx ty tz" lines, '#' starts a comment
+	bool Load(const std::string& file);
+	// Walk past every exhibit of the gallery, used when no path file is given
+	static CameraPath Default();
+
+	float Duration() const;
+	// Camera position and viewing direction at the given time
+	void Evaluate(float time, glm::vec3& position, glm::vec3& orientation) const;
+};
+
+// Color + depth framebuffer so frames can be rendered without a visible window
+class OffscreenTarget
+{
+public:
+	GLuint ID = 0;
+	int width;
+	int height;
+
+	// Creates the framebuffer, color is sRGB like the window's back buffer
+	OffscreenTarget(int width, int height);
+
+	void Bind();
+	void Unbind();
+	void Delete();
+
+private:
+	GLuint color = 0;
+	GLuint depth = 0;
+};
+
+// Mean and percentiles of a set of frame times, in milliseconds
+struct FrameStats
+{
+	double mean = 0.0;
+	double p50 = 0.0;
+	double p95 = 0.0;
+	double p99 = 0.0;
+	double min = 0.0;
+	double max = 0.0;
+
+	static FrameStats Of(std::vector<double> samples);
+	nlohmann::ordered_json ToJson() const;
+};
+
+// Measures the CPU and GPU time of every frame. GPU times come from GL_TIME_ELAPSED queries
+// that are read 'latency' frames later, so the CPU doesn't wait for the GPU to catch up
+class FrameTimer
+{
+public:
+	// Time spent by the CPU building each frame, GPU time of each frame and time between frame starts
+	std::vector<double> cpuMs;
+	std::vector<double> gpuMs;
+	std::vector<double> frameMs;
+
+	FrameTimer(unsigned int latency = 3);
+
+	void BeginFrame();
+	void EndFrame();
+	// Waits for the queries still in flight
+	void Finish();
+	void Delete();
+
+	// Stats of every recorded frame plus the frame times themselves
+	nlohmann::ordered_json Report() const;
+
+private:
+	typedef std::chrono::high_resolution_clock Clock;
+
+	std::vector<GLuint> queries;
+	// Frame each query is measuring, -1 if free
+	std::vector<int> queryFrames;
+	unsigned int next = 0;
+	Clock::time_point frameStart;
+	Clock::time_point lastFrameStart;
+	bool firstFrame = true;
+
+	void collect(unsigned int slot);
+};
+#endif
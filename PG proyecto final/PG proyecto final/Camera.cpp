@@ -2,6 +2,7 @@
 #include <glm/gtx/norm.hpp> 
 #include <vector>
 #include "AudioManager.h"
+#include "Profiler.h"
 
 extern void showModelInfo(const std::string& title, const std::string& description);
 extern void hideModelInfo();
@@ -41,6 +42,7 @@ void Camera::AddCollider(glm::vec3 position, float radius,
 
 // Checks if camera would collide with any object at given position
 bool Camera::IsColliding(glm::vec3 newPosition) {
+    PROFILE_SCOPE("Camera::IsColliding");
     const float EPSILON = 0.001f;  // Small buffer to prevent clipping
     bool collisionDetected = false;
 
@@ -108,7 +110,7 @@ void Camera::Matrix(Shader& shader, const char* uniform)
 }
 
 // Handles keyboard and mouse input for camera movement
-void Camera::Inputs(GLFWwindow* window)
+void Camera::Inputs(InputSystem& input)
 {
     float fixedHeight = 2.5f;  // Lock camera at this height (first-person perspective)
     glm::vec3 desiredPosition = Position;
@@ -123,19 +125,19 @@ void Camera::Inputs(GLFWwindow* window)
     bool moved = false;
 
     // Handle WASD movement keys
-    if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+    if (input.Key(GLFW_KEY_W)) {
         desiredPosition += speed * forward;
         moved = true;
     }
-    else if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+    else if (input.Key(GLFW_KEY_A)) {
         desiredPosition -= speed * right;
         moved = true;
     }
-    else if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+    else if (input.Key(GLFW_KEY_S)) {
         desiredPosition -= speed * forward;
         moved = true;
     }
-    else if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+    else if (input.Key(GLFW_KEY_D)) {
         desiredPosition += speed * right;
         moved = true;
     }
@@ -166,28 +168,28 @@ void Camera::Inputs(GLFWwindow* window)
     Position.y = fixedHeight;  // Maintain fixed height
 
     // Sprint functionality with shift key
-    if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_PRESS)
+    if (input.Key(GLFW_KEY_LEFT_SHIFT))
     {
         speed = 0.12f;
     }
-    else if (glfwGetKey(window, GLFW_KEY_LEFT_SHIFT) == GLFW_RELEASE)
+    else if (!input.Key(GLFW_KEY_LEFT_SHIFT))
     {
         speed = 0.06f;
     }
 
     // Mouse look control (activated with left mouse button)
-    if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_PRESS)
+    if (input.Button(GLFW_MOUSE_BUTTON_LEFT))
     {
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_HIDDEN);
+        input.SetCursorMode(GLFW_CURSOR_HIDDEN);
 
         if (firstClick)
         {
-            glfwSetCursorPos(window, (width / 2), (height / 2));
+            input.SetCursor(glm::vec2(width / 2, height / 2));
             firstClick = false;
         }
 
-        double mouseX, mouseY;
-        glfwGetCursorPos(window, &mouseX, &mouseY);
+        double mouseX = input.Cursor().x;
+        double mouseY = input.Cursor().y;
 
         // Calculate rotation amounts based on mouse movement
         float rotX = sensitivity * (float)(mouseY - (height / 2)) / height;
@@ -203,11 +205,11 @@ void Camera::Inputs(GLFWwindow* window)
         // Horizontal rotation (always allowed)
         Orientation = glm::rotate(Orientation, glm::radians(-rotY), Up);
 
-        glfwSetCursorPos(window, (width / 2), (height / 2));
+        input.SetCursor(glm::vec2(width / 2, height / 2));
     }
-    else if (glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT) == GLFW_RELEASE)
+    else if (!input.Button(GLFW_MOUSE_BUTTON_LEFT))
     {
-        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+        input.SetCursorMode(GLFW_CURSOR_NORMAL);
         firstClick = true;
     }
 }
\ No newline at end of file
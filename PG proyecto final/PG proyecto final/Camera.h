@@ -9,6 +9,7 @@
 #include<glm/gtx/rotate_vector.hpp>
 #include<glm/gtx/vector_angle.hpp>
 #include "AudioManager.h"
+#include"InputSystem.h"
 
 #include"shaderClass.h"
 
@@ -35,7 +36,7 @@ public:
 	int width;
 	int height;
 
-	// Adjust the speed of the camera and it's sensitivity when looking around
+	// Adjust the speed of the camera and it's sensitivity when looking around (speed is per 1/60 s simulation step)
 	float speed = 0.1f;
 	float sensitivity = 100.0f;
 	float nearPlane = 0.1f;
@@ -55,7 +56,7 @@ public:
 	void updateMatrix(float FOVdeg, float nearPlane, float farPlane);
 	// Exports the camera matrix to a shader
 	void Matrix(Shader& shader, const char* uniform);
-	// Handles camera inputs
-	void Inputs(GLFWwindow* window);
+	// Handles camera inputs (live or replayed)
+	void Inputs(InputSystem& input);
 };
 #endif
\ No newline at end of file
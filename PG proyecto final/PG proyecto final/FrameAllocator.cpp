@@ -0,0 +1,81 @@
+#include"FrameAllocator.h"
+#include<algorithm>
+#include<cstdarg>
+#include<cstdint>
+#include<cstdio>
+
+FrameAllocator::FrameAllocator(size_t blockBytes)
+	: blockBytes(blockBytes)
+{
+}
+
+FrameAllocator::~FrameAllocator()
+{
+	for (Block& block : blocks)
+		delete[] block.data;
+}
+
+void* FrameAllocator::Allocate(size_t bytes, size_t alignment)
+{
+	// Moves on to the next block (or adds one) when the current one can't fit the request
+	while (true)
+	{
+		if (current < blocks.size())
+		{
+			Block& block = blocks[current];
+			uintptr_t base = (uintptr_t)block.data;
+			size_t start = (size_t)(((base + offset + alignment - 1) & ~(uintptr_t)(alignment - 1)) - base);
+			if (start + bytes <= block.size)
+			{
+				offset = start + bytes;
+				used += bytes;
+				return block.data + start;
+			}
+			if (current + 1 < blocks.size())
+			{
+				current++;
+				offset = 0;
+				continue;
+			}
+		}
+
+		// Heap memory is aligned to max_align_t, bigger alignments get room to shift into
+		size_t size = std::max(blockBytes, bytes + alignment);
+		blocks.push_back(Block{ new char[size], size });
+		current = blocks.size() - 1;
+		offset = 0;
+	}
+}
+
+// printf into frame memory
+const char* FrameAllocator::Format(const char* format, ...)
+{
+	va_list args;
+	va_start(args, format);
+	va_list sizing;
+	va_copy(sizing, args);
+	int length = std::vsnprintf(nullptr, 0, format, sizing);
+	va_end(sizing);
+
+	char* text = Allocate<char>(length > 0 ? length + 1 : 1);
+	text[0] = '\0';
+	if (length > 0)
+		std::vsnprintf(text, length + 1, format, args);
+	va_end(args);
+	return text;
+}
+
+// Frees everything allocated since the last reset
+void FrameAllocator::Reset()
+{
+	current = 0;
+	offset = 0;
+	used = 0;
+}
+
+// Allocator of the main thread, reset at the end of every frame
+FrameAllocator& FrameAllocator::Frame()
+{
+	static FrameAllocator frame;
+	return frame;
+}
@@ -0,0 +1,44 @@
+#ifndef FRAME_ALLOCATOR_CLASS_H
+#define FRAME_ALLOCATOR_CLASS_H
+
+#include<cstddef>
+#include<vector>
+
+// Bump allocator for data that only lives until the end of the frame (formatted text, scratch arrays).
+// Reset() rewinds it but keeps its blocks, so once it has grown to a frame's needs it stops touching the heap
+class FrameAllocator
+{
+public:
+	FrameAllocator(size_t blockBytes = 64 * 1024);
+	~FrameAllocator();
+	FrameAllocator(const FrameAllocator&) = delete;
+	FrameAllocator& operator=(const FrameAllocator&) = delete;
+
+	void* Allocate(size_t bytes, size_t alignment = alignof(std::max_align_t));
+	template<typename T>
+	T* Allocate(size_t count) { return static_cast<T*>(Allocate(count * sizeof(T), alignof(T))); }
+	// printf into frame memory
+	const char* Format(const char* format, ...);
+
+	// Frees everything allocated since the last reset
+	void Reset();
+	// Bytes handed out since the last reset
+	size_t Used() const { return used; }
+
+	// Allocator of the main thread, reset at the end of every frame
+	static FrameAllocator& Frame();
+
+private:
+	struct Block
+	{
+		char* data;
+		size_t size;
+	};
+
+	std::vector<Block> blocks;
+	size_t blockBytes;
+	size_t current = 0;
+	size_t offset = 0;
+	size_t used = 0;
+};
+#endif
@@ -0,0 +1,258 @@
+#include"GltfDocument.h"
+#include<json/json.h>
+#include<iostream>
+
+// Receives the parser events and fills the document as the values arrive. A stack of the enclosing
+// objects and arrays tells where a value is, e.g. meshes[i].primitives[j].attributes.POSITION
+class GltfSax : public nlohmann::json_sax<nlohmann::json>
+{
+public:
+	explicit GltfSax(GltfDocument& document) : document(document) {}
+
+	bool null() override { value(); return true; }
+	bool boolean(bool flag) override { return number(flag ? 1.0 : 0.0); }
+	bool number_integer(number_integer_t number) override { return this->number((double)number); }
+	bool number_unsigned(number_unsigned_t number) override { return this->number((double)number); }
+	bool number_float(number_float_t number, const string_t&) override { return this->number(number); }
+	bool string(string_t& text) override;
+	bool binary(binary_t&) override { value(); return true; }
+	bool start_object(std::size_t) override;
+	bool key(string_t& name) override { frames.back().key = name; return true; }
+	bool end_object() override { frames.pop_back(); return true; }
+	bool start_array(std::size_t) override;
+	bool end_array() override { frames.pop_back(); return true; }
+	bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& error) override
+	{
+		message = error.what();
+		return false;
+	}
+
+	std::string message;
+
+private:
+	struct Frame
+	{
+		bool array;
+		// Member being read (objects) or index of the current element (arrays)
+		std::string key;
+		int index;
+	};
+
+	GltfDocument& document;
+	std::vector<Frame> frames;
+
+	// Counts the new element when the value is inside an array
+	void value()
+	{
+		if (!frames.empty() && frames.back().array)
+			frames.back().index++;
+	}
+	// Top level member the value is in, with its element index in frames[1]
+	bool in(const char* section) const
+	{
+		return frames.size() >= 2 && !frames[0].array && frames[1].array && frames[0].key == section;
+	}
+	const std::string& key(size_t depth) const { return frames[depth].key; }
+	int index(size_t depth) const { return frames[depth].index; }
+	bool number(double number);
+};
+
+static unsigned int componentsOf(const std::string& type)
+{
+	if (type == "SCALAR") return 1;
+	if (type == "VEC2") return 2;
+	if (type == "VEC3") return 3;
+	if (type == "VEC4") return 4;
+	return 0;
+}
+
+bool GltfSax::start_object(std::size_t)
+{
+	value();
+	size_t depth = frames.size();
+
+	// A new element of one of the arrays
+	if (depth == 2)
+	{
+		if (in("nodes")) document.nodes.push_back(GltfNode());
+		else if (in("meshes")) document.meshes.push_back(GltfMesh());
+		else if (in("accessors")) document.accessors.push_back(GltfAccessor());
+		else if (in("bufferViews")) document.bufferViews.push_back(GltfBufferView());
+		else if (in("buffers")) document.buffers.push_back(GltfBuffer());
+		else if (in("materials")) document.materials.push_back(GltfMaterial());
+		else if (in("textures")) document.textures.push_back(GltfTexture());
+		else if (in("images")) document.images.push_back(GltfImage());
+	}
+	else if (depth == 4 && in("meshes") && key(2) == "primitives" && frames[3].array)
+	{
+		document.primitives.push_back(GltfPrimitive());
+		document.meshes.back().primitiveCount++;
+	}
+
+	frames.push_back(Frame{ false, std::string(), -1 });
+	return true;
+}
+
+bool GltfSax::start_array(std::size_t)
+{
+	value();
+	size_t depth = frames.size();
+
+	// Children and primitives are stored contiguously, so only where they start is needed
+	if (depth == 3 && in("nodes") && key(2) == "children")
+		document.nodes.back().firstChild = (unsigned int)document.nodeChildren.size();
+	else if (depth == 3 && in("meshes") && key(2) == "primitives")
+		document.meshes.back().firstPrimitive = (unsigned int)document.primitives.size();
+
+	frames.push_back(Frame{ true, std::string(), -1 });
+	return true;
+}
+
+bool GltfSax::number(double number)
+{
+	value();
+	size_t depth = frames.size();
+	if (depth < 3)
+		return true;
+	int integer = (int)number;
+	unsigned int count = (unsigned int)number;
+
+	if (in("nodes"))
+	{
+		GltfNode& node = document.nodes.back();
+		if (depth == 3 && key(2) == "mesh")
+			node.mesh = integer;
+		else if (depth == 4 && frames[3].array)
+		{
+			int i = index(3);
+			const std::string& member = key(2);
+			if (member == "children")
+			{
+				document.nodeChildren.push_back(count);
+				node.childCount++;
+			}
+			else if (member == "translation" && i < 3) { node.translation[i] = (float)number; node.hasTranslation = true; }
+			else if (member == "rotation" && i < 4) { node.rotation[i] = (float)number; node.hasRotation = true; }
+			else if (member == "scale" && i < 3) { node.scale[i] = (float)number; node.hasScale = true; }
+			else if (member == "matrix" && i < 16) { node.matrix[i] = (float)number; node.hasMatrix = true; }
+		}
+	}
+	else if (in("meshes") && key(2) == "primitives" && document.primitives.size() > 0)
+	{
+		GltfPrimitive& primitive = document.primitives.back();
+		if (depth == 5 && key(4) == "indices")
+			primitive.indices = integer;
+		else if (depth == 5 && key(4) == "material")
+			primitive.material = integer;
+		else if (depth == 6 && key(4) == "attributes")
+		{
+			const std::string& attribute = key(5);
+			if (attribute == "POSITION") primitive.position = integer;
+			else if (attribute == "NORMAL") primitive.normal = integer;
+			else if (attribute == "TEXCOORD_0") primitive.texcoord = integer;
+		}
+	}
+	else if (depth == 3 && in("accessors"))
+	{
+		GltfAccessor& accessor = document.accessors.back();
+		const std::string& member = key(2);
+		if (member == "bufferView") accessor.bufferView = integer;
+		else if (member == "byteOffset") accessor.byteOffset = count;
+		else if (member == "count") accessor.count = count;
+		else if (member == "componentType") accessor.componentType = count;
+		else if (member == "normalized") accessor.normalized = count != 0;
+	}
+	else if (depth == 3 && in("bufferViews"))
+	{
+		GltfBufferView& view = document.bufferViews.back();
+		const std::string& member = key(2);
+		if (member == "buffer") view.buffer = integer;
+		else if (member == "byteOffset") view.byteOffset = count;
+		else if (member == "byteLength") view.byteLength = count;
+		else if (member == "byteStride") view.byteStride = count;
+	}
+	else if (depth == 5 && in("bufferViews") && key(2) == "extensions" && key(3) == "EXT_meshopt_compression")
+	{
+		GltfMeshopt& meshopt = document.bufferViews.back().meshopt;
+		const std::string& member = key(4);
+		if (member == "buffer") meshopt.buffer = integer;
+		else if (member == "byteOffset") meshopt.byteOffset = count;
+		else if (member == "byteLength") meshopt.byteLength = count;
+		else if (member == "byteStride") meshopt.byteStride = count;
+		else if (member == "count") meshopt.count = count;
+	}
+	else if (depth == 3 && in("buffers") && key(2) == "byteLength")
+		document.buffers.back().byteLength = count;
+	else if (depth == 5 && in("buffers") && key(2) == "extensions" && key(3) == "EXT_meshopt_compression" && key(4) == "fallback")
+		document.buffers.back().meshoptFallback = count != 0;
+	else if (depth == 5 && in("materials") && key(2) == "pbrMetallicRoughness" && key(4) == "index")
+	{
+		if (key(3) == "baseColorTexture")
+			document.materials.back().baseColorTexture = integer;
+		else if (key(3) == "metallicRoughnessTexture")
+			document.materials.back().metallicRoughnessTexture = integer;
+	}
+	else if (depth == 3 && in("textures") && key(2) == "source")
+		document.textures.back().source = integer;
+	else if (depth == 3 && in("images") && key(2) == "bufferView")
+		document.images.back().bufferView = integer;
+	return true;
+}
+
+bool GltfSax::string(string_t& text)
+{
+	value();
+	if (frames.size() == 5 && in("bufferViews") && key(2) == "extensions" && key(3) == "EXT_meshopt_compression")
+	{
+		GltfMeshopt& meshopt = document.bufferViews.back().meshopt;
+		if (key(4) == "mode")
+			meshopt.mode = text == "TRIANGLES" ? MeshoptTriangles : text == "INDICES" ? MeshoptIndices : MeshoptAttributes;
+		else if (key(4) == "filter")
+		{
+			meshopt.filter = text == "OCTAHEDRAL" ? MeshoptFilterOctahedral : text == "QUATERNION" ? MeshoptFilterQuaternion
+				: text == "EXPONENTIAL" ? MeshoptFilterExponential : MeshoptFilterNone;
+		}
+		return true;
+	}
+	if (frames.size() != 3)
+		return true;
+
+	auto store = [this](const std::string& text)
+	{
+		GltfString part;
+		part.offset = (unsigned int)document.strings.size();
+		part.length = (unsigned int)text.size();
+		document.strings += text;
+		return part;
+	};
+	if (in("accessors") && key(2) == "type")
+		document.accessors.back().components = componentsOf(text);
+	else if (in("buffers") && key(2) == "uri")
+		document.buffers.back().uri = store(text);
+	else if (in("images") && key(2) == "uri")
+		document.images.back().uri = store(text);
+	return true;
+}
+
+// Returns false and prints the error if the text isn't valid JSON
+bool GltfDocument::Parse(const char* text, size_t length, const std::string& name)
+{
+	*this = GltfDocument();
+	GltfSax sax(*this);
+	if (!nlohmann::json::sax_parse(text, text + length, &sax))
+	{
+		std::cerr << "ERROR: Failed to parse " << name << ": " << sax.message << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Memory held by the arrays
+size_t GltfDocument::Bytes() const
+{
+	return nodes.capacity() * sizeof(GltfNode) + nodeChildren.capacity() * sizeof(unsigned int)
+		+ meshes.capacity() * sizeof(GltfMesh) + primitives.capacity() * sizeof(GltfPrimitive)
+		+ accessors.capacity() * sizeof(GltfAccessor) + bufferViews.capacity() * sizeof(GltfBufferView)
+		+ buffers.capacity() * sizeof(GltfBuffer) + materials.capacity() * sizeof(GltfMaterial)
+		+ textures.capacity() * sizeof(GltfTexture) + images.capacity() * sizeof(GltfImage) + strings.capacity();
+}
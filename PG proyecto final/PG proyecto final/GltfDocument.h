@@ -0,0 +1,153 @@
+#ifndef GLTF_DOCUMENT_CLASS_H
+#define GLTF_DOCUMENT_CLASS_H
+
+#include<cstddef>
+#include<string>
+#include<vector>
+
+// Part of GltfDocument::strings
+struct GltfString
+{
+	unsigned int offset = 0;
+	unsigned int length = 0;
+};
+
+struct GltfNode
+{
+	int mesh = -1;
+	// Children are nodeChildren[firstChild .. firstChild + childCount)
+	unsigned int firstChild = 0;
+	unsigned int childCount = 0;
+	bool hasTranslation = false;
+	bool hasRotation = false;
+	bool hasScale = false;
+	bool hasMatrix = false;
+	float translation[3] = { 0.0f, 0.0f, 0.0f };
+	// x, y, z, w as stored in the file
+	float rotation[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+	float scale[3] = { 1.0f, 1.0f, 1.0f };
+	// Column major
+	float matrix[16] = { 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1 };
+};
+
+// Accessor indices of a primitive, -1 when missing
+struct GltfPrimitive
+{
+	int position = -1;
+	int normal = -1;
+	int texcoord = -1;
+	int indices = -1;
+	int material = -1;
+};
+
+struct GltfMesh
+{
+	// Primitives are primitives[firstPrimitive .. firstPrimitive + primitiveCount)
+	unsigned int firstPrimitive = 0;
+	unsigned int primitiveCount = 0;
+};
+
+struct GltfAccessor
+{
+	// -1 means every element is zero
+	int bufferView = -1;
+	unsigned int byteOffset = 0;
+	unsigned int count = 0;
+	unsigned int componentType = 0;
+	// 1 for SCALAR up to 4 for VEC4, 0 for types the loader doesn't read
+	unsigned int components = 0;
+	bool normalized = false;
+};
+
+// How an EXT_meshopt_compression bufferView was encoded
+enum GltfMeshoptMode
+{
+	MeshoptAttributes,
+	MeshoptTriangles,
+	MeshoptIndices
+};
+
+enum GltfMeshoptFilter
+{
+	MeshoptFilterNone,
+	MeshoptFilterOctahedral,
+	MeshoptFilterQuaternion,
+	MeshoptFilterExponential
+};
+
+// Compressed data of a bufferView, decodes into count * byteStride bytes
+struct GltfMeshopt
+{
+	// -1 when the bufferView isn't compressed
+	int buffer = -1;
+	unsigned int byteOffset = 0;
+	unsigned int byteLength = 0;
+	unsigned int byteStride = 0;
+	unsigned int count = 0;
+	GltfMeshoptMode mode = MeshoptAttributes;
+	GltfMeshoptFilter filter = MeshoptFilterNone;
+};
+
+struct GltfBufferView
+{
+	int buffer = 0;
+	unsigned int byteOffset = 0;
+	unsigned int byteLength = 0;
+	// 0 means tightly packed
+	unsigned int byteStride = 0;
+	GltfMeshopt meshopt;
+};
+
+struct GltfBuffer
+{
+	GltfString uri;
+	unsigned int byteLength = 0;
+	// Placeholder for data that only exists compressed, it has no uri
+	bool meshoptFallback = false;
+};
+
+// Texture (not image) indices of the material, -1 when missing
+struct GltfMaterial
+{
+	int baseColorTexture = -1;
+	int metallicRoughnessTexture = -1;
+};
+
+struct GltfTexture
+{
+	int source = -1;
+};
+
+// Image file referenced by uri, or embedded in a bufferView when the uri is empty
+struct GltfImage
+{
+	GltfString uri;
+	int bufferView = -1;
+};
+
+// The parts of a glTF file the loader uses, parsed straight into flat arrays that reference each other by index.
+// No JSON tree is built, so nothing of the text is kept once Parse returns
+class GltfDocument
+{
+public:
+	std::vector<GltfNode> nodes;
+	std::vector<unsigned int> nodeChildren;
+	std::vector<GltfMesh> meshes;
+	std::vector<GltfPrimitive> primitives;
+	std::vector<GltfAccessor> accessors;
+	std::vector<GltfBufferView> bufferViews;
+	std::vector<GltfBuffer> buffers;
+	std::vector<GltfMaterial> materials;
+	std::vector<GltfTexture> textures;
+	std::vector<GltfImage> images;
+	// Every string the arrays refer to, back to back
+	std::string strings;
+
+	// Returns false and prints the error if the text isn't valid JSON
+	bool Parse(const char* text, size_t length, const std::string& name);
+
+	std::string String(const GltfString& part) const { return strings.substr(part.offset, part.length); }
+	// Memory held by the arrays
+	size_t Bytes() const;
+};
+#endif
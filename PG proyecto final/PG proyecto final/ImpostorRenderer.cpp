@@ -0,0 +1,382 @@
+#include"ImpostorRenderer.h"
+#include"Camera.h"
+#include"LoadReport.h"
+#include"MemoryTracker.h"
+#include"Model.h"
+#include"Profiler.h"
+#include"RenderStats.h"
+#include"TextureStreamer.h"
+#include<glm/gtc/matrix_access.hpp>
+#include<glm/gtc/matrix_transform.hpp>
+#include<glm/gtc/type_ptr.hpp>
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<iostream>
+
+bool ImpostorRenderer::enabled = true;
+float ImpostorRenderer::screenSize = 100.0f;
+int ImpostorRenderer::framesPerSide = 8;
+int ImpostorRenderer::frameSize = 128;
+ImpostorCounters ImpostorRenderer::stats;
+ImpostorRenderer* ImpostorRenderer::active = nullptr;
+
+// Mesh and impostor cross-fade between these fractions of screenSize
+static const float fadeStart = 0.8f;
+static const float fadeEnd = 1.2f;
+
+// Hemi-octahedral mapping: the square [-1, 1]^2 folded over the upper hemisphere, y up
+static glm::vec3 hemiOctahedronDirection(glm::vec2 coordinates)
+{
+	float x = (coordinates.x + coordinates.y) * 0.5f;
+	float z = (coordinates.x - coordinates.y) * 0.5f;
+	return glm::normalize(glm::vec3(x, 1.0f - std::abs(x) - std::abs(z), z));
+}
+
+// Directions below the horizon use the view from the horizon
+static glm::vec2 hemiOctahedronCoordinates(glm::vec3 direction)
+{
+	direction.y = std::max(direction.y, 0.0f);
+	float norm = std::abs(direction.x) + direction.y + std::abs(direction.z);
+	// Straight below nothing is left of the direction, any view from the horizon is as good
+	if (norm < 1e-6f)
+		return glm::vec2(1.0f, 1.0f);
+	direction /= norm;
+	return glm::vec2(direction.x + direction.z, direction.x - direction.z);
+}
+
+// Axes of the quad facing 'direction', the same the baked views used
+static void quadAxes(glm::vec3 direction, glm::vec3& right, glm::vec3& up)
+{
+	glm::vec3 worldUp = std::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, -1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+	right = glm::normalize(glm::cross(worldUp, direction));
+	up = glm::cross(direction, right);
+}
+
+ImpostorRenderer::ImpostorRenderer()
+	: shader("impostor.vert", "impostor.frag"), bakeShader("default.vert", "impostor_bake.frag")
+{
+	GLfloat corners[] = { -1.0f, -1.0f,  1.0f, -1.0f,  -1.0f, 1.0f,  1.0f, 1.0f };
+	glGenVertexArrays(1, &quadVAO);
+	glGenBuffers(1, &quadVBO);
+	glBindVertexArray(quadVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(GLfloat), (void*)0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	shader.Activate();
+	glUniform1i(glGetUniformLocation(shader.ID, "albedo"), 0);
+	glUniform1i(glGetUniformLocation(shader.ID, "normalDepth"), 1);
+	active = this;
+}
+
+void ImpostorRenderer::Split(const std::vector<Model*>& models, Camera& camera)
+{
+	PROFILE_SCOPE("Impostor split");
+	if (meshModels.capacity() < models.size())
+	{
+		meshModels.reserve(models.size() * 2);
+		impostors.reserve(models.size() * 2);
+	}
+	meshModels.clear();
+	impostors.clear();
+	bakedThisFrame = false;
+	stats.impostors = 0;
+	stats.fading = 0;
+
+	// Pixels per unit at unit distance, and the distance along the view, from the view projection matrix
+	float focal = glm::length(glm::vec3(glm::row(camera.cameraMatrix, 1)));
+	glm::vec4 depthRow = glm::row(camera.cameraMatrix, 3);
+	// Textures still loading would be baked at the wrong resolution
+	bool texturesBusy = LoadReport::inFlight > 0 || (TextureStreamer::active && TextureStreamer::active->Pending() > 0);
+
+	for (Model* model : models)
+	{
+		model->fade = 1.0f;
+		if (!enabled || !model->impostor)
+		{
+			meshModels.push_back(model);
+			continue;
+		}
+
+		glm::vec3 boxMin, boxMax;
+		model->GetBounds(boxMin, boxMax);
+		glm::vec3 center = (boxMin + boxMax) * 0.5f;
+		glm::vec3 extent = (boxMax - boxMin) * 0.5f;
+		float radius = std::max(extent.x, std::max(extent.y, extent.z));
+		float distance = glm::dot(depthRow, glm::vec4(center, 1.0f));
+		float pixels = distance > radius ? radius * focal * camera.height / distance : screenSize * fadeEnd;
+		if (pixels >= screenSize * fadeEnd)
+		{
+			meshModels.push_back(model);
+			continue;
+		}
+
+		int atlas = atlasOf(*model);
+		if (atlas < 0 && !bakedThisFrame && !texturesBusy)
+			atlas = bake(*model);
+		if (atlas < 0)
+		{
+			meshModels.push_back(model);
+			continue;
+		}
+
+		float fade = glm::clamp((pixels - screenSize * fadeStart) / (screenSize * (fadeEnd - fadeStart)), 0.0f, 1.0f);
+		impostors.push_back({ atlas, model->GetPlacement() * atlases[atlas].inversePlacement, fade });
+		if (fade > 0.0f)
+		{
+			model->fade = fade;
+			meshModels.push_back(model);
+			stats.fading++;
+		}
+		else
+			stats.impostors++;
+	}
+}
+
+void ImpostorRenderer::Draw(Camera& camera, glm::vec4 lightColor)
+{
+	if (impostors.empty())
+		return;
+	PROFILE_SCOPE("Impostors");
+	shader.Activate();
+	camera.Matrix(shader, "camMatrix");
+	glUniform4f(glGetUniformLocation(shader.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
+	glUniform1f(glGetUniformLocation(shader.ID, "frameSize"), 1.0f / framesPerSide);
+	GLboolean culling = glIsEnabled(GL_CULL_FACE);
+	glDisable(GL_CULL_FACE);
+	glBindVertexArray(quadVAO);
+
+	for (const Impostor& impostor : impostors)
+	{
+		const Atlas& atlas = atlases[impostor.atlas];
+		// Camera direction in the space the atlas was baked in
+		glm::vec3 eye = glm::vec3(glm::inverse(impostor.instance) * glm::vec4(camera.Position, 1.0f));
+		glm::vec3 direction = glm::normalize(eye - atlas.center);
+		glm::vec3 right, up;
+		quadAxes(direction, right, up);
+
+		// The four views around it, weighted by how close each is
+		glm::vec2 grid = (hemiOctahedronCoordinates(direction) * 0.5f + 0.5f) * (float)framesPerSide - 0.5f;
+		int x0 = glm::clamp((int)std::floor(grid.x), 0, std::max(framesPerSide - 2, 0));
+		int y0 = glm::clamp((int)std::floor(grid.y), 0, std::max(framesPerSide - 2, 0));
+		int x1 = std::min(x0 + 1, framesPerSide - 1);
+		int y1 = std::min(y0 + 1, framesPerSide - 1);
+		float fx = glm::clamp(grid.x - x0, 0.0f, 1.0f);
+		float fy = glm::clamp(grid.y - y0, 0.0f, 1.0f);
+		glm::vec2 frames[4] = { glm::vec2(x0, y0), glm::vec2(x1, y0), glm::vec2(x0, y1), glm::vec2(x1, y1) };
+		for (glm::vec2& frame : frames)
+			frame /= (float)framesPerSide;
+		glm::vec4 weights((1.0f - fx) * (1.0f - fy), fx * (1.0f - fy), (1.0f - fx) * fy, fx * fy);
+
+		glUniformMatrix4fv(glGetUniformLocation(shader.ID, "instance"), 1, GL_FALSE, glm::value_ptr(impostor.instance));
+		glUniform3fv(glGetUniformLocation(shader.ID, "center"), 1, glm::value_ptr(atlas.center));
+		glUniform1f(glGetUniformLocation(shader.ID, "radius"), atlas.radius);
+		glUniform3fv(glGetUniformLocation(shader.ID, "right"), 1, glm::value_ptr(right));
+		glUniform3fv(glGetUniformLocation(shader.ID, "up"), 1, glm::value_ptr(up));
+		glUniform3fv(glGetUniformLocation(shader.ID, "viewDirection"), 1, glm::value_ptr(direction));
+		glUniform2fv(glGetUniformLocation(shader.ID, "frames"), 4, glm::value_ptr(frames[0]));
+		glUniform4fv(glGetUniformLocation(shader.ID, "weights"), 1, glm::value_ptr(weights));
+		glUniform1f(glGetUniformLocation(shader.ID, "fade"), impostor.fade);
+
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, atlas.albedo);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, atlas.normalDepth);
+		glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+		RenderStats::frame.drawCalls++;
+		RenderStats::frame.triangles += 2;
+		RenderStats::frame.textureBinds += 2;
+	}
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindVertexArray(0);
+	if (culling)
+		glEnable(GL_CULL_FACE);
+}
+
+int ImpostorRenderer::atlasOf(Model& model)
+{
+	if (model.impostorGeneration == generation)
+		return model.impostorAtlas;
+	model.impostorGeneration = generation;
+	model.impostorAtlas = -1;
+	for (size_t i = 0; i < atlases.size(); i++)
+	{
+		const Atlas& atlas = atlases[i];
+		if (atlas.file == model.GetFile() && atlas.scale == model.GetScale() && atlas.translation == model.GetPosition()
+			&& atlas.rotation == model.GetRotation())
+		{
+			model.impostorAtlas = (int)i;
+			break;
+		}
+	}
+	return model.impostorAtlas;
+}
+
+int ImpostorRenderer::bake(Model& model)
+{
+	PROFILE_SCOPE("Impostor bake");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	bakedThisFrame = true;
+
+	Atlas atlas;
+	atlas.file = model.GetFile();
+	atlas.scale = model.GetScale();
+	atlas.translation = model.GetPosition();
+	atlas.rotation = model.GetRotation();
+	atlas.inversePlacement = glm::inverse(model.GetPlacement());
+	// Sphere around the mesh bounds, the baked space is the world space of this model
+	glm::vec3 boxMin, boxMax;
+	model.GetBounds(boxMin, boxMax);
+	atlas.center = (boxMin + boxMax) * 0.5f;
+	atlas.radius = 0.0f;
+	for (unsigned int i = 0; i < model.GetMeshes().size(); i++)
+	{
+		BoundingSphere bounds = model.GetMeshBounds(i);
+		atlas.radius = std::max(atlas.radius, glm::length(bounds.center - atlas.center) + bounds.radius);
+	}
+	if (atlas.radius <= 0.0f)
+		return -1;
+
+	int size = framesPerSide * frameSize;
+	auto createTexture = [size](GLenum format)
+	{
+		GLuint texture;
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, format, size, size, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+		return texture;
+	};
+	// Albedo is sRGB like the model textures, so the blend between views happens in linear space
+	atlas.albedo = createTexture(GL_SRGB8_ALPHA8);
+	atlas.normalDepth = createTexture(GL_RGBA8);
+
+	GLint previousFramebuffer = 0;
+	GLint previousViewport[4];
+	GLfloat previousClear[4];
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &previousFramebuffer);
+	glGetIntegerv(GL_VIEWPORT, previousViewport);
+	glGetFloatv(GL_COLOR_CLEAR_VALUE, previousClear);
+	GLboolean srgb = glIsEnabled(GL_FRAMEBUFFER_SRGB);
+	GLboolean blend = glIsEnabled(GL_BLEND);
+
+	GLuint framebuffer, depth;
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, atlas.albedo, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, atlas.normalDepth, 0);
+	glGenRenderbuffers(1, &depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, depth);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	GLenum attachments[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+	glDrawBuffers(2, attachments);
+
+	bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	if (complete)
+	{
+		glViewport(0, 0, size, size);
+		glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		glEnable(GL_FRAMEBUFFER_SRGB);
+		glDisable(GL_BLEND);
+
+		// One orthographic view per cell, from outside the sphere looking at its center. Its near and
+		// far planes touch the sphere, so the depth written spans the model
+		Camera view(frameSize, frameSize, atlas.center);
+		float r = atlas.radius;
+		glm::mat4 projection = glm::ortho(-r, r, -r, r, r, 3.0f * r);
+		for (int y = 0; y < framesPerSide; y++)
+		{
+			for (int x = 0; x < framesPerSide; x++)
+			{
+				glm::vec2 coordinates = (glm::vec2(x, y) + 0.5f) / (float)framesPerSide * 2.0f - 1.0f;
+				glm::vec3 direction = hemiOctahedronDirection(coordinates);
+				glm::vec3 right, up;
+				quadAxes(direction, right, up);
+				view.Position = atlas.center + direction * 2.0f * r;
+				view.cameraMatrix = projection * glm::lookAt(view.Position, atlas.center, up);
+				glViewport(x * frameSize, y * frameSize, frameSize, frameSize);
+				model.Draw(bakeShader, view);
+			}
+		}
+	}
+	else
+		std::cerr << "ERROR: Impostor framebuffer is incomplete" << std::endl;
+
+	glBindFramebuffer(GL_FRAMEBUFFER, previousFramebuffer);
+	glViewport(previousViewport[0], previousViewport[1], previousViewport[2], previousViewport[3]);
+	glClearColor(previousClear[0], previousClear[1], previousClear[2], previousClear[3]);
+	if (!srgb)
+		glDisable(GL_FRAMEBUFFER_SRGB);
+	if (blend)
+		glEnable(GL_BLEND);
+	glDeleteRenderbuffers(1, &depth);
+	glDeleteFramebuffers(1, &framebuffer);
+
+	if (!complete)
+	{
+		glDeleteTextures(1, &atlas.albedo);
+		glDeleteTextures(1, &atlas.normalDepth);
+		return -1;
+	}
+	MemoryTracker::Add(atlas.file + " (impostor)", MemoryTextures, (size_t)size * size * 8);
+	atlases.push_back(atlas);
+	generation++;
+	stats.atlases = (int)atlases.size();
+	stats.bakeMs = (float)std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	std::cout << "IMPOSTOR: baked " << atlas.file << " (" << framesPerSide * framesPerSide << " views) in " << stats.bakeMs << " ms" << std::endl;
+	return (int)atlases.size() - 1;
+}
+
+void ImpostorRenderer::Forget(const std::string& file)
+{
+	size_t before = atlases.size();
+	for (size_t i = 0; i < atlases.size();)
+	{
+		if (atlases[i].file != file)
+		{
+			i++;
+			continue;
+		}
+		deleteAtlas(atlases[i]);
+		atlases.erase(atlases.begin() + i);
+	}
+	if (atlases.size() == before)
+		return;
+	// The impostors of the last Split and the models point into 'atlases' by index
+	impostors.clear();
+	generation++;
+	stats.atlases = (int)atlases.size();
+}
+
+void ImpostorRenderer::deleteAtlas(Atlas& atlas)
+{
+	int size = framesPerSide * frameSize;
+	glDeleteTextures(1, &atlas.albedo);
+	glDeleteTextures(1, &atlas.normalDepth);
+	MemoryTracker::Release(atlas.file + " (impostor)", MemoryTextures, (size_t)size * size * 8);
+}
+
+void ImpostorRenderer::Delete()
+{
+	if (active == this)
+		active = nullptr;
+	for (Atlas& atlas : atlases)
+		deleteAtlas(atlas);
+	atlases.clear();
+	glDeleteVertexArrays(1, &quadVAO);
+	glDeleteBuffers(1, &quadVBO);
+	shader.Delete();
+	bakeShader.Delete();
+}
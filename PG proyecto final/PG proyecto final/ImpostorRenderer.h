@@ -0,0 +1,101 @@
+#ifndef IMPOSTOR_RENDERER_CLASS_H
+#define IMPOSTOR_RENDERER_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<glm/gtc/quaternion.hpp>
+#include<string>
+#include<vector>
+
+#include"shaderClass.h"
+
+class Camera;
+class Model;
+
+// What the impostors did last frame, shown by the stats overlay
+struct ImpostorCounters
+{
+	int impostors = 0;
+	// Drawn both ways while crossing the threshold
+	int fading = 0;
+	int atlases = 0;
+	// Time of the last bake
+	float bakeMs = 0.0f;
+};
+
+// Octahedral impostors: far away, an exhibit is drawn as a quad textured with views of it baked beforehand.
+// The first time a model is small enough on screen, it is rendered from framesPerSide x framesPerSide directions
+// spread over the upper hemisphere (hemi-octahedral mapping) into an atlas of albedo, normal and depth. Instances
+// of the same file and custom transform share the atlas. The quad blends the four views nearest to the camera's
+// direction, writes the baked depth and is lit like the mesh. Around the threshold mesh and quad cross-fade with
+// complementary dither patterns
+class ImpostorRenderer
+{
+public:
+	// Needs the GL context, creates the shaders and the quad
+	ImpostorRenderer();
+
+	// Render thread: splits 'models' into the ones drawn as meshes ('meshModels', setting their fade) and the
+	// impostors, baking at most one atlas
+	void Split(const std::vector<Model*>& models, Camera& camera);
+	std::vector<Model*> meshModels;
+	// Render thread, after the meshes: draws the impostors 'Split' picked
+	void Draw(Camera& camera, glm::vec4 lightColor);
+	// Render thread: deletes the atlases of a file that was unloaded. If it is loaded again, it is baked again
+	void Forget(const std::string& file);
+	void Delete();
+
+	// Off: every model is drawn as a mesh
+	static bool enabled;
+	// Models smaller on screen than this many pixels across are drawn as impostors
+	static float screenSize;
+	// Views per side of the atlas and pixels per side of a view
+	static int framesPerSide;
+	static int frameSize;
+	static ImpostorCounters stats;
+	// The renderer SceneRuntime tells about the files it unloads, nullptr when there is none
+	static ImpostorRenderer* active;
+
+private:
+	struct Atlas
+	{
+		// What instances it serves
+		std::string file;
+		glm::vec3 scale;
+		glm::vec3 translation;
+		glm::quat rotation;
+		// Placement of the model it was baked from, inverted
+		glm::mat4 inversePlacement;
+		// Bounding sphere in the baked space
+		glm::vec3 center;
+		float radius;
+		GLuint albedo = 0;
+		GLuint normalDepth = 0;
+	};
+	struct Impostor
+	{
+		// Index in 'atlases'
+		int atlas;
+		// Baked space to world space
+		glm::mat4 instance;
+		float fade;
+	};
+
+	Shader shader;
+	Shader bakeShader;
+	GLuint quadVAO = 0;
+	GLuint quadVBO = 0;
+	std::vector<Atlas> atlases;
+	std::vector<Impostor> impostors;
+	bool bakedThisFrame = false;
+	// Changes whenever 'atlases' does, the atlas a model cached is looked up again then. Starts above the models' 0
+	unsigned int generation = 1;
+
+	// Atlas serving the model, -1 if there is none yet
+	int atlasOf(Model& model);
+	// Renders the views of the model into a new atlas, -1 if the framebuffer can't be made
+	int bake(Model& model);
+	// Deletes the textures of an atlas and gives their memory back to the tracker
+	void deleteAtlas(Atlas& atlas);
+};
+#endif
@@ -0,0 +1,157 @@
+#include"InputSystem.h"
+#include<cstring>
+#include<iostream>
+
+// Keys and buttons the gallery reacts to, a log stores one bit for each of them in this order
+const int InputSystem::trackedKeys[] = { GLFW_KEY_W, GLFW_KEY_A, GLFW_KEY_S, GLFW_KEY_D, GLFW_KEY_LEFT_SHIFT, GLFW_KEY_ESCAPE };
+const int InputSystem::trackedButtons[] = { GLFW_MOUSE_BUTTON_LEFT, GLFW_MOUSE_BUTTON_RIGHT };
+
+// Log layout: "GINP", uint32 version, then one 15 byte record per frame
+// (float time, float cursor x, float cursor y, uint16 keys, uint8 buttons), little endian
+static const char logMagic[4] = { 'G', 'I', 'N', 'P' };
+static const uint32_t logVersion = 1;
+static const size_t recordBytes = 15;
+
+InputSystem::InputSystem(GLFWwindow* window)
+	: window(window), startTime(glfwGetTime())
+{
+}
+
+// Flushes the recording, if any
+InputSystem::~InputSystem()
+{
+	StopRecording();
+}
+
+// Writes every frame's input to the file
+bool InputSystem::Record(const std::string& file)
+{
+	recording.open(file, std::ios::binary);
+	if (!recording)
+	{
+		std::cerr << "ERROR: Failed to create input log " << file << std::endl;
+		return false;
+	}
+	recording.write(logMagic, 4);
+	recording.write((const char*)&logVersion, sizeof(logVersion));
+	return true;
+}
+
+// Closes the log being recorded, if any
+void InputSystem::StopRecording()
+{
+	if (recording.is_open())
+	{
+		recording.close();
+		std::cout << "INPUT: recorded " << recordedFrames << " frames" << std::endl;
+	}
+}
+
+// Reads the input of every frame from a log written by Record instead of the window
+bool InputSystem::Replay(const std::string& file)
+{
+	std::ifstream in(file, std::ios::binary);
+	char magic[4];
+	uint32_t version = 0;
+	if (!in.read(magic, 4) || std::memcmp(magic, logMagic, 4) != 0 ||
+		!in.read((char*)&version, sizeof(version)) || version != logVersion)
+	{
+		std::cerr << "ERROR: " << file << " is not an input log" << std::endl;
+		return false;
+	}
+
+	replay.clear();
+	unsigned char record[recordBytes];
+	while (in.read((char*)record, recordBytes))
+	{
+		InputState frame;
+		std::memcpy(&frame.time, record, 4);
+		std::memcpy(&frame.cursor.x, record + 4, 4);
+		std::memcpy(&frame.cursor.y, record + 8, 4);
+		std::memcpy(&frame.keys, record + 12, 2);
+		frame.buttons = record[14];
+		replay.push_back(frame);
+	}
+
+	replaying = true;
+	replayFrame = 0;
+	std::cout << "INPUT: replaying " << replay.size() << " frames from " << file << std::endl;
+	return true;
+}
+
+// Polls (or replays) the input of a new frame, returns false once the replay ran out
+bool InputSystem::BeginFrame()
+{
+	if (replaying)
+	{
+		if (replayFrame >= replay.size())
+			return false;
+		state = replay[replayFrame++];
+		return true;
+	}
+
+	state.time = (float)(glfwGetTime() - startTime);
+	double x, y;
+	glfwGetCursorPos(window, &x, &y);
+	state.cursor = glm::vec2((float)x, (float)y);
+	state.keys = 0;
+	for (unsigned int i = 0; i < sizeof(trackedKeys) / sizeof(trackedKeys[0]); i++)
+	{
+		if (glfwGetKey(window, trackedKeys[i]) == GLFW_PRESS)
+			state.keys |= 1 << i;
+	}
+	state.buttons = 0;
+	for (unsigned int i = 0; i < sizeof(trackedButtons) / sizeof(trackedButtons[0]); i++)
+	{
+		if (glfwGetMouseButton(window, trackedButtons[i]) == GLFW_PRESS)
+			state.buttons |= 1 << i;
+	}
+
+	if (recording.is_open())
+	{
+		unsigned char record[recordBytes];
+		std::memcpy(record, &state.time, 4);
+		std::memcpy(record + 4, &state.cursor.x, 4);
+		std::memcpy(record + 8, &state.cursor.y, 4);
+		std::memcpy(record + 12, &state.keys, 2);
+		record[14] = state.buttons;
+		recording.write((const char*)record, recordBytes);
+		recordedFrames++;
+	}
+	return true;
+}
+
+bool InputSystem::Key(int key) const
+{
+	for (unsigned int i = 0; i < sizeof(trackedKeys) / sizeof(trackedKeys[0]); i++)
+	{
+		if (trackedKeys[i] == key)
+			return (state.keys >> i) & 1;
+	}
+	return false;
+}
+
+bool InputSystem::Button(int button) const
+{
+	for (unsigned int i = 0; i < sizeof(trackedButtons) / sizeof(trackedButtons[0]); i++)
+	{
+		if (trackedButtons[i] == button)
+			return (state.buttons >> i) & 1;
+	}
+	return false;
+}
+
+// Moves the cursor, the new position is what Cursor() returns for the rest of the frame
+void InputSystem::SetCursor(glm::vec2 position)
+{
+	state.cursor = position;
+	if (!replaying)
+		glfwSetCursorPos(window, position.x, position.y);
+}
+
+// GLFW_CURSOR_NORMAL/HIDDEN, does nothing while replaying
+void InputSystem::SetCursorMode(int mode)
+{
+	if (!replaying)
+		glfwSetInputMode(window, GLFW_CURSOR, mode);
+}
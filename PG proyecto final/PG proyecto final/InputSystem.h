@@ -0,0 +1,72 @@
+#ifndef INPUT_SYSTEM_CLASS_H
+#define INPUT_SYSTEM_CLASS_H
+
+#include<GLFW/glfw3.h>
+#include<glm/glm.hpp>
+#include<cstdint>
+#include<fstream>
+#include<string>
+#include<vector>
+
+// Everything the camera reads from the window in one frame
+struct InputState
+{
+	// Seconds since the start of the run
+	float time = 0.0f;
+	glm::vec2 cursor = glm::vec2(0.0f);
+	// One bit per tracked key (see InputSystem::trackedKeys) and per mouse button
+	uint16_t keys = 0;
+	uint8_t buttons = 0;
+};
+
+// Per frame input, read live from GLFW or replayed from a log. Live input can be recorded
+// to a compact binary log, so a visitor's walk can be replayed frame by frame against any build
+class InputSystem
+{
+public:
+	InputSystem(GLFWwindow* window);
+	// Flushes the recording, if any
+	~InputSystem();
+
+	// Writes every frame's input to the file
+	bool Record(const std::string& file);
+	// Closes the log being recorded, if any
+	void StopRecording();
+	// Reads the input of every frame from a log written by Record instead of the window
+	bool Replay(const std::string& file);
+
+	// Polls (or replays) the input of a new frame, returns false once the replay ran out
+	bool BeginFrame();
+
+	bool Key(int key) const;
+	bool Button(int button) const;
+	// True while any tracked key or button is held down
+	bool AnyHeld() const { return state.keys != 0 || state.buttons != 0; }
+	glm::vec2 Cursor() const { return state.cursor; }
+	float Time() const { return state.time; }
+
+	// Moves the cursor, the new position is what Cursor() returns for the rest of the frame
+	void SetCursor(glm::vec2 position);
+	// GLFW_CURSOR_NORMAL/HIDDEN, does nothing while replaying
+	void SetCursorMode(int mode);
+
+	bool IsReplaying() const { return replaying; }
+	bool IsRecording() const { return recording.is_open(); }
+	// Frames in the log being replayed
+	size_t ReplayLength() const { return replay.size(); }
+
+private:
+	GLFWwindow* window;
+	InputState state;
+	double startTime;
+
+	std::ofstream recording;
+	size_t recordedFrames = 0;
+	bool replaying = false;
+	std::vector<InputState> replay;
+	size_t replayFrame = 0;
+
+	static const int trackedKeys[];
+	static const int trackedButtons[];
+};
+#endif
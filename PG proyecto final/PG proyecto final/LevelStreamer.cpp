@@ -0,0 +1,68 @@
+#include"LevelStreamer.h"
+#include<algorithm>
+#include<iostream>
+#include<limits>
+
+float LevelStreamer::loadDistance = 20.0f;
+float LevelStreamer::unloadDistance = 30.0f;
+size_t LevelStreamer::cpuBudget = 0;
+size_t LevelStreamer::gpuBudget = 0;
+bool LevelStreamer::enabled = true;
+StreamingCounters LevelStreamer::stats;
+
+LevelStreamer::LevelStreamer(const std::vector<SceneRoom>& rooms)
+	: rooms(rooms), distances(rooms.size(), 0.0f), priorities(rooms.size(), 0.0f), wantedFlags(rooms.size(), 0),
+	budgetDistance(std::numeric_limits<float>::max())
+{
+	// Sized once, Update doesn't allocate
+	wanted.reserve(rooms.size());
+	stats.rooms = (int)rooms.size();
+}
+
+void LevelStreamer::Update(glm::vec3 position, glm::vec3 direction, size_t cpuBytes, size_t gpuBytes, bool settled)
+{
+	for (size_t i = 0; i < rooms.size(); i++)
+	{
+		glm::vec3 closest = glm::clamp(position, rooms[i].boundsMin, rooms[i].boundsMax);
+		distances[i] = glm::length(closest - position);
+		// Up to half as far when straight ahead and half again as far when behind
+		float ahead = distances[i] > 0.0f ? glm::dot((closest - position) / distances[i], direction) : 1.0f;
+		priorities[i] = distances[i] * (1.0f - 0.5f * ahead);
+
+		bool keep = !enabled || distances[i] <= (wantedFlags[i] ? unloadDistance : loadDistance);
+		if (distances[i] > 0.0f && distances[i] >= budgetDistance)
+			keep = false;
+		wantedFlags[i] = keep ? 1 : 0;
+	}
+
+	if (settled)
+	{
+		bool over = (cpuBudget > 0 && cpuBytes > cpuBudget) || (gpuBudget > 0 && gpuBytes > gpuBudget);
+		bool under = (cpuBudget == 0 || cpuBytes < cpuBudget / 4 * 3) && (gpuBudget == 0 || gpuBytes < gpuBudget / 4 * 3);
+		if (over)
+		{
+			// The room the visitor is in always stays
+			int drop = -1;
+			for (size_t i = 0; i < rooms.size(); i++)
+			{
+				if (wantedFlags[i] && distances[i] > 0.0f && (drop < 0 || priorities[i] > priorities[drop]))
+					drop = (int)i;
+			}
+			if (drop >= 0)
+			{
+				wantedFlags[drop] = 0;
+				budgetDistance = distances[drop];
+			}
+		}
+		else if (under)
+			budgetDistance = std::numeric_limits<float>::max();
+	}
+
+	wanted.clear();
+	for (size_t i = 0; i < rooms.size(); i++)
+	{
+		if (wantedFlags[i])
+			wanted.push_back((int)i);
+	}
+	std::sort(wanted.begin(), wanted.end(), [this](int a, int b) { return priorities[a] < priorities[b]; });
+}
@@ -0,0 +1,58 @@
+#ifndef LEVEL_STREAMER_CLASS_H
+#define LEVEL_STREAMER_CLASS_H
+
+#include<glm/glm.hpp>
+#include<cstddef>
+#include<vector>
+
+#include"Scene.h"
+
+// What the level streamer is doing, shown by the stats overlay
+struct StreamingCounters
+{
+	int rooms = 0;
+	int residentRooms = 0;
+	// Asset files being read on the workers or waiting for their upload
+	int loadingAssets = 0;
+	int loads = 0;
+	int unloads = 0;
+};
+
+// Picks the rooms of a scene that should be resident. Rooms closer than loadDistance are wanted and stay wanted
+// until they are farther than unloadDistance, so walking along a boundary doesn't load and unload them every step.
+// Rooms ahead of the visitor come first. Over the CPU or GPU budget the least urgent room is dropped and nothing
+// at its distance or farther is loaded again until memory is well under the budget
+class LevelStreamer
+{
+public:
+	LevelStreamer(const std::vector<SceneRoom>& rooms);
+
+	// Render thread, once per frame. 'direction' is where the visitor is walking (or looking when standing still).
+	// The budgets are only checked when 'settled', the memory totals lag behind while loads and unloads are pending
+	void Update(glm::vec3 position, glm::vec3 direction, size_t cpuBytes, size_t gpuBytes, bool settled);
+
+	// Rooms that should be resident, most urgent first
+	const std::vector<int>& Wanted() const { return wanted; }
+	bool IsWanted(int room) const { return wantedFlags[room] != 0; }
+	// Distance from the last position to the box of a room, 0 inside it
+	float Distance(int room) const { return distances[room]; }
+
+	static float loadDistance;
+	static float unloadDistance;
+	// CPU (file data, JSON, geometry) and GPU (textures, buffers) bytes the scene may use, 0 = no limit
+	static size_t cpuBudget;
+	static size_t gpuBudget;
+	// When false every room is loaded at start and stays
+	static bool enabled;
+	static StreamingCounters stats;
+
+private:
+	std::vector<SceneRoom> rooms;
+	std::vector<float> distances;
+	std::vector<float> priorities;
+	std::vector<char> wantedFlags;
+	std::vector<int> wanted;
+	// Rooms this far or farther aren't loaded while memory is over budget
+	float budgetDistance;
+};
+#endif
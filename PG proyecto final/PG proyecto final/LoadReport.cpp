@@ -0,0 +1,197 @@
+#include"LoadReport.h"
+#include<json/json.h>
+#include<algorithm>
+#include<fstream>
+#include<iomanip>
+#include<iostream>
+
+std::string LoadReport::current;
+std::atomic<int> LoadReport::inFlight(0);
+std::atomic<bool> LoadReport::enabled(true);
+std::mutex LoadReport::mutex;
+std::map<std::string, AssetLoadStats> LoadReport::assets;
+
+static double textureMs(const TextureLoadStats& texture)
+{
+	double ms = 0.0;
+	for (const LoadStageStats& stage : texture.stages)
+		ms += stage.ms;
+	return ms;
+}
+
+double AssetLoadStats::TotalMs() const
+{
+	double ms = 0.0;
+	for (const LoadStageStats& stage : stages)
+		ms += stage.ms;
+	return ms;
+}
+
+// Adds to a stage of an asset (and of one of its textures when image is given). Can be called from any thread
+void LoadReport::Add(const std::string& asset, LoadStage stage, double ms, size_t bytes, const std::string& image)
+{
+	if (!enabled || asset.empty())
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	AssetLoadStats& stats = assets[asset];
+	stats.asset = asset;
+	stats.stages[stage].ms += ms;
+	stats.stages[stage].bytes += bytes;
+	stats.stages[stage].count++;
+	if (image.empty())
+		return;
+
+	auto texture = std::find_if(stats.textures.begin(), stats.textures.end(),
+		[&](const TextureLoadStats& entry) { return entry.image == image; });
+	if (texture == stats.textures.end())
+	{
+		stats.textures.push_back(TextureLoadStats());
+		texture = stats.textures.end() - 1;
+		texture->image = image;
+	}
+	texture->stages[stage].ms += ms;
+	texture->stages[stage].bytes += bytes;
+	texture->stages[stage].count++;
+}
+
+void LoadReport::AddWallTime(const std::string& asset, double ms)
+{
+	if (!enabled || asset.empty())
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	AssetLoadStats& stats = assets[asset];
+	stats.asset = asset;
+	stats.wallMs += ms;
+}
+
+const char* LoadReport::StageName(LoadStage stage)
+{
+	switch (stage)
+	{
+	case StageJsonParse: return "json_parse";
+	case StageBufferRead: return "buffer_read";
+	case StageAccessorDecode: return "accessor_decode";
+	case StageVertexAssembly: return "vertex_assembly";
+	case StageTextureDecode: return "texture_decode";
+	case StageMipGeneration: return "mip_generation";
+	case StageGpuUpload: return "gpu_upload";
+	default: return "unknown";
+	}
+}
+
+// Every asset, slowest first
+std::vector<AssetLoadStats> LoadReport::Assets()
+{
+	std::vector<AssetLoadStats> sorted;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& entry : assets)
+			sorted.push_back(entry.second);
+	}
+	std::sort(sorted.begin(), sorted.end(),
+		[](const AssetLoadStats& a, const AssetLoadStats& b) { return a.TotalMs() > b.TotalMs(); });
+	for (AssetLoadStats& asset : sorted)
+	{
+		std::sort(asset.textures.begin(), asset.textures.end(),
+			[](const TextureLoadStats& a, const TextureLoadStats& b) { return textureMs(a) > textureMs(b); });
+	}
+	return sorted;
+}
+
+void LoadReport::Print()
+{
+	static const char* headers[StageCount] = { "parse", "buffers", "accessors", "vertices", "decode", "mips", "upload" };
+	std::vector<AssetLoadStats> sorted = Assets();
+
+	std::cout << "LOAD: " << std::left << std::setw(44) << "asset (ms)" << std::right << std::setw(9) << "wall";
+	for (const char* header : headers)
+		std::cout << std::setw(10) << header;
+	std::cout << std::setw(10) << "total" << std::setw(10) << "MB" << std::endl;
+
+	double total = 0.0;
+	for (const AssetLoadStats& asset : sorted)
+	{
+		size_t bytes = 0;
+		std::cout << "LOAD: " << std::left << std::setw(44) << asset.asset << std::right << std::fixed << std::setprecision(1)
+			<< std::setw(9) << asset.wallMs;
+		for (const LoadStageStats& stage : asset.stages)
+		{
+			std::cout << std::setw(10) << stage.ms;
+			bytes += stage.bytes;
+		}
+		std::cout << std::setw(10) << asset.TotalMs() << std::setw(10) << bytes / (1024.0 * 1024.0) << std::defaultfloat << std::endl;
+		total += asset.TotalMs();
+
+		// Textures of the asset, slowest first
+		for (const TextureLoadStats& texture : asset.textures)
+		{
+			std::cout << "LOAD:   " << std::left << std::setw(42) << texture.image << std::right << std::fixed << std::setprecision(1)
+				<< std::setw(9) << "" << std::setw(10 * StageTextureDecode) << "";
+			for (int stage = StageTextureDecode; stage < StageCount; stage++)
+				std::cout << std::setw(10) << texture.stages[stage].ms;
+			std::cout << std::setw(10) << textureMs(texture) << std::defaultfloat << std::endl;
+		}
+	}
+	std::cout << "LOAD: " << sorted.size() << " assets, " << std::fixed << std::setprecision(1) << total
+		<< " ms of loading work over every thread" << std::defaultfloat << std::endl;
+}
+
+static nlohmann::ordered_json stagesJson(const LoadStageStats* stages)
+{
+	nlohmann::ordered_json out = nlohmann::ordered_json::object();
+	for (int stage = 0; stage < StageCount; stage++)
+	{
+		if (stages[stage].count == 0)
+			continue;
+		nlohmann::ordered_json& entry = out[LoadReport::StageName((LoadStage)stage)];
+		entry["ms"] = stages[stage].ms;
+		entry["bytes"] = stages[stage].bytes;
+		entry["count"] = stages[stage].count;
+	}
+	return out;
+}
+
+bool LoadReport::Write(const std::string& file)
+{
+	nlohmann::ordered_json out;
+	out["assets"] = nlohmann::ordered_json::array();
+	for (const AssetLoadStats& asset : Assets())
+	{
+		nlohmann::ordered_json entry;
+		entry["asset"] = asset.asset;
+		entry["wall_ms"] = asset.wallMs;
+		entry["total_ms"] = asset.TotalMs();
+		entry["stages"] = stagesJson(asset.stages);
+		entry["textures"] = nlohmann::ordered_json::array();
+		for (const TextureLoadStats& texture : asset.textures)
+		{
+			nlohmann::ordered_json textureEntry;
+			textureEntry["image"] = texture.image;
+			textureEntry["total_ms"] = textureMs(texture);
+			textureEntry["stages"] = stagesJson(texture.stages);
+			entry["textures"].push_back(textureEntry);
+		}
+		out["assets"].push_back(entry);
+	}
+
+	std::ofstream stream(file);
+	if (!stream)
+	{
+		std::cerr << "ERROR: Failed to write " << file << std::endl;
+		return false;
+	}
+	stream << out.dump(2) << std::endl;
+	std::cout << "LOAD: report written to " << file << std::endl;
+	return true;
+}
+
+LoadTimer::LoadTimer(const std::string& asset, LoadStage stage, const std::string& image)
+	: asset(asset), stage(stage), image(image), start(std::chrono::high_resolution_clock::now())
+{
+}
+
+LoadTimer::~LoadTimer()
+{
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	LoadReport::Add(asset, stage, ms, bytes, image);
+}
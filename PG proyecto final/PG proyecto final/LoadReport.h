@@ -0,0 +1,92 @@
+#ifndef LOAD_REPORT_CLASS_H
+#define LOAD_REPORT_CLASS_H
+
+#include<atomic>
+#include<chrono>
+#include<map>
+#include<mutex>
+#include<string>
+#include<vector>
+
+// Stages an asset goes through while loading, in pipeline order
+enum LoadStage
+{
+	StageJsonParse,
+	StageBufferRead,
+	StageAccessorDecode,
+	StageVertexAssembly,
+	StageTextureDecode,
+	StageMipGeneration,
+	StageGpuUpload,
+	StageCount
+};
+
+// Time and bytes spent in one stage
+struct LoadStageStats
+{
+	double ms = 0.0;
+	size_t bytes = 0;
+	unsigned int count = 0;
+};
+
+// Load stages of one texture of an asset
+struct TextureLoadStats
+{
+	std::string image;
+	LoadStageStats stages[StageCount];
+};
+
+struct AssetLoadStats
+{
+	std::string asset;
+	// Time the loading thread spent in the constructor, the texture stages run on other threads
+	double wallMs = 0.0;
+	LoadStageStats stages[StageCount];
+	std::vector<TextureLoadStats> textures;
+
+	// Sum of the stage times over every thread
+	double TotalMs() const;
+};
+
+// Where the load time of every asset goes, reported once the textures have finished streaming
+class LoadReport
+{
+public:
+	// Adds to a stage of an asset (and of one of its textures when image is given). Can be called from any thread
+	static void Add(const std::string& asset, LoadStage stage, double ms, size_t bytes, const std::string& image = std::string());
+	static void AddWallTime(const std::string& asset, double ms);
+
+	// Asset the loading thread is working on, picked up by the textures and meshes it creates
+	static std::string current;
+	// Texture decodes (loaders and residency) queued on the workers that haven't handed their levels to the streamer yet
+	static std::atomic<int> inFlight;
+	// Loads made while false (the perf suite reloading assets) are not reported
+	static std::atomic<bool> enabled;
+
+	static const char* StageName(LoadStage stage);
+	// Every asset, slowest first
+	static std::vector<AssetLoadStats> Assets();
+	static void Print();
+	static bool Write(const std::string& file);
+
+private:
+	static std::mutex mutex;
+	static std::map<std::string, AssetLoadStats> assets;
+};
+
+// Adds the time until it goes out of scope to a stage of an asset, set 'bytes' to what the stage produced
+class LoadTimer
+{
+public:
+	LoadTimer(const std::string& asset, LoadStage stage, const std::string& image = std::string());
+	~LoadTimer();
+
+	size_t bytes = 0;
+
+private:
+	std::string asset;
+	LoadStage stage;
+	std::string image;
+	std::chrono::high_resolution_clock::time_point start;
+};
+#endif
@@ -0,0 +1,150 @@
+#include"MemoryTracker.h"
+#include<json/json.h>
+#include<algorithm>
+#include<fstream>
+#include<iomanip>
+#include<iostream>
+
+std::mutex MemoryTracker::mutex;
+std::map<std::string, AssetMemory> MemoryTracker::assets;
+size_t MemoryTracker::totals[MemoryCategoryCount] = {};
+bool MemoryTracker::changed = false;
+std::vector<AssetMemory> MemoryTracker::sorted;
+
+size_t AssetMemory::Total() const
+{
+	size_t total = 0;
+	for (size_t categoryBytes : bytes)
+		total += categoryBytes;
+	return total;
+}
+
+// Adds memory to an asset, allocations without an asset are kept under "other". Can be called from any thread
+void MemoryTracker::Add(const std::string& asset, MemoryCategory category, size_t bytes)
+{
+	if (bytes == 0)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	const std::string& key = asset.empty() ? std::string("other") : asset;
+	AssetMemory& memory = assets[key];
+	memory.asset = key;
+	memory.bytes[category] += bytes;
+	totals[category] += bytes;
+	changed = true;
+}
+
+void MemoryTracker::Release(const std::string& asset, MemoryCategory category, size_t bytes)
+{
+	if (bytes == 0)
+		return;
+	std::lock_guard<std::mutex> lock(mutex);
+	auto memory = assets.find(asset.empty() ? std::string("other") : asset);
+	if (memory == assets.end())
+		return;
+	bytes = std::min(bytes, memory->second.bytes[category]);
+	memory->second.bytes[category] -= bytes;
+	totals[category] -= bytes;
+	if (memory->second.Total() == 0)
+		assets.erase(memory);
+	changed = true;
+}
+
+size_t MemoryTracker::Total(MemoryCategory category)
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	return totals[category];
+}
+
+const char* MemoryTracker::CategoryName(MemoryCategory category)
+{
+	switch (category)
+	{
+	case MemoryTextures: return "gpu_textures";
+	case MemoryBuffers: return "gpu_buffers";
+	case MemoryFileData: return "cpu_file_data";
+	case MemoryJson: return "cpu_json";
+	case MemoryGeometry: return "cpu_geometry";
+	default: return "unknown";
+	}
+}
+
+// Render thread: every asset, largest first. Only rebuilt after something changed, so the overlay can read it every frame
+const std::vector<AssetMemory>& MemoryTracker::Assets()
+{
+	std::lock_guard<std::mutex> lock(mutex);
+	if (changed)
+	{
+		sorted.clear();
+		for (const auto& entry : assets)
+			sorted.push_back(entry.second);
+		std::sort(sorted.begin(), sorted.end(),
+			[](const AssetMemory& a, const AssetMemory& b) { return a.Total() > b.Total(); });
+		changed = false;
+	}
+	return sorted;
+}
+
+static double megabytes(size_t bytes)
+{
+	return bytes / (1024.0 * 1024.0);
+}
+
+// Dumps the totals and every asset to the console
+void MemoryTracker::Print()
+{
+	static const char* headers[MemoryCategoryCount] = { "textures", "buffers", "file", "json", "geometry" };
+	const std::vector<AssetMemory>& list = Assets();
+
+	std::cout << "MEMORY: " << std::left << std::setw(44) << "asset (MB)" << std::right;
+	for (const char* header : headers)
+		std::cout << std::setw(10) << header;
+	std::cout << std::setw(10) << "GPU" << std::setw(10) << "CPU" << std::endl;
+
+	AssetMemory total;
+	total.asset = "total";
+	for (const AssetMemory& memory : list)
+	{
+		for (int category = 0; category < MemoryCategoryCount; category++)
+			total.bytes[category] += memory.bytes[category];
+	}
+	std::vector<const AssetMemory*> rows;
+	for (const AssetMemory& memory : list)
+		rows.push_back(&memory);
+	rows.push_back(&total);
+
+	for (const AssetMemory* memory : rows)
+	{
+		std::cout << "MEMORY: " << std::left << std::setw(44) << memory->asset << std::right << std::fixed << std::setprecision(2);
+		for (size_t bytes : memory->bytes)
+			std::cout << std::setw(10) << megabytes(bytes);
+		std::cout << std::setw(10) << megabytes(memory->Gpu()) << std::setw(10) << megabytes(memory->Cpu()) << std::defaultfloat << std::endl;
+	}
+}
+
+bool MemoryTracker::Write(const std::string& file)
+{
+	nlohmann::ordered_json out;
+	for (int category = 0; category < MemoryCategoryCount; category++)
+		out["totals"][CategoryName((MemoryCategory)category)] = Total((MemoryCategory)category);
+	out["assets"] = nlohmann::ordered_json::array();
+	for (const AssetMemory& memory : Assets())
+	{
+		nlohmann::ordered_json entry;
+		entry["asset"] = memory.asset;
+		for (int category = 0; category < MemoryCategoryCount; category++)
+			entry[CategoryName((MemoryCategory)category)] = memory.bytes[category];
+		entry["gpu"] = memory.Gpu();
+		entry["cpu"] = memory.Cpu();
+		out["assets"].push_back(entry);
+	}
+
+	std::ofstream stream(file);
+	if (!stream)
+	{
+		std::cerr << "ERROR: Failed to write " << file << std::endl;
+		return false;
+	}
+	stream << out.dump(2) << std::endl;
+	std::cout << "MEMORY: report written to " << file << std::endl;
+	return true;
+}
@@ -0,0 +1,54 @@
+#ifndef MEMORY_TRACKER_CLASS_H
+#define MEMORY_TRACKER_CLASS_H
+
+#include<map>
+#include<mutex>
+#include<string>
+#include<vector>
+
+// What the memory is used for. Textures and buffers live on the GPU, the rest are CPU copies
+enum MemoryCategory
+{
+	MemoryTextures,
+	MemoryBuffers,
+	MemoryFileData,
+	MemoryJson,
+	MemoryGeometry,
+	MemoryCategoryCount
+};
+
+struct AssetMemory
+{
+	std::string asset;
+	size_t bytes[MemoryCategoryCount] = {};
+
+	size_t Gpu() const { return bytes[MemoryTextures] + bytes[MemoryBuffers]; }
+	size_t Cpu() const { return Total() - Gpu(); }
+	size_t Total() const;
+};
+
+// Memory held by every asset (model, font, image), counted where it is allocated and released
+class MemoryTracker
+{
+public:
+	// Adds memory to an asset, allocations without an asset are kept under "other". Can be called from any thread
+	static void Add(const std::string& asset, MemoryCategory category, size_t bytes);
+	static void Release(const std::string& asset, MemoryCategory category, size_t bytes);
+
+	static size_t Total(MemoryCategory category);
+	static const char* CategoryName(MemoryCategory category);
+	// Render thread: every asset, largest first. Only rebuilt after something changed, so the overlay can read it every frame
+	static const std::vector<AssetMemory>& Assets();
+
+	// Dumps the totals and every asset to the console
+	static void Print();
+	static bool Write(const std::string& file);
+
+private:
+	static std::mutex mutex;
+	static std::map<std::string, AssetMemory> assets;
+	static size_t totals[MemoryCategoryCount];
+	static bool changed;
+	static std::vector<AssetMemory> sorted;
+};
+#endif
@@ -1,11 +1,22 @@
 #include "Mesh.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "LoadReport.h"
+#include "MemoryTracker.h"
+#include <limits>
+#include <algorithm>
 
 Mesh::Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <Texture>& textures)
 {
+	PROFILE_SCOPE("Mesh upload");
 	Mesh::vertices = vertices;
 	Mesh::indices = indices;
 	Mesh::textures = textures;
+	nameTextures();
+	computeBounds(vertices.empty() ? nullptr : &vertices[0].position, vertices.size(), sizeof(Vertex));
 
+	LoadTimer uploadTimer(LoadReport::current, StageGpuUpload);
+	uploadTimer.bytes = vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint);
 	VAO.Bind();
 	// Generates Vertex Buffer Object and links it to vertices
 	VBO VBO(vertices);
@@ -20,6 +31,87 @@ Mesh::Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::v
 	VAO.Unbind();
 	VBO.Unbind();
 	EBO.Unbind();
+	vertexBuffer = VBO.ID;
+	indexBuffer = EBO.ID;
+	RenderStats::bufferBytes += vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint);
+	MemoryTracker::Add(LoadReport::current, MemoryBuffers, vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint));
+}
+
+Mesh::Mesh(std::vector <unsigned char>& packedVertices, const VertexFormat& format, const std::vector <glm::vec3>& positions,
+	std::vector <GLuint>& indices, std::vector <Texture>& textures)
+{
+	PROFILE_SCOPE("Mesh upload");
+	Mesh::packedVertices = packedVertices;
+	Mesh::format = format;
+	Mesh::indices = indices;
+	Mesh::textures = textures;
+	nameTextures();
+	computeBounds(positions.data(), positions.size(), sizeof(glm::vec3));
+
+	LoadTimer uploadTimer(LoadReport::current, StageGpuUpload);
+	uploadTimer.bytes = packedVertices.size() + indices.size() * sizeof(GLuint);
+	VAO.Bind();
+	VBO VBO(packedVertices);
+	EBO EBO(indices);
+	// The GPU converts the attributes to floats as it reads them, the color is left to Draw
+	VAO.LinkAttrib(VBO, 0, format.position.components, format.position.type, format.stride, (void*)format.position.offset, format.position.normalized);
+	VAO.LinkAttrib(VBO, 1, format.normal.components, format.normal.type, format.stride, (void*)format.normal.offset, format.normal.normalized);
+	VAO.LinkAttrib(VBO, 3, format.texUV.components, format.texUV.type, format.stride, (void*)format.texUV.offset, format.texUV.normalized);
+	VAO.Unbind();
+	VBO.Unbind();
+	EBO.Unbind();
+	vertexBuffer = VBO.ID;
+	indexBuffer = EBO.ID;
+	RenderStats::bufferBytes += packedVertices.size() + indices.size() * sizeof(GLuint);
+	MemoryTracker::Add(LoadReport::current, MemoryBuffers, packedVertices.size() + indices.size() * sizeof(GLuint));
+}
+
+// Deletes the VAO and buffers, and gives their memory back to 'asset' in the memory tracker
+void Mesh::Delete(const std::string& asset)
+{
+	size_t bytes = (packedVertices.empty() ? vertices.size() * sizeof(Vertex) : packedVertices.size()) + indices.size() * sizeof(GLuint);
+	VAO.Delete();
+	glDeleteBuffers(1, &vertexBuffer);
+	glDeleteBuffers(1, &indexBuffer);
+	vertexBuffer = 0;
+	indexBuffer = 0;
+	RenderStats::bufferBytes -= std::min(bytes, RenderStats::bufferBytes);
+	MemoryTracker::Release(asset, MemoryBuffers, bytes);
+}
+
+// Builds 'textureUniforms'
+void Mesh::nameTextures()
+{
+	// Keep track of how many of each type of textures we have
+	unsigned int numDiffuse = 0;
+	unsigned int numSpecular = 0;
+	for (const Texture& texture : textures)
+	{
+		std::string num;
+		std::string type = texture.type;
+		if (type == "diffuse")
+			num = std::to_string(numDiffuse++);
+		else if (type == "specular")
+			num = std::to_string(numSpecular++);
+		textureUniforms.push_back(type + num);
+	}
+}
+
+// Bounding sphere around the center of the box of the positions, 'stride' is in bytes
+void Mesh::computeBounds(const glm::vec3* positions, size_t count, size_t stride)
+{
+	auto position = [&](size_t i) -> const glm::vec3& { return *(const glm::vec3*)((const unsigned char*)positions + i * stride); };
+	glm::vec3 minPos(std::numeric_limits<float>::max());
+	glm::vec3 maxPos(-std::numeric_limits<float>::max());
+	for (size_t i = 0; i < count; i++)
+	{
+		minPos = glm::min(minPos, position(i));
+		maxPos = glm::max(maxPos, position(i));
+	}
+	bounds.center = count == 0 ? glm::vec3(0.0f) : (minPos + maxPos) * 0.5f;
+	bounds.radius = 0.0f;
+	for (size_t i = 0; i < count; i++)
+		bounds.radius = std::max(bounds.radius, glm::length(position(i) - bounds.center));
 }
 
 
@@ -36,24 +128,13 @@ void Mesh::Draw
 	// Bind shader to be able to access uniforms
 	shader.Activate();
 	VAO.Bind();
-
-	// Keep track of how many of each type of textures we have
-	unsigned int numDiffuse = 0;
-	unsigned int numSpecular = 0;
+	// Packed vertices have no color attribute, white is read instead
+	if (!packedVertices.empty())
+		glVertexAttrib3f(2, 1.0f, 1.0f, 1.0f);
 
 	for (unsigned int i = 0; i < textures.size(); i++)
 	{
-		std::string num;
-		std::string type = textures[i].type;
-		if (type == "diffuse")
-		{
-			num = std::to_string(numDiffuse++);
-		}
-		else if (type == "specular")
-		{
-			num = std::to_string(numSpecular++);
-		}
-		textures[i].texUnit(shader, (type + num).c_str(), i);
+		textures[i].texUnit(shader, textureUniforms[i].c_str(), i);
 		textures[i].Bind();
 	}
 	// Take care of the camera Matrix
@@ -78,4 +159,6 @@ void Mesh::Draw
 
 	// Draw the actual mesh
 	glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+	RenderStats::frame.drawCalls++;
+	RenderStats::frame.triangles += indices.size() / 3;
 }
\ No newline at end of file
@@ -8,17 +8,37 @@
 #include"Camera.h"
 #include"Texture.h"
 
+// Sphere enclosing a mesh, used to estimate how big it is on screen
+struct BoundingSphere
+{
+	glm::vec3 center;
+	float radius;
+};
+
 class Mesh
 {
 public:
 	std::vector <Vertex> vertices;
+	// Vertices kept in the types the file stored them in (described by 'format'), used instead of 'vertices'
+	std::vector <unsigned char> packedVertices;
+	VertexFormat format = {};
 	std::vector <GLuint> indices;
 	std::vector <Texture> textures;
+	// Sampler uniform of each texture ("diffuse0", "specular0"...), built once instead of every draw
+	std::vector <std::string> textureUniforms;
 	// Store VAO in public so it can be used in the Draw function
 	VAO VAO;
+	// Buffers the VAO reads from, kept so the mesh can be deleted
+	GLuint vertexBuffer = 0;
+	GLuint indexBuffer = 0;
+	// Bounds of the vertices in mesh space
+	BoundingSphere bounds;
 
 	// Initializes the mesh
 	Mesh(std::vector <Vertex>& vertices, std::vector <GLuint>& indices, std::vector <Texture>& textures);
+	// Initializes a mesh with packed vertices, 'positions' are only used for the bounds
+	Mesh(std::vector <unsigned char>& packedVertices, const VertexFormat& format, const std::vector <glm::vec3>& positions,
+		std::vector <GLuint>& indices, std::vector <Texture>& textures);
 
 	// Draws the mesh
 	void Draw
@@ -30,5 +50,13 @@ public:
 		glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
 		glm::vec3 scale = glm::vec3(1.0f, 1.0f, 1.0f)
 	);
+	// Deletes the VAO and buffers, and gives their memory back to 'asset' in the memory tracker
+	void Delete(const std::string& asset);
+
+private:
+	// Builds 'textureUniforms'
+	void nameTextures();
+	// Bounding sphere around the center of the box of the positions, 'stride' is in bytes
+	void computeBounds(const glm::vec3* positions, size_t count, size_t stride);
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,548 @@
+#include"MeshoptDecoder.h"
+#include<algorithm>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define MESHOPT_USE_SSE2
+#endif
+
+// Vertex codec: blocks of up to 256 vertices (and 8 KB), each byte of the vertex stored as groups of 16
+static const size_t byteGroupSize = 16;
+static const size_t vertexBlockSizeBytes = 8192;
+static const size_t vertexBlockMaxSize = 256;
+static const size_t tailMaxSize = 32;
+
+static size_t vertexBlockSize(size_t stride)
+{
+	size_t result = (vertexBlockSizeBytes / stride) & ~(byteGroupSize - 1);
+	return std::min(result, vertexBlockMaxSize);
+}
+
+// A group of 16 bytes stored with 0, 2, 4 or 8 bits each, most significant bits first. 2 and 4 bit values
+// equal to the largest one (3 or 15) stand for a full byte, stored after the packed bits
+static const unsigned char* decodeBytesGroup(const unsigned char* data, unsigned char* buffer, int bitsLog2)
+{
+	if (bitsLog2 == 0)
+	{
+		std::memset(buffer, 0, byteGroupSize);
+		return data;
+	}
+	if (bitsLog2 == 3)
+	{
+		std::memcpy(buffer, data, byteGroupSize);
+		return data + byteGroupSize;
+	}
+
+	unsigned int bits = 1u << bitsLog2;
+	unsigned int escape = (1u << bits) - 1;
+	const unsigned char* extra = data + byteGroupSize * bits / 8;
+	for (unsigned int i = 0; i < byteGroupSize; i++)
+	{
+		unsigned int shift = 8 - bits - (i * bits) % 8;
+		unsigned int value = (data[i * bits / 8] >> shift) & escape;
+		buffer[i] = value == escape ? *extra++ : (unsigned char)value;
+	}
+	return extra;
+}
+
+// 'size' bytes (a multiple of 16) behind a header of 2 bits per group, nullptr if the data runs out
+static const unsigned char* decodeBytes(const unsigned char* data, const unsigned char* end, unsigned char* buffer, size_t size)
+{
+	size_t headerSize = (size / byteGroupSize + 3) / 4;
+	if ((size_t)(end - data) < headerSize)
+		return nullptr;
+	const unsigned char* header = data;
+	data += headerSize;
+
+	for (size_t i = 0; i < size; i += byteGroupSize)
+	{
+		// A group reads at most 24 bytes (8 of packed bits and 16 escapes), the tail keeps that inside the data
+		if ((size_t)(end - data) < 24)
+			return nullptr;
+		size_t group = i / byteGroupSize;
+		data = decodeBytesGroup(data, buffer + i, (header[group / 4] >> ((group % 4) * 2)) & 3);
+	}
+	return data;
+}
+
+// Each byte is a zigzag encoded delta from the same byte of the previous vertex, 'previous' is the one before the block.
+// 'size' is a multiple of 16
+static void decodeDeltas(unsigned char* buffer, size_t size, unsigned char previous)
+{
+#ifdef MESHOPT_USE_SSE2
+	// 16 vertices at a time: unzigzag, then a prefix sum in four shifted adds
+	const __m128i one = _mm_set1_epi8(1);
+	const __m128i lowBits = _mm_set1_epi8(0x7f);
+	__m128i running = _mm_set1_epi8((char)previous);
+	for (size_t i = 0; i < size; i += byteGroupSize)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(buffer + i));
+		__m128i half = _mm_and_si128(_mm_srli_epi16(v, 1), lowBits);
+		v = _mm_xor_si128(half, _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, one)));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+		v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+		v = _mm_add_epi8(v, running);
+		_mm_storeu_si128((__m128i*)(buffer + i), v);
+		// Broadcast the last byte for the next group
+		running = _mm_unpackhi_epi8(v, v);
+		running = _mm_unpackhi_epi16(running, running);
+		running = _mm_shuffle_epi32(running, _MM_SHUFFLE(3, 3, 3, 3));
+	}
+#else
+	for (size_t i = 0; i < size; i++)
+	{
+		unsigned char delta = buffer[i];
+		previous = (unsigned char)(previous + ((delta >> 1) ^ (0 - (delta & 1))));
+		buffer[i] = previous;
+	}
+#endif
+}
+
+static const unsigned char* decodeVertexBlock(const unsigned char* data, const unsigned char* end,
+	unsigned char* vertices, size_t vertexCount, size_t stride, unsigned char* last)
+{
+	unsigned char buffer[vertexBlockMaxSize];
+	size_t alignedCount = (vertexCount + byteGroupSize - 1) & ~(byteGroupSize - 1);
+
+	// The bytes are stored transposed: byte 0 of every vertex, then byte 1...
+	for (size_t k = 0; k < stride; k++)
+	{
+		data = decodeBytes(data, end, buffer, alignedCount);
+		if (!data)
+			return nullptr;
+		decodeDeltas(buffer, alignedCount, last[k]);
+		for (size_t i = 0; i < vertexCount; i++)
+			vertices[i * stride + k] = buffer[i];
+		last[k] = buffer[vertexCount - 1];
+	}
+	return data;
+}
+
+// ATTRIBUTES mode: 'count' elements of 'stride' bytes (a multiple of 4, at most 256)
+bool MeshoptDecoder::DecodeVertexBuffer(unsigned char* destination, size_t count, size_t stride, const unsigned char* source, size_t sourceSize)
+{
+	if (stride == 0 || stride > 256 || stride % 4 != 0)
+		return false;
+	// Header byte 0xa0 (version 0), the blocks, then a tail whose last 'stride' bytes are the first delta base
+	size_t tailSize = std::max(stride, tailMaxSize);
+	if (sourceSize < 1 + tailSize || source[0] != 0xa0)
+		return false;
+
+	unsigned char last[256];
+	std::memcpy(last, source + sourceSize - stride, stride);
+	const unsigned char* data = source + 1;
+	const unsigned char* end = source + sourceSize;
+	size_t blockSize = vertexBlockSize(stride);
+	for (size_t offset = 0; offset < count; offset += blockSize)
+	{
+		data = decodeVertexBlock(data, end, destination + offset * stride, std::min(blockSize, count - offset), stride, last);
+		if (!data)
+			return false;
+	}
+	return (size_t)(end - data) == tailSize;
+}
+
+static void writeIndex(unsigned char* destination, size_t i, size_t indexSize, unsigned int index)
+{
+	if (indexSize == 2)
+	{
+		uint16_t value = (uint16_t)index;
+		std::memcpy(destination + i * 2, &value, 2);
+	}
+	else
+		std::memcpy(destination + i * 4, &index, 4);
+}
+
+// Variable length integer, 7 bits per byte with the top bit set while more follow
+static unsigned int decodeVByte(const unsigned char*& data)
+{
+	unsigned char lead = *data++;
+	if (lead < 128)
+		return lead;
+	unsigned int result = lead & 127;
+	unsigned int shift = 7;
+	for (int i = 0; i < 4; i++)
+	{
+		unsigned char group = *data++;
+		result |= (unsigned int)(group & 127) << shift;
+		shift += 7;
+		if (group < 128)
+			break;
+	}
+	return result;
+}
+
+// Index stored as a zigzag delta from the last one stored this way
+static unsigned int decodeIndex(const unsigned char*& data, unsigned int last)
+{
+	unsigned int v = decodeVByte(data);
+	return last + ((v >> 1) ^ (0 - (v & 1)));
+}
+
+// FIFOs the encoder and decoder fill in the same order, triangles refer back to their entries
+struct IndexFifos
+{
+	unsigned int edges[16][2];
+	unsigned int vertices[16];
+	size_t edgeOffset = 0;
+	size_t vertexOffset = 0;
+
+	IndexFifos()
+	{
+		std::memset(edges, -1, sizeof(edges));
+		std::memset(vertices, -1, sizeof(vertices));
+	}
+	void PushEdge(unsigned int a, unsigned int b)
+	{
+		edges[edgeOffset][0] = a;
+		edges[edgeOffset][1] = b;
+		edgeOffset = (edgeOffset + 1) & 15;
+	}
+	void PushVertex(unsigned int v, bool push = true)
+	{
+		vertices[vertexOffset] = v;
+		vertexOffset = (vertexOffset + (push ? 1 : 0)) & 15;
+	}
+};
+
+// TRIANGLES mode: 'count' indices of 'indexSize' (2 or 4) bytes forming a triangle list
+bool MeshoptDecoder::DecodeIndexBuffer(unsigned char* destination, size_t count, size_t indexSize, const unsigned char* source, size_t sourceSize)
+{
+	if (count % 3 != 0 || (indexSize != 2 && indexSize != 4))
+		return false;
+	// Header byte 0xe0 or 0xe1, a code byte per triangle, the extra data, then a 16 byte table of common codes
+	if (sourceSize < 1 + count / 3 + 16 || (source[0] & 0xf0) != 0xe0 || (source[0] & 0x0f) > 1)
+		return false;
+	int version = source[0] & 0x0f;
+
+	IndexFifos fifos;
+	unsigned int next = 0;
+	unsigned int last = 0;
+	// Version 1 also stores indices one away from the last explicit one without extra bytes
+	unsigned int fifoCodes = version >= 1 ? 13 : 15;
+	const unsigned char* code = source + 1;
+	const unsigned char* data = code + count / 3;
+	const unsigned char* safeEnd = source + sourceSize - 16;
+	const unsigned char* codeTable = safeEnd;
+
+	for (size_t i = 0; i < count; i += 3)
+	{
+		// A triangle reads at most 16 bytes, which the table after safeEnd keeps inside the data
+		if (data > safeEnd)
+			return false;
+		unsigned char codeTri = *code++;
+
+		if (codeTri < 0xf0)
+		{
+			// Edge from the FIFO and a third vertex that is new, from the FIFO, or explicit
+			unsigned int edge = codeTri >> 4;
+			unsigned int a = fifos.edges[(fifos.edgeOffset - 1 - edge) & 15][0];
+			unsigned int b = fifos.edges[(fifos.edgeOffset - 1 - edge) & 15][1];
+			unsigned int vertex = codeTri & 15;
+			unsigned int c;
+			if (vertex < fifoCodes)
+			{
+				c = vertex == 0 ? next++ : fifos.vertices[(fifos.vertexOffset - 1 - vertex) & 15];
+				fifos.PushVertex(c, vertex == 0);
+			}
+			else
+			{
+				// 13 and 14 are the last explicit index -1 and +1
+				last = c = vertex != 15 ? last + (vertex == 13 ? -1 : 1) : decodeIndex(data, last);
+				fifos.PushVertex(c);
+			}
+			writeIndex(destination, i + 0, indexSize, a);
+			writeIndex(destination, i + 1, indexSize, b);
+			writeIndex(destination, i + 2, indexSize, c);
+			fifos.PushEdge(c, b);
+			fifos.PushEdge(a, c);
+			continue;
+		}
+
+		unsigned int a, b, c;
+		bool pushB, pushC;
+		if (codeTri < 0xfe)
+		{
+			// No shared edge, a is new and b/c are new or from the FIFO as the table says
+			unsigned char codeAux = codeTable[codeTri & 15];
+			unsigned int fb = codeAux >> 4;
+			unsigned int fc = codeAux & 15;
+			a = next++;
+			b = fb == 0 ? next++ : fifos.vertices[(fifos.vertexOffset - fb) & 15];
+			c = fc == 0 ? next++ : fifos.vertices[(fifos.vertexOffset - fc) & 15];
+			pushB = fb == 0;
+			pushC = fc == 0;
+		}
+		else
+		{
+			// Same with the code in the data and explicit indices allowed, a zero code restarts the new vertex counter
+			unsigned char codeAux = *data++;
+			unsigned int fa = codeTri == 0xfe ? 0 : 15;
+			unsigned int fb = codeAux >> 4;
+			unsigned int fc = codeAux & 15;
+			if (codeAux == 0)
+				next = 0;
+			a = fa == 0 ? next++ : 0;
+			b = fb == 0 ? next++ : fifos.vertices[(fifos.vertexOffset - fb) & 15];
+			c = fc == 0 ? next++ : fifos.vertices[(fifos.vertexOffset - fc) & 15];
+			if (fa == 15)
+				last = a = decodeIndex(data, last);
+			if (fb == 15)
+				last = b = decodeIndex(data, last);
+			if (fc == 15)
+				last = c = decodeIndex(data, last);
+			pushB = fb == 0 || fb == 15;
+			pushC = fc == 0 || fc == 15;
+		}
+		writeIndex(destination, i + 0, indexSize, a);
+		writeIndex(destination, i + 1, indexSize, b);
+		writeIndex(destination, i + 2, indexSize, c);
+		fifos.PushVertex(a);
+		fifos.PushVertex(b, pushB);
+		fifos.PushVertex(c, pushC);
+		fifos.PushEdge(b, a);
+		fifos.PushEdge(c, b);
+		fifos.PushEdge(a, c);
+	}
+	// Everything up to the table has to be used
+	return data == safeEnd;
+}
+
+// INDICES mode: 'count' indices of 'indexSize' bytes in any order
+bool MeshoptDecoder::DecodeIndexSequence(unsigned char* destination, size_t count, size_t indexSize, const unsigned char* source, size_t sourceSize)
+{
+	if (indexSize != 2 && indexSize != 4)
+		return false;
+	// Header byte 0xd0 or 0xd1, a varint per index, then a 4 byte tail
+	if (sourceSize < 1 + count + 4 || (source[0] & 0xf0) != 0xd0 || (source[0] & 0x0f) > 1)
+		return false;
+
+	const unsigned char* data = source + 1;
+	const unsigned char* safeEnd = source + sourceSize - 4;
+	// Each index is a zigzag delta from one of two previous indices, the lowest bit says which
+	unsigned int last[2] = { 0, 0 };
+	for (size_t i = 0; i < count; i++)
+	{
+		if (data >= safeEnd)
+			return false;
+		unsigned int v = decodeVByte(data);
+		unsigned int base = v & 1;
+		v >>= 1;
+		last[base] += (v >> 1) ^ (0 - (v & 1));
+		writeIndex(destination, i, indexSize, last[base]);
+	}
+	return data == safeEnd;
+}
+
+template<typename T>
+static T readComponent(const unsigned char* data, size_t i)
+{
+	T value;
+	std::memcpy(&value, data + i * sizeof(T), sizeof(T));
+	return value;
+}
+
+template<typename T>
+static void writeComponent(unsigned char* data, size_t i, T value)
+{
+	std::memcpy(data + i * sizeof(T), &value, sizeof(T));
+}
+
+static int roundSigned(float value)
+{
+	return (int)(value + (value >= 0.0f ? 0.5f : -0.5f));
+}
+
+// Unit vectors: x and y on an octahedron, z holds the length they were stored at, w is left as is.
+// T is int8_t or int16_t
+template<typename T>
+static void decodeOctahedral(unsigned char* data, size_t count)
+{
+	const float maximum = (float)((1 << (sizeof(T) * 8 - 1)) - 1);
+	size_t i = 0;
+#ifdef MESHOPT_USE_SSE2
+	// Four vectors at a time, rounded the same way as the loop below
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	for (; i + 4 <= count; i += 4)
+	{
+		float xs[4], ys[4], zs[4];
+		for (size_t j = 0; j < 4; j++)
+		{
+			xs[j] = (float)readComponent<T>(data, (i + j) * 4 + 0);
+			ys[j] = (float)readComponent<T>(data, (i + j) * 4 + 1);
+			zs[j] = (float)readComponent<T>(data, (i + j) * 4 + 2);
+		}
+		__m128 x = _mm_loadu_ps(xs);
+		__m128 y = _mm_loadu_ps(ys);
+		__m128 z = _mm_sub_ps(_mm_sub_ps(_mm_loadu_ps(zs), _mm_andnot_ps(sign, x)), _mm_andnot_ps(sign, y));
+		// Folds the lower half of the octahedron back
+		__m128 t = _mm_min_ps(z, _mm_setzero_ps());
+		x = _mm_add_ps(x, _mm_xor_ps(t, _mm_and_ps(x, sign)));
+		y = _mm_add_ps(y, _mm_xor_ps(t, _mm_and_ps(y, sign)));
+		__m128 length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+		__m128 scale = _mm_div_ps(_mm_set1_ps(maximum), length);
+		x = _mm_mul_ps(x, scale);
+		y = _mm_mul_ps(y, scale);
+		z = _mm_mul_ps(z, scale);
+		int xi[4], yi[4], zi[4];
+		_mm_storeu_si128((__m128i*)xi, _mm_cvttps_epi32(_mm_add_ps(x, _mm_or_ps(half, _mm_and_ps(x, sign)))));
+		_mm_storeu_si128((__m128i*)yi, _mm_cvttps_epi32(_mm_add_ps(y, _mm_or_ps(half, _mm_and_ps(y, sign)))));
+		_mm_storeu_si128((__m128i*)zi, _mm_cvttps_epi32(_mm_add_ps(z, _mm_or_ps(half, _mm_and_ps(z, sign)))));
+		for (size_t j = 0; j < 4; j++)
+		{
+			writeComponent<T>(data, (i + j) * 4 + 0, (T)xi[j]);
+			writeComponent<T>(data, (i + j) * 4 + 1, (T)yi[j]);
+			writeComponent<T>(data, (i + j) * 4 + 2, (T)zi[j]);
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		float x = (float)readComponent<T>(data, i * 4 + 0);
+		float y = (float)readComponent<T>(data, i * 4 + 1);
+		float z = (float)readComponent<T>(data, i * 4 + 2) - std::fabs(x) - std::fabs(y);
+		float t = z < 0.0f ? z : 0.0f;
+		x += x >= 0.0f ? t : -t;
+		y += y >= 0.0f ? t : -t;
+		float scale = maximum / std::sqrt(x * x + y * y + z * z);
+		writeComponent<T>(data, i * 4 + 0, (T)roundSigned(x * scale));
+		writeComponent<T>(data, i * 4 + 1, (T)roundSigned(y * scale));
+		writeComponent<T>(data, i * 4 + 2, (T)roundSigned(z * scale));
+	}
+}
+
+// Rotations as 16 bit xyzw: three components, the largest one is rebuilt. The 4th short holds its index and the scale
+static void decodeQuaternion(unsigned char* data, size_t count)
+{
+	const float scale = 1.0f / std::sqrt(2.0f);
+	size_t i = 0;
+#ifdef MESHOPT_USE_SSE2
+	const __m128 sign = _mm_set1_ps(-0.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 maximum = _mm_set1_ps(32767.0f);
+	for (; i + 4 <= count; i += 4)
+	{
+		float xs[4], ys[4], zs[4], ss[4];
+		for (size_t j = 0; j < 4; j++)
+		{
+			ss[j] = scale / (float)(readComponent<int16_t>(data, (i + j) * 4 + 3) | 3);
+			xs[j] = (float)readComponent<int16_t>(data, (i + j) * 4 + 0);
+			ys[j] = (float)readComponent<int16_t>(data, (i + j) * 4 + 1);
+			zs[j] = (float)readComponent<int16_t>(data, (i + j) * 4 + 2);
+		}
+		__m128 s = _mm_loadu_ps(ss);
+		__m128 x = _mm_mul_ps(_mm_loadu_ps(xs), s);
+		__m128 y = _mm_mul_ps(_mm_loadu_ps(ys), s);
+		__m128 z = _mm_mul_ps(_mm_loadu_ps(zs), s);
+		__m128 ww = _mm_sub_ps(_mm_sub_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(x, x)), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+		__m128 w = _mm_sqrt_ps(_mm_max_ps(ww, _mm_setzero_ps()));
+		__m128 lanes[4] = { x, y, z, w };
+		int values[4][4];
+		for (int c = 0; c < 4; c++)
+		{
+			__m128 v = _mm_mul_ps(lanes[c], maximum);
+			_mm_storeu_si128((__m128i*)values[c], _mm_cvttps_epi32(_mm_add_ps(v, _mm_or_ps(half, _mm_and_ps(v, sign)))));
+		}
+		for (size_t j = 0; j < 4; j++)
+		{
+			int order = readComponent<int16_t>(data, (i + j) * 4 + 3) & 3;
+			for (int c = 0; c < 4; c++)
+				writeComponent<int16_t>(data, (i + j) * 4 + ((order + 1 + c) & 3), (int16_t)values[c][j]);
+		}
+	}
+#endif
+	for (; i < count; i++)
+	{
+		int16_t packed = readComponent<int16_t>(data, i * 4 + 3);
+		float s = scale / (float)(packed | 3);
+		float x = readComponent<int16_t>(data, i * 4 + 0) * s;
+		float y = readComponent<int16_t>(data, i * 4 + 1) * s;
+		float z = readComponent<int16_t>(data, i * 4 + 2) * s;
+		float ww = 1.0f - x * x - y * y - z * z;
+		float w = std::sqrt(ww >= 0.0f ? ww : 0.0f);
+		int order = packed & 3;
+		writeComponent<int16_t>(data, i * 4 + ((order + 1) & 3), (int16_t)roundSigned(x * 32767.0f));
+		writeComponent<int16_t>(data, i * 4 + ((order + 2) & 3), (int16_t)roundSigned(y * 32767.0f));
+		writeComponent<int16_t>(data, i * 4 + ((order + 3) & 3), (int16_t)roundSigned(z * 32767.0f));
+		writeComponent<int16_t>(data, i * 4 + ((order + 0) & 3), (int16_t)roundSigned(w * 32767.0f));
+	}
+}
+
+// Floats as a 24 bit signed mantissa and an 8 bit signed exponent
+static void decodeExponential(unsigned char* data, size_t count)
+{
+	size_t i = 0;
+#ifdef MESHOPT_USE_SSE2
+	for (; i + 4 <= count; i += 4)
+	{
+		__m128i v = _mm_loadu_si128((const __m128i*)(data + i * 4));
+		__m128i mantissa = _mm_srai_epi32(_mm_slli_epi32(v, 8), 8);
+		__m128i exponent = _mm_srai_epi32(v, 24);
+		__m128 power = _mm_castsi128_ps(_mm_slli_epi32(_mm_add_epi32(exponent, _mm_set1_epi32(127)), 23));
+		_mm_storeu_ps((float*)(data + i * 4), _mm_mul_ps(_mm_cvtepi32_ps(mantissa), power));
+	}
+#endif
+	for (; i < count; i++)
+	{
+		uint32_t v = readComponent<uint32_t>(data, i);
+		int32_t mantissa = (int32_t)(v << 8) >> 8;
+		int32_t exponent = (int32_t)v >> 24;
+		// 2^exponent built straight from the bits, like ldexp
+		uint32_t powerBits = (uint32_t)(exponent + 127) << 23;
+		float power;
+		std::memcpy(&power, &powerBits, sizeof(float));
+		writeComponent<float>(data, i, (float)mantissa * power);
+	}
+}
+
+// Runs a filter in place on decoded attributes, returns false if the stride doesn't suit it
+bool MeshoptDecoder::DecodeFilter(GltfMeshoptFilter filter, unsigned char* data, size_t count, size_t stride)
+{
+	switch (filter)
+	{
+	case MeshoptFilterNone:
+		return true;
+	case MeshoptFilterOctahedral:
+		if (stride == 4)
+			decodeOctahedral<int8_t>(data, count);
+		else if (stride == 8)
+			decodeOctahedral<int16_t>(data, count);
+		else
+			return false;
+		return true;
+	case MeshoptFilterQuaternion:
+		if (stride != 8)
+			return false;
+		decodeQuaternion(data, count);
+		return true;
+	case MeshoptFilterExponential:
+		if (stride % 4 != 0)
+			return false;
+		decodeExponential(data, count * stride / 4);
+		return true;
+	}
+	return false;
+}
+
+// Decodes a bufferView into 'destination' (compression.count * compression.byteStride bytes).
+// Returns false if the data is malformed or uses a version this decoder doesn't know
+bool MeshoptDecoder::Decode(const GltfMeshopt& compression, const unsigned char* source, size_t sourceSize, unsigned char* destination)
+{
+	switch (compression.mode)
+	{
+	case MeshoptAttributes:
+		return DecodeVertexBuffer(destination, compression.count, compression.byteStride, source, sourceSize)
+			&& DecodeFilter(compression.filter, destination, compression.count, compression.byteStride);
+	case MeshoptTriangles:
+		return DecodeIndexBuffer(destination, compression.count, compression.byteStride, source, sourceSize);
+	case MeshoptIndices:
+		return DecodeIndexSequence(destination, compression.count, compression.byteStride, source, sourceSize);
+	}
+	return false;
+}
@@ -0,0 +1,25 @@
+#ifndef MESHOPT_DECODER_CLASS_H
+#define MESHOPT_DECODER_CLASS_H
+
+#include<cstddef>
+#include"GltfDocument.h"
+
+// Decoder for the EXT_meshopt_compression bitstreams: the vertex codec, the two index codecs and the filters.
+// Every function only touches its arguments, so views can be decoded on several threads at once
+class MeshoptDecoder
+{
+public:
+	// Decodes a bufferView into 'destination' (compression.count * compression.byteStride bytes).
+	// Returns false if the data is malformed or uses a version this decoder doesn't know
+	static bool Decode(const GltfMeshopt& compression, const unsigned char* source, size_t sourceSize, unsigned char* destination);
+
+	// ATTRIBUTES mode: 'count' elements of 'stride' bytes (a multiple of 4, at most 256)
+	static bool DecodeVertexBuffer(unsigned char* destination, size_t count, size_t stride, const unsigned char* source, size_t sourceSize);
+	// TRIANGLES mode: 'count' indices of 'indexSize' (2 or 4) bytes forming a triangle list
+	static bool DecodeIndexBuffer(unsigned char* destination, size_t count, size_t indexSize, const unsigned char* source, size_t sourceSize);
+	// INDICES mode: 'count' indices of 'indexSize' bytes in any order
+	static bool DecodeIndexSequence(unsigned char* destination, size_t count, size_t indexSize, const unsigned char* source, size_t sourceSize);
+	// Runs a filter in place on decoded attributes, returns false if the stride doesn't suit it
+	static bool DecodeFilter(GltfMeshoptFilter filter, unsigned char* data, size_t count, size_t stride);
+};
+#endif
@@ -0,0 +1,235 @@
+#include"MipGenerator.h"
+#include"Profiler.h"
+#include<stb/stb_image.h>
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+#include<cstdint>
+#include<iomanip>
+#include<iostream>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define MIP_USE_SSE2
+#endif
+
+// Lookup tables to move between sRGB bytes and linear floats
+struct SrgbTables
+{
+	float toLinear[256];
+	unsigned char toSrgb[4096];
+
+	SrgbTables()
+	{
+		for (int i = 0; i < 256; i++)
+		{
+			float c = i / 255.0f;
+			toLinear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+		}
+		for (int i = 0; i < 4096; i++)
+		{
+			float l = i / 4095.0f;
+			float c = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+			toSrgb[i] = (unsigned char)std::min(255.0f, c * 255.0f + 0.5f);
+		}
+	}
+};
+
+static const SrgbTables& srgbTables()
+{
+	static SrgbTables tables;
+	return tables;
+}
+
+// Halves an image with a 2x2 box filter. For sRGB images the color channels are averaged in linear space
+void DownsampleLevel(const unsigned char* src, int srcWidth, int srcHeight,
+	unsigned char* dst, int channels, bool srgb, int rowBegin, int rowEnd)
+{
+	int dstWidth = std::max(1, srcWidth / 2);
+	int rowLength = srcWidth * channels;
+	// The alpha channel (if any) is never gamma encoded
+	int alphaChannel = (channels == 4 || channels == 2) ? channels - 1 : -1;
+
+	// Per thread scratch row holding the sum of the two source rows
+	thread_local std::vector<uint16_t> sums;
+	thread_local std::vector<float> linearSums;
+
+	for (int y = rowBegin; y < rowEnd; y++)
+	{
+		const unsigned char* row0 = src + (size_t)std::min(2 * y, srcHeight - 1) * rowLength;
+		const unsigned char* row1 = src + (size_t)std::min(2 * y + 1, srcHeight - 1) * rowLength;
+		unsigned char* out = dst + (size_t)y * dstWidth * channels;
+
+		if (!srgb)
+		{
+			// Vertical pass: add the two rows 16 bytes at a time
+			sums.resize(rowLength);
+			int i = 0;
+#ifdef MIP_USE_SSE2
+			const __m128i zero = _mm_setzero_si128();
+			for (; i + 16 <= rowLength; i += 16)
+			{
+				__m128i a = _mm_loadu_si128((const __m128i*)(row0 + i));
+				__m128i b = _mm_loadu_si128((const __m128i*)(row1 + i));
+				__m128i lo = _mm_add_epi16(_mm_unpacklo_epi8(a, zero), _mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_add_epi16(_mm_unpackhi_epi8(a, zero), _mm_unpackhi_epi8(b, zero));
+				_mm_storeu_si128((__m128i*)(sums.data() + i), lo);
+				_mm_storeu_si128((__m128i*)(sums.data() + i + 8), hi);
+			}
+#endif
+			for (; i < rowLength; i++)
+				sums[i] = row0[i] + row1[i];
+
+			// Horizontal pass: add neighbouring texels and round
+			for (int x = 0; x < dstWidth; x++)
+			{
+				const uint16_t* a = sums.data() + std::min(2 * x, srcWidth - 1) * channels;
+				const uint16_t* b = sums.data() + std::min(2 * x + 1, srcWidth - 1) * channels;
+				for (int c = 0; c < channels; c++)
+					out[x * channels + c] = (unsigned char)((a[c] + b[c] + 2) >> 2);
+			}
+		}
+		else
+		{
+			const SrgbTables& tables = srgbTables();
+			linearSums.resize(rowLength);
+			for (int i = 0; i < rowLength; i++)
+			{
+				if (i % channels == alphaChannel)
+					linearSums[i] = (row0[i] + row1[i]) / 255.0f;
+				else
+					linearSums[i] = tables.toLinear[row0[i]] + tables.toLinear[row1[i]];
+			}
+
+			for (int x = 0; x < dstWidth; x++)
+			{
+				const float* a = linearSums.data() + std::min(2 * x, srcWidth - 1) * channels;
+				const float* b = linearSums.data() + std::min(2 * x + 1, srcWidth - 1) * channels;
+				for (int c = 0; c < channels; c++)
+				{
+					float average = (a[c] + b[c]) * 0.25f;
+					if (c == alphaChannel)
+						out[x * channels + c] = (unsigned char)(average * 255.0f + 0.5f);
+					else
+						out[x * channels + c] = tables.toSrgb[(int)(average * 4095.0f + 0.5f)];
+				}
+			}
+		}
+	}
+}
+
+// Builds every level below the base image (the base itself is not copied), splitting rows across the pool
+std::vector<MipLevel> GenerateMipChain(const unsigned char* base, int width, int height,
+	int channels, bool srgb, ThreadPool& pool)
+{
+	PROFILE_SCOPE("Mip generation");
+	std::vector<MipLevel> levels;
+
+	const unsigned char* src = base;
+	int srcWidth = width;
+	int srcHeight = height;
+	while (srcWidth > 1 || srcHeight > 1)
+	{
+		MipLevel level;
+		level.width = std::max(1, srcWidth / 2);
+		level.height = std::max(1, srcHeight / 2);
+		level.pixels.resize((size_t)level.width * level.height * channels);
+		levels.push_back(std::move(level));
+
+		unsigned char* dst = levels.back().pixels.data();
+		pool.ParallelFor(levels.back().height, [&](int begin, int end)
+		{
+			DownsampleLevel(src, srcWidth, srcHeight, dst, channels, srgb, begin, end);
+		}, 32);
+
+		src = levels.back().pixels.data();
+		srcWidth = levels.back().width;
+		srcHeight = levels.back().height;
+	}
+
+	return levels;
+}
+
+// Uploads a base level and its chain to the texture bound on GL_TEXTURE_2D
+void UploadMipChain(const unsigned char* base, int width, int height, const std::vector<MipLevel>& levels,
+	GLenum internalFormat, GLenum format)
+{
+	PROFILE_SCOPE("Texture upload");
+	// Small levels have rows that are not a multiple of 4 bytes
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, base);
+	for (unsigned int i = 0; i < levels.size(); i++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, i + 1, internalFormat, levels[i].width, levels[i].height, 0,
+			format, GL_UNSIGNED_BYTE, levels[i].pixels.data());
+	}
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size());
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// Times the CPU mip generator against glGenerateMipmap for each image and prints the results
+void BenchmarkMipGeneration(const std::vector<std::string>& images)
+{
+	typedef std::chrono::high_resolution_clock Clock;
+	double totalDriver = 0.0;
+	double totalCpu = 0.0;
+
+	std::cout << "MIP BENCHMARK: " << images.size() << " images, " << ThreadPool::Shared().Size() << " worker threads" << std::endl;
+	std::cout << std::fixed << std::setprecision(2);
+
+	stbi_set_flip_vertically_on_load_thread(true);
+	for (const std::string& image : images)
+	{
+		int width, height, channels;
+		unsigned char* bytes = stbi_load(image.c_str(), &width, &height, &channels, 0);
+		if (!bytes)
+		{
+			std::cerr << "ERROR: Failed to load " << image << std::endl;
+			continue;
+		}
+
+		GLenum formats[] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		GLenum internalFormats[] = { GL_R8, GL_RG8, GL_SRGB8, GL_SRGB8_ALPHA8 };
+		GLenum format = formats[channels - 1];
+		GLenum internalFormat = internalFormats[channels - 1];
+		bool srgb = channels >= 3;
+
+		GLuint textures[2];
+		glGenTextures(2, textures);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+		// Driver path: upload the base level and let the GL build the chain
+		glFinish();
+		Clock::time_point start = Clock::now();
+		glBindTexture(GL_TEXTURE_2D, textures[0]);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, GL_UNSIGNED_BYTE, bytes);
+		glGenerateMipmap(GL_TEXTURE_2D);
+		glFinish();
+		double driverMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		// CPU path: build the chain on the workers and upload every level
+		start = Clock::now();
+		glBindTexture(GL_TEXTURE_2D, textures[1]);
+		std::vector<MipLevel> levels = GenerateMipChain(bytes, width, height, channels, srgb);
+		double generateMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		UploadMipChain(bytes, width, height, levels, internalFormat, format);
+		glFinish();
+		double cpuMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+
+		std::cout << "  " << image << " (" << width << "x" << height << "x" << channels << "): glGenerateMipmap "
+			<< driverMs << " ms, CPU " << cpuMs << " ms (" << generateMs << " ms generating)" << std::endl;
+		totalDriver += driverMs;
+		totalCpu += cpuMs;
+
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glDeleteTextures(2, textures);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		stbi_image_free(bytes);
+	}
+
+	std::cout << "MIP BENCHMARK TOTAL: glGenerateMipmap " << totalDriver << " ms, CPU " << totalCpu << " ms" << std::endl;
+	std::cout << std::defaultfloat;
+}
\ No newline at end of file
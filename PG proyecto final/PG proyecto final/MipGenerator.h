@@ -0,0 +1,33 @@
+#ifndef MIP_GENERATOR_H
+#define MIP_GENERATOR_H
+
+#include<glad/glad.h>
+#include<vector>
+#include<string>
+
+#include"ThreadPool.h"
+
+// One level of a mip chain, tightly packed 8 bit channels
+struct MipLevel
+{
+	int width;
+	int height;
+	std::vector<unsigned char> pixels;
+};
+
+// Halves an image with a 2x2 box filter. For sRGB images the color channels are averaged in linear space
+void DownsampleLevel(const unsigned char* src, int srcWidth, int srcHeight,
+	unsigned char* dst, int channels, bool srgb, int rowBegin, int rowEnd);
+
+// Builds every level below the base image (the base itself is not copied), splitting rows across the pool
+std::vector<MipLevel> GenerateMipChain(const unsigned char* base, int width, int height,
+	int channels, bool srgb, ThreadPool& pool = ThreadPool::Shared());
+
+// Uploads a base level and its chain to the texture bound on GL_TEXTURE_2D
+void UploadMipChain(const unsigned char* base, int width, int height, const std::vector<MipLevel>& levels,
+	GLenum internalFormat, GLenum format);
+
+// Times the CPU mip generator against glGenerateMipmap for each image and prints the results
+void BenchmarkMipGeneration(const std::vector<std::string>& images);
+
+#endif
\ No newline at end of file
@@ -1,19 +1,302 @@
 #include "Model.h"
+#include "Profiler.h"
+#include "LoadReport.h"
+#include "MemoryTracker.h"
+#include "MeshoptDecoder.h"
+#include "ThreadPool.h"
+#include "TextureResidency.h"
+#include "TextureStreamer.h"
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+// Whole file in one read, nullptr if it can't be read
+static std::shared_ptr<std::vector<unsigned char>> readFileBytes(const std::string& path)
+{
+    std::ifstream in(path, std::ios::binary | std::ios::ate);
+    if (!in)
+        return nullptr;
+    auto bytes = std::make_shared<std::vector<unsigned char>>((size_t)in.tellg());
+    in.seekg(0);
+    in.read((char*)bytes->data(), bytes->size());
+    return in ? bytes : nullptr;
+}
+
+// glTF binary is little endian, like every platform the gallery runs on
+static uint32_t readU32(const unsigned char* bytes)
+{
+    uint32_t value;
+    std::memcpy(&value, bytes, sizeof(value));
+    return value;
+}
+
+// Bytes of one component of an accessor, 0 for types glTF doesn't allow
+static size_t componentSize(unsigned int componentType)
+{
+    switch (componentType)
+    {
+    case 5120: case 5121: return 1; // GL_BYTE, GL_UNSIGNED_BYTE
+    case 5122: case 5123: return 2; // GL_SHORT, GL_UNSIGNED_SHORT
+    case 5125: case 5126: return 4; // GL_UNSIGNED_INT, GL_FLOAT
+    default: return 0;
+    }
+}
+
+// A component as the GPU reads it: normalized integers map to [0, 1] or [-1, 1]
+static float componentToFloat(const unsigned char* bytes, unsigned int componentType, bool normalized)
+{
+    switch (componentType)
+    {
+    case 5120:
+    {
+        int8_t value = (int8_t)bytes[0];
+        return normalized ? std::max(value / 127.0f, -1.0f) : (float)value;
+    }
+    case 5121:
+        return normalized ? bytes[0] / 255.0f : (float)bytes[0];
+    case 5122:
+    {
+        int16_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return normalized ? std::max(value / 32767.0f, -1.0f) : (float)value;
+    }
+    case 5123:
+    {
+        uint16_t value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return normalized ? value / 65535.0f : (float)value;
+    }
+    case 5125:
+        return (float)readU32(bytes);
+    default:
+    {
+        float value;
+        std::memcpy(&value, bytes, sizeof(value));
+        return value;
+    }
+    }
+}
+
+// Memory the CPU copies of a mesh take
+static size_t geometryBytes(const Mesh& mesh)
+{
+    return mesh.vertices.capacity() * sizeof(Vertex) + mesh.packedVertices.capacity() + mesh.indices.capacity() * sizeof(GLuint);
+}
+
+// Decodes the payload of a "data:<mime type>;base64,<payload>" URI
+static bool decodeDataUri(const std::string& uri, std::vector<unsigned char>& bytes)
+{
+    size_t comma = uri.find(',');
+    if (comma == std::string::npos || comma < 7 || uri.compare(comma - 7, 7, ";base64") != 0)
+        return false;
+
+    static const std::string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    int lookup[256];
+    std::fill(lookup, lookup + 256, -1);
+    for (int i = 0; i < 64; i++)
+        lookup[(unsigned char)alphabet[i]] = i;
+
+    bytes.reserve((uri.size() - comma) * 3 / 4);
+    uint32_t accumulator = 0;
+    int bits = 0;
+    for (size_t i = comma + 1; i < uri.size() && uri[i] != '='; i++)
+    {
+        int value = lookup[(unsigned char)uri[i]];
+        if (value < 0)
+            return false;
+        accumulator = (accumulator << 6) | (uint32_t)value;
+        bits += 6;
+        if (bits >= 8)
+        {
+            bits -= 8;
+            bytes.push_back((unsigned char)(accumulator >> bits));
+        }
+    }
+    return true;
+}
 
 // Constructor - loads model from file with custom transform parameters
-Model::Model(const char* file, glm::vec3 customScale, glm::vec3 customTranslation, glm::quat customRotation)
-    : modelScale(customScale), modelTranslation(customTranslation), modelRotation(customRotation), file(file)
+Model::Model(const char* file, glm::vec3 customScale, glm::vec3 customTranslation, glm::quat customRotation, glm::mat4 placement)
+    : modelScale(customScale), modelTranslation(customTranslation), modelRotation(customRotation), modelPlacement(placement), file(file)
 {
-    std::string text = get_file_contents(file);
-    JSON = json::parse(text);
-    data = getData();
+    PROFILE_SCOPE("Model load");
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    // Textures and meshes created from here on report to this asset
+    LoadReport::current = file;
+    read();
     traverseNode(0);
+    LoadReport::AddWallTime(file, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count());
+    LoadReport::current.clear();
+}
+
+// Reads, parses and decodes the file, without any GL call
+void Model::read()
+{
+    // Only written while the file is read, then shared read-only with the instances
+    std::shared_ptr<GltfDocument> document = std::make_shared<GltfDocument>();
+    gltf = document;
+    std::shared_ptr<std::vector<unsigned char>> glb;
+    size_t binOffset = 0;
+    size_t binSize = 0;
+    {
+        PROFILE_SCOPE("Model parse");
+        LoadTimer timer(file, StageJsonParse);
+        // One read for the whole file, a .glb is then parsed and used in place
+        std::shared_ptr<std::vector<unsigned char>> bytes = readFileBytes(file);
+        if (!bytes)
+            throw std::invalid_argument(std::string("Failed to read model: ") + file);
+        const char* text = (const char*)bytes->data();
+        size_t textSize = bytes->size();
+
+        // .glb: 12 byte header (magic, version, length), then chunks of (length, type, data).
+        // The JSON chunk comes first and a BIN chunk may follow
+        if (bytes->size() >= 12 && std::memcmp(bytes->data(), "glTF", 4) == 0)
+        {
+            const unsigned char* header = bytes->data();
+            if (readU32(header + 4) != 2)
+                throw std::invalid_argument(std::string("Unsupported .glb version in ") + file);
+            size_t length = std::min((size_t)readU32(header + 8), bytes->size());
+            textSize = 0;
+            for (size_t chunk = 12; chunk + 8 <= length; )
+            {
+                size_t chunkSize = readU32(header + chunk);
+                uint32_t chunkType = readU32(header + chunk + 4);
+                if (chunk + 8 + chunkSize > length)
+                    break;
+                if (chunkType == 0x4E4F534A && textSize == 0) // "JSON"
+                {
+                    text = (const char*)header + chunk + 8;
+                    textSize = chunkSize;
+                }
+                else if (chunkType == 0x004E4942 && binSize == 0) // "BIN\0"
+                {
+                    binOffset = chunk + 8;
+                    binSize = chunkSize;
+                }
+                chunk += 8 + chunkSize;
+            }
+            if (textSize == 0)
+                throw std::invalid_argument(std::string("No JSON chunk in ") + file);
+            glb = bytes;
+        }
+
+        if (!document->Parse(text, textSize, file))
+            throw std::invalid_argument(std::string("Failed to load model: ") + file);
+        timer.bytes = bytes->size();
+    }
+    {
+        PROFILE_SCOPE("Model buffers");
+        LoadTimer timer(file, StageBufferRead);
+        loadBuffers(glb, binOffset, binSize);
+        decodeCompressedViews(*document);
+        for (const auto& bytes : storage)
+            timer.bytes += bytes->size();
+    }
+    for (const auto& bytes : storage)
+        MemoryTracker::Add(file, MemoryFileData, bytes->capacity());
+    // Counted once, the instances of the file share it
+    MemoryTracker::Add(file, MemoryJson, document->Bytes());
+}
+
+// Everything but the GL objects, so it can run on a worker thread. The meshes are assembled here and created by Upload
+Model::Model(const char* file, Deferred)
+    : modelScale(1.0f), modelTranslation(0.0f), modelRotation(1.0f, 0.0f, 0.0f, 0.0f), modelPlacement(1.0f), file(file)
+{
+    PROFILE_SCOPE("Model load");
+    auto loadStart = std::chrono::high_resolution_clock::now();
+    read();
+    prepared.resize(gltf->meshes.size());
+    for (unsigned int i = 0; i < gltf->meshes.size(); i++)
+        prepared[i] = prepareMesh(i);
+    LoadReport::AddWallTime(file, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - loadStart).count());
+}
+
+// Render thread: creates the meshes and textures of a model read with Deferred
+void Model::Upload()
+{
+    PROFILE_SCOPE("Model upload");
+    auto uploadStart = std::chrono::high_resolution_clock::now();
+    LoadReport::current = file;
+    traverseNode(0);
+    LoadReport::current.clear();
+    prepared.clear();
+    prepared.shrink_to_fit();
+    LoadReport::AddWallTime(file, std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - uploadStart).count());
+}
+
+bool Model::TexturesBusy() const
+{
+    TextureStreamer* streamer = TextureStreamer::active;
+    if (!streamer)
+        return false;
+    for (const Texture& texture : loadedTex)
+    {
+        if (streamer->Busy(texture.ID))
+            return true;
+    }
+    return false;
+}
+
+// Deletes the GL buffers and textures of the meshes. Only for the last instance of a file, the others share them
+void Model::Delete()
+{
+    for (Mesh& mesh : *meshes)
+        mesh.Delete(file);
+    for (Texture& texture : loadedTex)
+    {
+        // Residency counts the levels it keeps allocated itself
+        if (!TextureResidency::active || !TextureResidency::active->Unregister(texture.ID))
+            MemoryTracker::Release(file, MemoryTextures, texture.bytes);
+        Texture::totalBytes -= std::min(texture.bytes, Texture::totalBytes);
+        if (TextureStreamer::active)
+            TextureStreamer::active->Forget(texture.ID);
+        texture.Delete();
+    }
+    // The embedded images this model registered, decoded data URIs are only held by the image registry
+    for (const std::string& name : loadedTexName)
+    {
+        if (name.compare(0, 6, "#image") == 0)
+            MemoryTracker::Release(file, MemoryFileData, Texture::UnregisterEmbeddedImage(file + name));
+    }
+    loadedTex.clear();
+    loadedTexName.clear();
+}
+
+// Another instance of an already loaded model, only the node matrices are built again
+Model::Model(const Model& shared, glm::vec3 customScale, glm::vec3 customTranslation, glm::quat customRotation, glm::mat4 placement)
+    : modelScale(customScale), modelTranslation(customTranslation), modelRotation(customRotation), modelPlacement(placement), file(shared.file),
+    storage(shared.storage), buffers(shared.buffers), gltf(shared.gltf), meshes(shared.meshes),
+    loadedTexName(shared.loadedTexName), loadedTex(shared.loadedTex)
+{
+    traverseNode(0);
+}
+
+// Gives the CPU memory of the model back to the memory tracker.
+// The GL textures and buffers of the meshes are never deleted, so they stay counted
+Model::~Model()
+{
+    if (gltf.use_count() == 1)
+        MemoryTracker::Release(file, MemoryJson, gltf->Bytes());
+    // Files that embedded images still decode from stay counted
+    for (const auto& bytes : storage)
+    {
+        if (bytes.use_count() == 1)
+            MemoryTracker::Release(file, MemoryFileData, bytes->capacity());
+    }
+    if (meshes.use_count() == 1)
+    {
+        for (const Mesh& mesh : *meshes)
+            MemoryTracker::Release(file, MemoryGeometry, geometryBytes(mesh));
+    }
 }
 
 // Sets new scale for the model and rebuilds transformation matrices
 void Model::SetScale(glm::vec3 newScale)
 {
     modelScale = newScale;
+    // The impostor atlas is per custom transform
+    impostorGeneration = 0;
     // Recalculate all matrices with new scale
     matricesMeshes.clear();
     traverseNode(0);
@@ -23,6 +306,7 @@ void Model::SetScale(glm::vec3 newScale)
 void Model::SetRotation(glm::quat newRotation)
 {
     modelRotation = newRotation;
+    impostorGeneration = 0;
     // Recalculate all matrices with new rotation
     matricesMeshes.clear();
     traverseNode(0);
@@ -31,83 +315,225 @@ void Model::SetRotation(glm::quat newRotation)
 // Draws all meshes in the model with given shader and camera
 void Model::Draw(Shader& shader, Camera& camera)
 {
+    PROFILE_SCOPE("Model::Draw");
+    if (fade < 1.0f)
+    {
+        shader.Activate();
+        glUniform1f(glGetUniformLocation(shader.ID, "fade"), fade);
+    }
     // Iterate through all meshes and draw each one
-    for (unsigned int i = 0; i < meshes.size(); i++)
+    for (unsigned int i = 0; i < meshes->size(); i++)
     {
-        meshes[i].Mesh::Draw(shader, camera, matricesMeshes[i]);
+        (*meshes)[i].Mesh::Draw(shader, camera, matricesMeshes[i]);
+    }
+    if (fade < 1.0f)
+        glUniform1f(glGetUniformLocation(shader.ID, "fade"), 1.0f);
+}
+
+// Returns the bounds of a mesh in world space
+BoundingSphere Model::GetMeshBounds(unsigned int index) const
+{
+    const glm::mat4& matrix = matricesMeshes[index];
+    const BoundingSphere& local = (*meshes)[index].bounds;
+
+    // default.vert applies the mesh matrix with a negated rotation (identity here), which mirrors the position
+    BoundingSphere world;
+    world.center = -glm::vec3(matrix * glm::vec4(local.center, 1.0f));
+    float scale = std::max(glm::length(glm::vec3(matrix[0])), std::max(glm::length(glm::vec3(matrix[1])), glm::length(glm::vec3(matrix[2]))));
+    world.radius = local.radius * scale;
+    return world;
+}
+
+// Box around the bounds of every mesh in world space
+void Model::GetBounds(glm::vec3& boxMin, glm::vec3& boxMax) const
+{
+    boxMin = glm::vec3(std::numeric_limits<float>::max());
+    boxMax = -boxMin;
+    for (unsigned int i = 0; i < meshes->size(); i++)
+    {
+        BoundingSphere bounds = GetMeshBounds(i);
+        boxMin = glm::min(boxMin, bounds.center - glm::vec3(bounds.radius));
+        boxMax = glm::max(boxMax, bounds.center + glm::vec3(bounds.radius));
+    }
+}
+
+// Same number of meshes, byte for byte the same vertices, and the same triangles up to which corner each starts at
+bool Model::SameGeometry(const Model& other) const
+{
+    if (meshes->size() != other.meshes->size())
+        return false;
+    for (size_t m = 0; m < meshes->size(); m++)
+    {
+        const Mesh& a = (*meshes)[m];
+        const Mesh& b = (*other.meshes)[m];
+        if (a.vertices.size() != b.vertices.size() || a.packedVertices != b.packedVertices || a.indices.size() != b.indices.size())
+            return false;
+        if (!a.vertices.empty() && std::memcmp(a.vertices.data(), b.vertices.data(), a.vertices.size() * sizeof(Vertex)) != 0)
+            return false;
+        for (size_t i = 0; i + 2 < a.indices.size(); i += 3)
+        {
+            bool same = false;
+            for (int r = 0; r < 3 && !same; r++)
+                same = a.indices[i] == b.indices[i + r] && a.indices[i + 1] == b.indices[i + (r + 1) % 3] && a.indices[i + 2] == b.indices[i + (r + 2) % 3];
+            if (!same)
+                return false;
+        }
+    }
+    return true;
+}
+
+// Vertex positions of a mesh in world space, as default.vert places them
+void Model::GetMeshPositions(unsigned int index, std::vector<glm::vec3>& positions) const
+{
+    const glm::mat4& matrix = matricesMeshes[index];
+    const Mesh& mesh = (*meshes)[index];
+    positions.clear();
+    if (mesh.packedVertices.empty())
+    {
+        positions.reserve(mesh.vertices.size());
+        for (const Vertex& vertex : mesh.vertices)
+            positions.push_back(-glm::vec3(matrix * glm::vec4(vertex.position, 1.0f)));
+        return;
+    }
+
+    // Quantized positions are read the way the vertex attribute setup tells the GPU to
+    const VertexAttribute& attribute = mesh.format.position;
+    size_t componentBytes = componentSize(attribute.type);
+    size_t count = mesh.packedVertices.size() / mesh.format.stride;
+    positions.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const unsigned char* vertex = mesh.packedVertices.data() + i * mesh.format.stride + attribute.offset;
+        glm::vec3 position(0.0f);
+        for (int c = 0; c < attribute.components && c < 3; c++)
+            position[c] = componentToFloat(vertex + c * componentBytes, attribute.type, attribute.normalized == GL_TRUE);
+        positions.push_back(-glm::vec3(matrix * glm::vec4(position, 1.0f)));
     }
 }
 
 // Loads mesh data from GLTF/GLB file at specified index
 void Model::loadMesh(unsigned int indMesh)
 {
-    // Get accessor indices for vertex attributes
-    unsigned int posAccInd = JSON["meshes"][indMesh]["primitives"][0]["attributes"]["POSITION"];
-    unsigned int normalAccInd = JSON["meshes"][indMesh]["primitives"][0]["attributes"]["NORMAL"];
-    unsigned int texAccInd = JSON["meshes"][indMesh]["primitives"][0]["attributes"]["TEXCOORD_0"];
-    unsigned int indAccInd = JSON["meshes"][indMesh]["primitives"][0]["indices"];
-
-    // Extract vertex data using accessor indices
-    std::vector<float> posVec = getFloats(JSON["accessors"][posAccInd]);
-    std::vector<glm::vec3> positions = groupFloatsVec3(posVec);
-    std::vector<float> normalVec = getFloats(JSON["accessors"][normalAccInd]);
-    std::vector<glm::vec3> normals = groupFloatsVec3(normalVec);
-    std::vector<float> texVec = getFloats(JSON["accessors"][texAccInd]);
-    std::vector<glm::vec2> texUVs = groupFloatsVec2(texVec);
-
-    // Combine vertex components and get indices/textures
-    std::vector<Vertex> vertices = assembleVertices(positions, normals, texUVs);
-    std::vector<GLuint> indices = getIndices(JSON["accessors"][indAccInd]);
+    // A model read with Deferred already assembled its meshes on the worker
+    PreparedMesh assembled;
+    PreparedMesh* data = &assembled;
+    if (indMesh < prepared.size())
+        data = &prepared[indMesh];
+    else
+        assembled = prepareMesh(indMesh);
+    if (!data->valid)
+        return;
     std::vector<Texture> textures = getTextures();
 
     // Create mesh from extracted data
-    meshes.push_back(Mesh(vertices, indices, textures));
+    if (data->quantized)
+        meshes->push_back(Mesh(data->packed, data->format, data->positions, data->indices, textures));
+    else
+        meshes->push_back(Mesh(data->vertices, data->indices, textures));
+    // The mesh keeps CPU copies of its vertices and indices
+    MemoryTracker::Add(file, MemoryGeometry, geometryBytes(meshes->back()));
+}
+
+// Decodes the accessors of a mesh into the vertices and indices Mesh takes, without any GL call
+Model::PreparedMesh Model::prepareMesh(unsigned int indMesh)
+{
+    PreparedMesh data;
+    // Accessors of the vertex attributes (only the first primitive of a mesh is loaded)
+    const GltfMesh& mesh = gltf->meshes[indMesh];
+    if (mesh.primitiveCount == 0)
+        return data;
+    data.valid = true;
+    const GltfPrimitive& primitive = gltf->primitives[mesh.firstPrimitive];
+    if (primitive.position < 0 || primitive.normal < 0 || primitive.texcoord < 0 || primitive.indices < 0)
+        throw std::invalid_argument(std::string("Mesh without positions, normals, UVs or indices in ") + file);
+
+    const GltfAccessor& positions = gltf->accessors[primitive.position];
+    const GltfAccessor& normals = gltf->accessors[primitive.normal];
+    const GltfAccessor& texUVs = gltf->accessors[primitive.texcoord];
+
+    // KHR_mesh_quantization: 8/16 bit attributes go to the GPU as they are, which converts them when reading
+    if (positions.componentType != 5126 || normals.componentType != 5126 || texUVs.componentType != 5126)
+    {
+        if (normals.count != positions.count || texUVs.count != positions.count)
+            throw std::invalid_argument(std::string("Attributes of a mesh have different counts in ") + file);
+        VertexFormat format = {};
+        GLsizei offset = 0;
+        auto describe = [&](const GltfAccessor& accessor, VertexAttribute& attribute)
+        {
+            // glTF component types are the GL enums
+            attribute.type = accessor.componentType;
+            attribute.components = accessor.components;
+            attribute.normalized = accessor.normalized ? GL_TRUE : GL_FALSE;
+            attribute.offset = offset;
+            offset += (GLsizei)((componentSize(accessor.componentType) * accessor.components + 3) & ~(size_t)3);
+        };
+        describe(positions, format.position);
+        describe(normals, format.normal);
+        describe(texUVs, format.texUV);
+        format.stride = offset;
+
+        {
+            LoadTimer timer(file, StageVertexAssembly);
+            data.packed.resize((size_t)positions.count * format.stride);
+            packAttribute(positions, format.position, format.stride, data.packed);
+            packAttribute(normals, format.normal, format.stride, data.packed);
+            packAttribute(texUVs, format.texUV, format.stride, data.packed);
+            timer.bytes = data.packed.size();
+        }
+        // Dequantized positions are only needed for the bounds
+        data.quantized = true;
+        data.format = format;
+        data.indices = getIndices(gltf->accessors[primitive.indices]);
+        data.positions = groupFloatsVec3(getFloats(positions));
+        return data;
+    }
+
+    // Extract vertex data using accessor indices
+    std::vector<float> posVec = getFloats(positions);
+    std::vector<float> normalVec = getFloats(normals);
+    std::vector<float> texVec = getFloats(texUVs);
+    data.indices = getIndices(gltf->accessors[primitive.indices]);
+
+    // Combine vertex components
+    {
+        LoadTimer timer(file, StageVertexAssembly);
+        data.vertices = assembleVertices(groupFloatsVec3(posVec), groupFloatsVec3(normalVec), groupFloatsVec2(texVec));
+        timer.bytes = data.vertices.size() * sizeof(Vertex);
+    }
+    return data;
 }
 
 // Recursively traverses node hierarchy and builds transformation matrices
 void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
 {
     // Current node data
-    json node = JSON["nodes"][nextNode];
+    if (nextNode >= gltf->nodes.size())
+        return;
+    const GltfNode& node = gltf->nodes[nextNode];
 
     // Get translation (combine with model's custom translation)
     glm::vec3 translation = modelTranslation; // Default to custom translation
-    if (node.find("translation") != node.end())
-    {
-        float transValues[3];
-        for (unsigned int i = 0; i < node["translation"].size(); i++)
-            transValues[i] = (node["translation"][i]);
-        translation = glm::make_vec3(transValues) + modelTranslation;
-    }
+    if (node.hasTranslation)
+        translation = glm::make_vec3(node.translation) + modelTranslation;
 
     // Get rotation (combine with model's custom rotation)
     glm::quat rotation = modelRotation; // Default to custom rotation
-    if (node.find("rotation") != node.end())
+    if (node.hasRotation)
     {
-        float rotValues[4] = { node["rotation"][3], node["rotation"][0], node["rotation"][1], node["rotation"][2] };
+        float rotValues[4] = { node.rotation[3], node.rotation[0], node.rotation[1], node.rotation[2] };
         glm::quat nodeRotation = glm::normalize(glm::make_quat(rotValues));
         rotation = modelRotation * nodeRotation; // Combine rotations
     }
 
     // Get scale (combine with model's custom scale)
     glm::vec3 scale = modelScale; // Start with model scale
-    if (node.find("scale") != node.end())
-    {
-        float scaleValues[3];
-        for (unsigned int i = 0; i < node["scale"].size(); i++)
-            scaleValues[i] = (node["scale"][i]);
-        scale = glm::make_vec3(scaleValues) * modelScale;
-    }
+    if (node.hasScale)
+        scale = glm::make_vec3(node.scale) * modelScale;
 
     // Get matrix if explicitly defined
     glm::mat4 matNode = glm::mat4(1.0f);
-    if (node.find("matrix") != node.end())
-    {
-        float matValues[16];
-        for (unsigned int i = 0; i < node["matrix"].size(); i++)
-            matValues[i] = (node["matrix"][i]);
-        matNode = glm::make_mat4(matValues);
-    }
+    if (node.hasMatrix)
+        matNode = glm::make_mat4(node.matrix);
 
     // Initialize transformation matrices
     glm::mat4 trans = glm::mat4(1.0f);
@@ -123,128 +549,283 @@ void Model::traverseNode(unsigned int nextNode, glm::mat4 matrix)
     glm::mat4 matNextNode = matrix * matNode * trans * rot * sca;
 
     // Load mesh if node contains one
-    if (node.find("mesh") != node.end())
+    if (node.mesh >= 0)
     {
         translationsMeshes.push_back(translation);
         rotationsMeshes.push_back(rotation);
         scalesMeshes.push_back(scale);
-        matricesMeshes.push_back(matNextNode);
+        // default.vert mirrors the mesh matrix, so the world space placement is mirrored the same way first
+        glm::mat4 mirror = glm::scale(glm::mat4(1.0f), glm::vec3(-1.0f));
+        matricesMeshes.push_back(mirror * modelPlacement * mirror * matNextNode);
 
-        loadMesh(node["mesh"]);
+        // Meshes are only loaded the first time, rebuilding the matrices or another instance reuses them
+        if (meshes->size() < matricesMeshes.size())
+            loadMesh(node.mesh);
     }
 
     // Recursively process child nodes
-    if (node.find("children") != node.end())
+    for (unsigned int i = 0; i < node.childCount; i++)
+        traverseNode(gltf->nodeChildren[node.firstChild + i], matNextNode);
+}
+
+// Gets the binary data of every buffer: the BIN chunk of a .glb, external files and base64 data URIs
+void Model::loadBuffers(std::shared_ptr<std::vector<unsigned char>> glb, size_t binOffset, size_t binSize)
+{
+    std::string fileStr = std::string(file);
+    std::string fileDirectory = fileStr.substr(0, fileStr.find_last_of('/') + 1);
+    if (glb)
+        storage.push_back(glb);
+
+    for (unsigned int i = 0; i < gltf->buffers.size(); i++)
     {
-        for (unsigned int i = 0; i < node["children"].size(); i++)
-            traverseNode(node["children"][i], matNextNode);
+        std::string uri = gltf->String(gltf->buffers[i].uri);
+        if (uri.empty() && gltf->buffers[i].meshoptFallback)
+        {
+            // Only there for loaders without EXT_meshopt_compression, the views in it are decoded from elsewhere
+            storage.push_back(std::make_shared<std::vector<unsigned char>>());
+            buffers.push_back(BufferRange{ (unsigned int)storage.size() - 1, 0, 0 });
+            continue;
+        }
+        if (uri.empty())
+        {
+            // Only the first buffer of a .glb may leave out the uri, it is the BIN chunk
+            if (!glb || i != 0)
+                throw std::invalid_argument(std::string("Buffer without uri in ") + file);
+            buffers.push_back(BufferRange{ 0, binOffset, binSize });
+            continue;
+        }
+
+        std::shared_ptr<std::vector<unsigned char>> bytes;
+        if (uri.compare(0, 5, "data:") == 0)
+        {
+            bytes = std::make_shared<std::vector<unsigned char>>();
+            if (!decodeDataUri(uri, *bytes))
+                throw std::invalid_argument(std::string("Unsupported data URI in ") + file);
+        }
+        else
+        {
+            bytes = readFileBytes(fileDirectory + uri);
+            if (!bytes)
+                throw std::invalid_argument(std::string("Failed to read ") + fileDirectory + uri);
+        }
+        storage.push_back(bytes);
+        buffers.push_back(BufferRange{ (unsigned int)storage.size() - 1, 0, bytes->size() });
     }
 }
 
-// Extracts binary data from GLTF/GLB file
-std::vector<unsigned char> Model::getData()
+// Decodes the EXT_meshopt_compression bufferViews on the worker threads and points them at the result
+void Model::decodeCompressedViews(GltfDocument& document)
 {
-    std::string bytesText;
-    std::string uri = JSON["buffers"][0]["uri"];
+    std::vector<unsigned int> compressed;
+    for (unsigned int i = 0; i < document.bufferViews.size(); i++)
+    {
+        if (document.bufferViews[i].meshopt.buffer >= 0)
+            compressed.push_back(i);
+    }
+    if (compressed.empty())
+        return;
+    PROFILE_SCOPE("Model meshopt decode");
+
+    // Every view gets a storage of its own, so the workers only read the sources and write their own output
+    std::vector<const unsigned char*> sources;
+    size_t firstDecoded = storage.size();
+    for (unsigned int view : compressed)
+    {
+        const GltfMeshopt& meshopt = document.bufferViews[view].meshopt;
+        if (meshopt.buffer >= (int)buffers.size() || (size_t)meshopt.byteOffset + meshopt.byteLength > buffers[meshopt.buffer].size)
+            throw std::invalid_argument(std::string("Compressed bufferView outside of its buffer in ") + file);
+        const BufferRange& buffer = buffers[meshopt.buffer];
+        sources.push_back(storage[buffer.storage]->data() + buffer.offset + meshopt.byteOffset);
+        storage.push_back(std::make_shared<std::vector<unsigned char>>((size_t)meshopt.count * meshopt.byteStride));
+    }
 
-    // Get path to binary file
-    std::string fileStr = std::string(file);
-    std::string fileDirectory = fileStr.substr(0, fileStr.find_last_of('/') + 1);
-    bytesText = get_file_contents((fileDirectory + uri).c_str());
+    std::vector<char> decoded(compressed.size(), 0);
+    ThreadPool::Shared().ParallelFor((int)compressed.size(), [&](int begin, int end)
+    {
+        for (int i = begin; i < end; i++)
+        {
+            const GltfMeshopt& meshopt = document.bufferViews[compressed[i]].meshopt;
+            decoded[i] = MeshoptDecoder::Decode(meshopt, sources[i], meshopt.byteLength, storage[firstDecoded + i]->data());
+        }
+    });
 
-    // Convert text data to bytes
-    std::vector<unsigned char> data(bytesText.begin(), bytesText.end());
-    return data;
+    for (size_t i = 0; i < compressed.size(); i++)
+    {
+        if (!decoded[i])
+            throw std::invalid_argument(std::string("Malformed EXT_meshopt_compression data in ") + file);
+        GltfBufferView& view = document.bufferViews[compressed[i]];
+        size_t size = storage[firstDecoded + i]->size();
+        buffers.push_back(BufferRange{ (unsigned int)(firstDecoded + i), 0, size });
+        view.buffer = (int)buffers.size() - 1;
+        view.byteOffset = 0;
+        view.byteLength = (unsigned int)size;
+    }
+}
+
+// Start and size of the bytes a bufferView covers, throws if it is outside its buffer
+const unsigned char* Model::viewBytes(int bufferView, size_t& size) const
+{
+    if (bufferView < 0 || bufferView >= (int)gltf->bufferViews.size())
+        throw std::invalid_argument(std::string("Missing bufferView in ") + file);
+    const GltfBufferView& view = gltf->bufferViews[bufferView];
+    if (view.buffer < 0 || view.buffer >= (int)buffers.size() || view.byteOffset > buffers[view.buffer].size)
+        throw std::invalid_argument(std::string("bufferView outside of its buffer in ") + file);
+
+    const BufferRange& buffer = buffers[view.buffer];
+    size = buffer.size - view.byteOffset;
+    if (view.byteLength > 0)
+        size = std::min(size, (size_t)view.byteLength);
+    return storage[buffer.storage]->data() + buffer.offset + view.byteOffset;
+}
+
+// Name of an embedded image, registered with Texture the first time it is asked for
+std::string Model::embeddedImage(unsigned int index)
+{
+    std::string name = std::string(file) + "#image" + std::to_string(index);
+    const GltfImage& image = gltf->images[index];
+    std::string uri = gltf->String(image.uri);
+    if (!uri.empty())
+    {
+        auto bytes = std::make_shared<std::vector<unsigned char>>();
+        if (!decodeDataUri(uri, *bytes))
+            throw std::invalid_argument(std::string("Unsupported image data URI in ") + file);
+        // Another copy of the file may have registered it already, then these bytes are dropped
+        if (Texture::RegisterEmbeddedImage(name, bytes, 0, bytes->size()))
+            MemoryTracker::Add(file, MemoryFileData, bytes->capacity());
+    }
+    else
+    {
+        // Decoded straight out of the buffer it is in, which stays alive while the texture may stream again
+        size_t size;
+        const unsigned char* bytes = viewBytes(image.bufferView, size);
+        const std::shared_ptr<std::vector<unsigned char>>& owner = storage[buffers[gltf->bufferViews[image.bufferView].buffer].storage];
+        Texture::RegisterEmbeddedImage(name, owner, bytes - owner->data(), size);
+    }
+    return name;
 }
 
 // Extracts float values from accessor
-std::vector<float> Model::getFloats(json accessor)
-{
-    std::vector<float> floatVec;
-
-    // Get accessor properties
-    unsigned int buffViewInd = accessor.value("bufferView", 1);
-    unsigned int count = accessor["count"];
-    unsigned int accByteOffset = accessor.value("byteOffset", 0);
-    std::string type = accessor["type"];
-
-    // Get bufferView properties
-    json bufferView = JSON["bufferViews"][buffViewInd];
-    unsigned int byteOffset = bufferView["byteOffset"];
-
-    // Determine number of components per vertex
-    unsigned int numPerVert;
-    if (type == "SCALAR") numPerVert = 1;
-    else if (type == "VEC2") numPerVert = 2;
-    else if (type == "VEC3") numPerVert = 3;
-    else if (type == "VEC4") numPerVert = 4;
-    else throw std::invalid_argument("Type is invalid (not SCALAR, VEC2, VEC3, or VEC4)");
-
-    // Extract float values from binary data
-    unsigned int beginningOfData = byteOffset + accByteOffset;
-    unsigned int lengthOfData = count * 4 * numPerVert;
-    for (unsigned int i = beginningOfData; i < beginningOfData + lengthOfData; i += 4)
-    {
-        unsigned char bytes[] = { data[i], data[i + 1], data[i + 2], data[i + 3] };
-        float value;
-        std::memcpy(&value, bytes, sizeof(float));
-        floatVec.push_back(value);
+std::vector<float> Model::getFloats(const GltfAccessor& accessor)
+{
+    LoadTimer timer(file, StageAccessorDecode);
+
+    // Number of components per vertex
+    unsigned int numPerVert = accessor.components;
+    if (numPerVert == 0)
+        throw std::invalid_argument("Type is invalid (not SCALAR, VEC2, VEC3, or VEC4)");
+    size_t componentBytes = componentSize(accessor.componentType);
+    if (componentBytes == 0)
+        throw std::invalid_argument(std::string("Unsupported accessor component type in ") + file);
+
+    // Accessors without a bufferView are all zeros
+    std::vector<float> floatVec((size_t)accessor.count * numPerVert, 0.0f);
+    if (accessor.bufferView < 0)
+        return floatVec;
+    size_t available;
+    const unsigned char* data = viewBytes(accessor.bufferView, available);
+    unsigned int byteStride = gltf->bufferViews[accessor.bufferView].byteStride;
+
+    // Extract float values from binary data, one vertex at a time when the view is interleaved
+    size_t beginningOfData = accessor.byteOffset;
+    size_t vertexBytes = numPerVert * componentBytes;
+    size_t stride = byteStride ? byteStride : vertexBytes;
+    if (accessor.count > 0 && beginningOfData + (accessor.count - 1) * stride + vertexBytes > available)
+        throw std::invalid_argument(std::string("Accessor reads past the end of the buffer in ") + file);
+    if (accessor.componentType == 5126) // GL_FLOAT
+    {
+        for (size_t i = 0; i < accessor.count; i++)
+            std::memcpy(&floatVec[i * numPerVert], data + beginningOfData + i * stride, vertexBytes);
+    }
+    else
+    {
+        // Quantized data, converted the way the GPU would
+        for (size_t i = 0; i < accessor.count; i++)
+        {
+            const unsigned char* vertex = data + beginningOfData + i * stride;
+            for (unsigned int c = 0; c < numPerVert; c++)
+                floatVec[i * numPerVert + c] = componentToFloat(vertex + c * componentBytes, accessor.componentType, accessor.normalized);
+        }
     }
 
+    timer.bytes = floatVec.size() * sizeof(float);
     return floatVec;
 }
 
 // Extracts indices from accessor
-std::vector<GLuint> Model::getIndices(json accessor)
+std::vector<GLuint> Model::getIndices(const GltfAccessor& accessor)
 {
+    LoadTimer timer(file, StageAccessorDecode);
     std::vector<GLuint> indices;
-
-    // Get accessor properties
-    unsigned int buffViewInd = accessor.value("bufferView", 0);
-    unsigned int count = accessor["count"];
-    unsigned int accByteOffset = accessor.value("byteOffset", 0);
-    unsigned int componentType = accessor["componentType"];
-
-    // Get bufferView properties
-    json bufferView = JSON["bufferViews"][buffViewInd];
-    unsigned int byteOffset = bufferView.value("byteOffset", 0);
+    if (accessor.bufferView < 0)
+        return indices;
+    size_t available;
+    const unsigned char* data = viewBytes(accessor.bufferView, available);
 
     // Extract indices based on component type
-    unsigned int beginningOfData = byteOffset + accByteOffset;
-    if (componentType == 5125) // GL_UNSIGNED_INT
+    size_t beginningOfData = accessor.byteOffset;
+    size_t indexBytes = accessor.componentType == 5125 ? 4 : accessor.componentType == 5121 ? 1 : 2;
+    if (beginningOfData + (size_t)accessor.count * indexBytes > available)
+        throw std::invalid_argument(std::string("Accessor reads past the end of the buffer in ") + file);
+    indices.resize(accessor.count);
+    const unsigned char* source = data + beginningOfData;
+    if (accessor.componentType == 5125) // GL_UNSIGNED_INT
     {
-        for (unsigned int i = beginningOfData; i < byteOffset + accByteOffset + count * 4; i += 4)
-        {
-            unsigned char bytes[] = { data[i], data[i + 1], data[i + 2], data[i + 3] };
-            unsigned int value;
-            std::memcpy(&value, bytes, sizeof(unsigned int));
-            indices.push_back((GLuint)value);
-        }
+        std::memcpy(indices.data(), source, indices.size() * sizeof(GLuint));
     }
-    else if (componentType == 5123) // GL_UNSIGNED_SHORT
+    else if (accessor.componentType == 5123) // GL_UNSIGNED_SHORT
     {
-        for (unsigned int i = beginningOfData; i < byteOffset + accByteOffset + count * 2; i += 2)
+        for (size_t i = 0; i < indices.size(); i++)
         {
-            unsigned char bytes[] = { data[i], data[i + 1] };
             unsigned short value;
-            std::memcpy(&value, bytes, sizeof(unsigned short));
-            indices.push_back((GLuint)value);
+            std::memcpy(&value, source + i * 2, sizeof(unsigned short));
+            indices[i] = (GLuint)value;
         }
     }
-    else if (componentType == 5122) // GL_SHORT
+    else if (accessor.componentType == 5122) // GL_SHORT
     {
-        for (unsigned int i = beginningOfData; i < byteOffset + accByteOffset + count * 2; i += 2)
+        for (size_t i = 0; i < indices.size(); i++)
         {
-            unsigned char bytes[] = { data[i], data[i + 1] };
             short value;
-            std::memcpy(&value, bytes, sizeof(short));
-            indices.push_back((GLuint)value);
+            std::memcpy(&value, source + i * 2, sizeof(short));
+            indices[i] = (GLuint)value;
         }
     }
+    else if (accessor.componentType == 5121) // GL_UNSIGNED_BYTE
+    {
+        for (size_t i = 0; i < indices.size(); i++)
+            indices[i] = (GLuint)source[i];
+    }
+    else
+        indices.clear();
 
+    timer.bytes = indices.size() * sizeof(GLuint);
     return indices;
 }
 
+// Copies an attribute into packed vertices without converting it
+void Model::packAttribute(const GltfAccessor& accessor, const VertexAttribute& attribute, GLsizei stride, std::vector<unsigned char>& packed)
+{
+    LoadTimer timer(file, StageAccessorDecode);
+    size_t elementBytes = componentSize(accessor.componentType) * accessor.components;
+    if (elementBytes == 0)
+        throw std::invalid_argument(std::string("Unsupported quantized attribute in ") + file);
+    // Accessors without a bufferView are all zeros, as 'packed' already is
+    if (accessor.bufferView < 0)
+        return;
+    size_t available;
+    const unsigned char* data = viewBytes(accessor.bufferView, available);
+    unsigned int byteStride = gltf->bufferViews[accessor.bufferView].byteStride;
+    size_t sourceStride = byteStride ? byteStride : elementBytes;
+    if (accessor.count > 0 && accessor.byteOffset + (accessor.count - 1) * sourceStride + elementBytes > available)
+        throw std::invalid_argument(std::string("Accessor reads past the end of the buffer in ") + file);
+
+    const unsigned char* source = data + accessor.byteOffset;
+    unsigned char* destination = packed.data() + attribute.offset;
+    for (size_t i = 0; i < accessor.count; i++)
+        std::memcpy(destination + i * stride, source + i * sourceStride, elementBytes);
+    timer.bytes = (size_t)accessor.count * elementBytes;
+}
+
 // Loads textures from model file
 std::vector<Texture> Model::getTextures()
 {
@@ -253,10 +834,28 @@ std::vector<Texture> Model::getTextures()
     std::string fileStr = std::string(file);
     std::string fileDirectory = fileStr.substr(0, fileStr.find_last_of('/') + 1);
 
+    // What the materials use each image for, embedded images have no file name to tell it by
+    std::vector<const char*> materialTypes(gltf->images.size(), nullptr);
+    auto markImage = [&](int texture, const char* type, bool replace)
+    {
+        if (texture < 0 || texture >= (int)gltf->textures.size())
+            return;
+        int source = gltf->textures[texture].source;
+        if (source >= 0 && source < (int)materialTypes.size() && (replace || !materialTypes[source]))
+            materialTypes[source] = type;
+    };
+    for (const GltfMaterial& material : gltf->materials)
+    {
+        markImage(material.metallicRoughnessTexture, "specular", false);
+        markImage(material.baseColorTexture, "diffuse", true);
+    }
+
     // Process all images in model
-    for (unsigned int i = 0; i < JSON["images"].size(); i++)
+    for (unsigned int i = 0; i < gltf->images.size(); i++)
     {
-        std::string texPath = JSON["images"][i]["uri"];
+        std::string uri = gltf->String(gltf->images[i].uri);
+        bool embedded = uri.empty() || uri.compare(0, 5, "data:") == 0;
+        std::string texPath = embedded ? "#image" + std::to_string(i) : uri;
 
         // Check if texture is already loaded
         bool skip = false;
@@ -272,20 +871,21 @@ std::vector<Texture> Model::getTextures()
 
         if (!skip)
         {
-            // Load diffuse texture
-            if (texPath.find("baseColor") != std::string::npos)
-            {
-                Texture diffuse = Texture((fileDirectory + texPath).c_str(), "diffuse", loadedTex.size());
-                textures.push_back(diffuse);
-                loadedTex.push_back(diffuse);
-                loadedTexName.push_back(texPath);
-            }
-            // Load specular texture
+            // Diffuse (baseColor) or specular (metallicRoughness) texture
+            const char* type = nullptr;
+            if (embedded)
+                type = materialTypes[i];
+            else if (texPath.find("baseColor") != std::string::npos)
+                type = "diffuse";
             else if (texPath.find("metallicRoughness") != std::string::npos)
+                type = "specular";
+
+            if (type)
             {
-                Texture specular = Texture((fileDirectory + texPath).c_str(), "specular", loadedTex.size());
-                textures.push_back(specular);
-                loadedTex.push_back(specular);
+                std::string image = embedded ? embeddedImage(i) : fileDirectory + texPath;
+                Texture texture = Texture(image.c_str(), type, loadedTex.size());
+                textures.push_back(texture);
+                loadedTex.push_back(texture);
                 loadedTexName.push_back(texPath);
             }
         }
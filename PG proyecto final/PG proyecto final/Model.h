@@ -1,39 +1,86 @@
 #ifndef MODEL_CLASS_H
 #define MODEL_CLASS_H
 
-#include<json/json.h>
+#include<memory>
 #include"Mesh.h"
-
-using json = nlohmann::json;
+#include"GltfDocument.h"
 
 
 class Model
 {
 public:
-	// Loads in a model from a file and stores tha information in 'data', 'JSON', and 'file'
+	// Loads in a model from a .gltf or .glb file and stores tha information in 'storage', 'gltf', and 'file'.
+	// 'placement' moves the result in world space, on top of the custom transform
 	Model(const char* file,
 		glm::vec3 customScale = glm::vec3(1.0f),
 		glm::vec3 customTranslation = glm::vec3(0.0f),
-		glm::quat customRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+		glm::quat customRotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f),
+		glm::mat4 placement = glm::mat4(1.0f));
+	// Reads a model without creating anything on the GPU, so it can load on a worker thread.
+	// Upload must then be called on the render thread before the model or an instance of it is drawn
+	struct Deferred {};
+	Model(const char* file, Deferred);
+	void Upload();
+	// Another instance of an already loaded model: the meshes, textures and file data are shared, only the transform is new
+	Model(const Model& shared, glm::vec3 customScale, glm::vec3 customTranslation, glm::quat customRotation, glm::mat4 placement);
+	// Gives the CPU memory of the model back to the memory tracker
+	~Model();
+	// Deletes the GL buffers and textures of the meshes. Only for the last instance of a file, the others share them
+	void Delete();
+	// True while a texture of the model is still being decoded or uploaded, Delete has to wait for it
+	bool TexturesBusy() const;
 	glm::vec3 modelTranslation;
 	glm::vec3 GetPosition() const { return modelTranslation; }
+	// File and custom transform: instances that share them only differ by their placement
+	const char* GetFile() const { return file; }
+	glm::vec3 GetScale() const { return modelScale; }
+	glm::quat GetRotation() const { return modelRotation; }
+	const glm::mat4& GetPlacement() const { return modelPlacement; }
+	// May be drawn as an impostor from afar (static exhibits, not walls)
+	bool impostor = false;
+	// Below 1 the meshes are dithered out, while the impostor fades in over the same pixels
+	float fade = 1.0f;
+	// Atlas ImpostorRenderer found for the model (-1 for none), valid while the generation matches the renderer's
+	int impostorAtlas = -1;
+	unsigned int impostorGeneration = 0;
 	void Draw(Shader& shader, Camera& camera);
 	void SetScale(glm::vec3 newScale);
 	//void SetTranslation(glm::vec3 newTranslation);
 	void SetRotation(glm::quat newRotation);
 
+	// Meshes of the model and their bounds in world space
+	const std::vector<Mesh>& GetMeshes() const { return *meshes; }
+	BoundingSphere GetMeshBounds(unsigned int index) const;
+	// Box around the bounds of every mesh in world space
+	void GetBounds(glm::vec3& boxMin, glm::vec3& boxMax) const;
+	// Vertex positions of a mesh in world space, as default.vert places them
+	void GetMeshPositions(unsigned int index, std::vector<glm::vec3>& positions) const;
+	// Same meshes, vertices and triangles as 'other'. A triangle may start at any of its corners, as compressors rotate them
+	bool SameGeometry(const Model& other) const;
+
 private:
 	// Variables for easy access
 	//glm::vec3 modelTranslation;
 	glm::vec3 modelScale;
 	glm::quat modelRotation;
+	glm::mat4 modelPlacement;
 
 	const char* file;
-	std::vector<unsigned char> data;
-	json JSON;
+	// Files and decoded data URIs the buffers live in. A .glb is read whole and its BIN chunk used in place
+	std::vector<std::shared_ptr<std::vector<unsigned char>>> storage;
+	// Where each glTF buffer is in 'storage'
+	struct BufferRange
+	{
+		unsigned int storage;
+		size_t offset;
+		size_t size;
+	};
+	std::vector<BufferRange> buffers;
+	// Nodes, meshes, accessors... of the file, parsed without keeping a JSON tree. Shared by every instance of the file
+	std::shared_ptr<const GltfDocument> gltf;
 
-	// All the meshes and transformations
-	std::vector<Mesh> meshes;
+	// All the meshes (shared by every instance of the file) and transformations
+	std::shared_ptr<std::vector<Mesh>> meshes = std::make_shared<std::vector<Mesh>>();
 	std::vector<glm::vec3> translationsMeshes;
 	std::vector<glm::quat> rotationsMeshes;
 	std::vector<glm::vec3> scalesMeshes;
@@ -43,17 +90,45 @@ private:
 	std::vector<std::string> loadedTexName;
 	std::vector<Texture> loadedTex;
 
+	// Vertices and indices of a mesh, decoded but not on the GPU yet
+	struct PreparedMesh
+	{
+		// False for meshes without primitives
+		bool valid = false;
+		// 'packed' in 'format' instead of 'vertices', with 'positions' for the bounds
+		bool quantized = false;
+		std::vector<Vertex> vertices;
+		std::vector<unsigned char> packed;
+		VertexFormat format = {};
+		std::vector<glm::vec3> positions;
+		std::vector<GLuint> indices;
+	};
+	// Meshes of a model read with Deferred, by glTF mesh index, until Upload
+	std::vector<PreparedMesh> prepared;
+
+	// Parses the file and gets its buffers
+	void read();
 	// Loads a single mesh by its index
 	void loadMesh(unsigned int indMesh);
+	// Decodes the accessors of a mesh, no GL calls
+	PreparedMesh prepareMesh(unsigned int indMesh);
 
 	// Traverses a node recursively, so it essentially traverses all connected nodes
 	void traverseNode(unsigned int nextNode, glm::mat4 matrix = glm::mat4(1.0f));
 
-	// Gets the binary data from a file
-	std::vector<unsigned char> getData();
+	// Gets the binary data of every buffer, 'glb' is the whole .glb file when loading one
+	void loadBuffers(std::shared_ptr<std::vector<unsigned char>> glb, size_t binOffset, size_t binSize);
+	// Decodes the EXT_meshopt_compression bufferViews on the worker threads and points them at the result
+	void decodeCompressedViews(GltfDocument& document);
+	// Start and size of the bytes a bufferView covers, throws if it is outside its buffer
+	const unsigned char* viewBytes(int bufferView, size_t& size) const;
+	// Name of an embedded image, registered with Texture the first time it is asked for
+	std::string embeddedImage(unsigned int index);
 	// Interprets the binary data into floats, indices, and textures
-	std::vector<float> getFloats(json accessor);
-	std::vector<GLuint> getIndices(json accessor);
+	std::vector<float> getFloats(const GltfAccessor& accessor);
+	std::vector<GLuint> getIndices(const GltfAccessor& accessor);
+	// Copies an attribute into packed vertices without converting it
+	void packAttribute(const GltfAccessor& accessor, const VertexAttribute& attribute, GLsizei stride, std::vector<unsigned char>& packed);
 	std::vector<Texture> getTextures();
 
 	// Assembles all the floats into vertices
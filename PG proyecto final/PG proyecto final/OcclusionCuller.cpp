@@ -0,0 +1,274 @@
+#include"OcclusionCuller.h"
+#include"Camera.h"
+#include"Model.h"
+#include"Profiler.h"
+#include"RenderStats.h"
+#include<algorithm>
+
+bool OcclusionCuller::enabled = true;
+int OcclusionCuller::visibleInterval = 4;
+OcclusionCounters OcclusionCuller::stats;
+
+// Boxes are grown by this much, so a model that was just hidden comes back a little before its edge shows
+static const float boxMargin = 0.1f;
+// Nodes not drawn for this many frames are dropped
+static const int pruneFrames = 300;
+
+OcclusionCuller::OcclusionCuller()
+	: boxShader("occlusion.vert", "occlusion.frag")
+{
+	// Unit cube, the shader stretches it between boxMin and boxMax
+	GLfloat corners[] =
+	{
+		0, 0, 0,  1, 0, 0,  1, 1, 0,  0, 1, 0,
+		0, 0, 1,  1, 0, 1,  1, 1, 1,  0, 1, 1
+	};
+	GLuint indices[] =
+	{
+		0, 2, 1,  0, 3, 2,
+		4, 5, 6,  4, 6, 7,
+		0, 1, 5,  0, 5, 4,
+		3, 6, 2,  3, 7, 6,
+		0, 4, 7,  0, 7, 3,
+		1, 2, 6,  1, 6, 5
+	};
+	glGenVertexArrays(1, &boxVAO);
+	glGenBuffers(1, &boxVBO);
+	glGenBuffers(1, &boxEBO);
+	glBindVertexArray(boxVAO);
+	glBindBuffer(GL_ARRAY_BUFFER, boxVBO);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, boxEBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices, GL_STATIC_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(GLfloat), (void*)0);
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void OcclusionCuller::Draw(const std::vector<Model*>& models, Shader& shader, Camera& camera)
+{
+	PROFILE_SCOPE("Occlusion culling");
+	frame++;
+	stats.models = (int)models.size();
+	stats.outside = 0;
+	stats.occluded = 0;
+	stats.queriesIssued = 0;
+	stats.resultsRead = 0;
+
+	settled = poll();
+	if (!enabled)
+	{
+		settled = true;
+		for (Model* model : models)
+			model->Draw(shader, camera);
+		return;
+	}
+
+	// Box around the bounds of every mesh, and the models sorted front to back so the near ones fill the depth buffer first
+	if (candidates.capacity() < models.size())
+	{
+		candidates.reserve(models.size() * 2);
+		hidden.reserve(models.size() * 2);
+	}
+	candidates.clear();
+	hidden.clear();
+	// View frustum planes from the rows of the view projection matrix (Gribb/Hartmann)
+	glm::mat4 m = glm::transpose(camera.cameraMatrix);
+	glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+	for (Model* model : models)
+	{
+		Candidate candidate;
+		candidate.model = model;
+		model->GetBounds(candidate.boxMin, candidate.boxMax);
+		candidate.boxMin -= glm::vec3(boxMargin);
+		candidate.boxMax += glm::vec3(boxMargin);
+		// Off screen: not queried and not visited, so it counts as new to the view when it comes back
+		if (!inFrustum(planes, candidate.boxMin, candidate.boxMax))
+		{
+			stats.outside++;
+			continue;
+		}
+		glm::vec3 closest = glm::clamp(camera.Position, candidate.boxMin, candidate.boxMax);
+		candidate.distance = glm::length(closest - camera.Position);
+
+		auto found = nodes.find(model);
+		if (found == nodes.end())
+		{
+			found = nodes.emplace(model, Node()).first;
+			glGenQueries(1, &found->second.query);
+			found->second.offset = (int)(nodes.size() % visibleInterval);
+		}
+		candidate.node = &found->second;
+		candidates.push_back(candidate);
+	}
+	std::sort(candidates.begin(), candidates.end(),
+		[](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+
+	for (Candidate& candidate : candidates)
+	{
+		Node& node = *candidate.node;
+		// Just came into view, or the camera is inside the box where its faces would be clipped
+		if (node.lastVisited < frame - 1 || candidate.distance == 0.0f)
+			node.visible = true;
+		node.lastVisited = frame;
+
+		if (!node.visible)
+		{
+			stats.occluded++;
+			if (!node.pending)
+				hidden.push_back(&candidate);
+			continue;
+		}
+
+		// Visible: drawn, and the draw is queried now and then to find out if it got hidden
+		bool test = !node.pending && frame >= node.nextTest && candidate.distance > 0.0f;
+		if (test)
+		{
+			glBeginQuery(GL_ANY_SAMPLES_PASSED, node.query);
+			node.pending = true;
+			node.boxQuery = false;
+			node.issuedFrame = frame;
+			node.issuedTime = std::chrono::steady_clock::now();
+			node.nextTest = frame + visibleInterval + node.offset;
+			stats.queriesIssued++;
+		}
+		candidate.model->Draw(shader, camera);
+		if (test)
+			glEndQuery(GL_ANY_SAMPLES_PASSED);
+	}
+
+	queryBoxes(camera);
+	shader.Activate();
+	if (frame % pruneFrames == 0)
+		prune();
+}
+
+// Reads the results the GPU has, returns false if a hidden model became visible or a box query isn't back.
+// Queries still running are left for a later frame instead of waited for
+bool OcclusionCuller::poll()
+{
+	bool unchanged = true;
+	int latencyFrames = 0;
+	double latencyMs = 0.0;
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	for (auto& entry : nodes)
+	{
+		Node& node = entry.second;
+		if (!node.pending)
+			continue;
+		GLint available = 0;
+		glGetQueryObjectiv(node.query, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+		{
+			unchanged = unchanged && !node.boxQuery;
+			continue;
+		}
+		GLuint samples = 0;
+		glGetQueryObjectuiv(node.query, GL_QUERY_RESULT, &samples);
+		node.pending = false;
+		stats.resultsRead++;
+		latencyFrames += frame - node.issuedFrame;
+		latencyMs += std::chrono::duration<double, std::milli>(now - node.issuedTime).count();
+
+		// A hidden model found visible is tested again after the interval, like the other visible ones
+		bool wasVisible = node.visible;
+		node.visible = samples != 0;
+		if (node.visible && !wasVisible)
+		{
+			node.nextTest = frame + visibleInterval + node.offset;
+			unchanged = false;
+		}
+	}
+	if (stats.resultsRead > 0)
+	{
+		stats.latencyFrames = stats.latencyFrames * 0.9f + (float)latencyFrames / stats.resultsRead * 0.1f;
+		stats.latencyMs = stats.latencyMs * 0.9f + (float)(latencyMs / stats.resultsRead) * 0.1f;
+	}
+	return unchanged;
+}
+
+// Box queries of the hidden candidates, with color and depth writes off
+void OcclusionCuller::queryBoxes(Camera& camera)
+{
+	if (hidden.empty())
+		return;
+	GLboolean culling = glIsEnabled(GL_CULL_FACE);
+	glDisable(GL_CULL_FACE);
+	glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+	glDepthMask(GL_FALSE);
+
+	boxShader.Activate();
+	camera.Matrix(boxShader, "camMatrix");
+	GLint minLocation = glGetUniformLocation(boxShader.ID, "boxMin");
+	GLint maxLocation = glGetUniformLocation(boxShader.ID, "boxMax");
+	glBindVertexArray(boxVAO);
+	for (const Candidate* candidate : hidden)
+	{
+		Node& node = *candidate->node;
+		glUniform3fv(minLocation, 1, &candidate->boxMin.x);
+		glUniform3fv(maxLocation, 1, &candidate->boxMax.x);
+		glBeginQuery(GL_ANY_SAMPLES_PASSED, node.query);
+		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		glEndQuery(GL_ANY_SAMPLES_PASSED);
+		node.pending = true;
+		node.boxQuery = true;
+		node.issuedFrame = frame;
+		node.issuedTime = std::chrono::steady_clock::now();
+		stats.queriesIssued++;
+		RenderStats::frame.drawCalls++;
+		RenderStats::frame.triangles += 12;
+	}
+	glBindVertexArray(0);
+
+	glDepthMask(GL_TRUE);
+	glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	if (culling)
+		glEnable(GL_CULL_FACE);
+}
+
+// True if the box is at least partly on the inner side of every frustum plane. Boxes near a corner of the
+// frustum may pass while outside it, they are then left to the query
+bool OcclusionCuller::inFrustum(const glm::vec4 planes[6], const glm::vec3& boxMin, const glm::vec3& boxMax)
+{
+	for (int i = 0; i < 6; i++)
+	{
+		// Corner of the box furthest along the plane normal
+		glm::vec3 corner(planes[i].x >= 0.0f ? boxMax.x : boxMin.x, planes[i].y >= 0.0f ? boxMax.y : boxMin.y,
+			planes[i].z >= 0.0f ? boxMax.z : boxMin.z);
+		if (glm::dot(glm::vec3(planes[i]), corner) + planes[i].w < 0.0f)
+			return false;
+	}
+	return true;
+}
+
+// Drops models that haven't been drawn for a while, their pointer may be reused
+void OcclusionCuller::prune()
+{
+	for (auto node = nodes.begin(); node != nodes.end();)
+	{
+		if (node->second.lastVisited < frame - pruneFrames && !node->second.pending)
+		{
+			glDeleteQueries(1, &node->second.query);
+			node = nodes.erase(node);
+		}
+		else
+			node++;
+	}
+}
+
+void OcclusionCuller::Reset()
+{
+	for (auto& node : nodes)
+		glDeleteQueries(1, &node.second.query);
+	nodes.clear();
+}
+
+void OcclusionCuller::Delete()
+{
+	Reset();
+	glDeleteVertexArrays(1, &boxVAO);
+	glDeleteBuffers(1, &boxVBO);
+	glDeleteBuffers(1, &boxEBO);
+	boxShader.Delete();
+}
@@ -0,0 +1,101 @@
+#ifndef OCCLUSION_CULLER_CLASS_H
+#define OCCLUSION_CULLER_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<chrono>
+#include<unordered_map>
+#include<vector>
+
+#include"shaderClass.h"
+
+class Camera;
+class Model;
+
+// What occlusion culling did last frame, shown by the stats overlay
+struct OcclusionCounters
+{
+	int models = 0;
+	// Outside the view frustum, neither drawn nor queried
+	int outside = 0;
+	// Left out because their last query found them hidden
+	int occluded = 0;
+	int queriesIssued = 0;
+	int resultsRead = 0;
+	// Smoothed time from issuing a query to reading its result
+	float latencyFrames = 0.0f;
+	float latencyMs = 0.0f;
+};
+
+// Hardware occlusion queries with temporal coherence (CHC++ style). Every model keeps the result of its last
+// GL_ANY_SAMPLES_PASSED query, and results are only read once available, so the CPU never waits for the GPU:
+// - visible models are drawn front to back, and every few frames the draw itself is queried to see if they still are
+// - hidden models are not drawn; their bounding boxes are queried together after the visible ones, against the
+//   finished depth buffer, and the ones found visible are drawn from the frame the result arrives
+// Models outside the view frustum are skipped without a query. A model new to the view, or with the camera
+// inside its box, counts as visible
+class OcclusionCuller
+{
+public:
+	// Needs the GL context, creates the box shader and geometry
+	OcclusionCuller();
+
+	// Render thread: draws 'models' with 'shader' (already active, with the camera matrix set) except the occluded ones
+	void Draw(const std::vector<Model*>& models, Shader& shader, Camera& camera);
+	// True until the box queries are back and none found a hidden model visible, the gallery keeps drawing until then
+	bool Waiting() const { return !settled; }
+	// Forgets every model, models may have been unloaded and their pointers reused since they were queried
+	void Reset();
+	void Delete();
+
+	// Off: every model is drawn
+	static bool enabled;
+	// Frames between queries of a model that is visible
+	static int visibleInterval;
+	static OcclusionCounters stats;
+
+private:
+	struct Node
+	{
+		GLuint query = 0;
+		bool visible = true;
+		bool pending = false;
+		// Box query (hidden model) or query around the draw (visible model)
+		bool boxQuery = false;
+		int lastVisited = -2;
+		int nextTest = 0;
+		int issuedFrame = 0;
+		std::chrono::steady_clock::time_point issuedTime;
+		// Spreads the queries of visible models over the frames
+		int offset = 0;
+	};
+	struct Candidate
+	{
+		float distance;
+		Model* model;
+		Node* node;
+		glm::vec3 boxMin;
+		glm::vec3 boxMax;
+	};
+
+	Shader boxShader;
+	GLuint boxVAO = 0;
+	GLuint boxVBO = 0;
+	GLuint boxEBO = 0;
+	std::unordered_map<const Model*, Node> nodes;
+	// Sized once, reused every frame
+	std::vector<Candidate> candidates;
+	std::vector<const Candidate*> hidden;
+	int frame = 0;
+	bool settled = true;
+
+	// Reads the results the GPU has, returns false if a hidden model became visible or a box query isn't back
+	bool poll();
+	// Box queries of the hidden candidates, with color and depth writes off
+	void queryBoxes(Camera& camera);
+	// True if the box is at least partly on the inner side of every frustum plane
+	static bool inFrustum(const glm::vec4 planes[6], const glm::vec3& boxMin, const glm::vec3& boxMax);
+	// Drops models that haven't been drawn for a while, their pointer may be reused
+	void prune();
+};
+#endif
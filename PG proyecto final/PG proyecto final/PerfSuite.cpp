@@ -0,0 +1,139 @@
+#include"PerfSuite.h"
+#include<json/json.h>
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<iomanip>
+#include<iostream>
+
+// Baseline layout: { "default_tolerance": 0.15, "default_min_delta": 0.05,
+//   "metrics": { "name": { "value": 1.23 or null, "tolerance": 0.2, "min_delta": 0.1 } } }
+// A metric regresses when it exceeds value * (1 + tolerance) by more than min_delta (absolute, for tiny timings)
+static const double defaultTolerance = 0.15;
+static const double defaultMinDelta = 0.05;
+
+void PerfSuite::Add(const std::string& name, double value)
+{
+	metrics.push_back(std::make_pair(name, value));
+}
+
+// Median time of 'repeats' runs of fn, in milliseconds
+double PerfSuite::MedianMs(const std::function<void()>& fn, int repeats)
+{
+	std::vector<double> times;
+	for (int i = 0; i < std::max(repeats, 1); i++)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+		fn();
+		times.push_back(std::chrono::duration<double, std::milli>(std::chrono::high_resolution_clock::now() - start).count());
+	}
+	std::sort(times.begin(), times.end());
+	return times[times.size() / 2];
+}
+
+bool PerfSuite::Write(const std::string& file) const
+{
+	nlohmann::ordered_json out;
+	for (const auto& metric : metrics)
+		out[metric.first] = metric.second;
+	std::ofstream stream(file);
+	if (!stream)
+	{
+		std::cerr << "ERROR: Failed to write " << file << std::endl;
+		return false;
+	}
+	stream << out.dump(2) << std::endl;
+	return true;
+}
+
+static bool loadBaseline(const std::string& file, nlohmann::ordered_json& baseline)
+{
+	std::ifstream in(file);
+	if (!in)
+		return false;
+	try
+	{
+		baseline = nlohmann::ordered_json::parse(in);
+	}
+	catch (const nlohmann::json::exception& error)
+	{
+		std::cerr << "ERROR: " << file << " is not valid JSON: " << error.what() << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Prints every metric next to its baseline, returns false if any got slower than its tolerance allows
+bool PerfSuite::Compare(const std::string& baselineFile, bool requireBaseline) const
+{
+	nlohmann::ordered_json baseline;
+	if (!loadBaseline(baselineFile, baseline))
+	{
+		std::cerr << "ERROR: Failed to read perf baseline " << baselineFile << std::endl;
+		return false;
+	}
+	double tolerance = baseline.value("default_tolerance", defaultTolerance);
+	double minDelta = baseline.value("default_min_delta", defaultMinDelta);
+	const nlohmann::ordered_json& expected = baseline["metrics"];
+
+	int regressions = 0;
+	int missing = 0;
+	std::cout << "PERF: " << std::left << std::setw(52) << "metric" << std::right << std::setw(12) << "value"
+		<< std::setw(12) << "baseline" << std::setw(10) << "change" << std::endl;
+	for (const auto& metric : metrics)
+	{
+		std::cout << "PERF: " << std::left << std::setw(52) << metric.first << std::right << std::fixed << std::setprecision(3)
+			<< std::setw(12) << metric.second;
+
+		auto entry = expected.find(metric.first);
+		if (entry == expected.end() || !entry->contains("value") || (*entry)["value"].is_null())
+		{
+			std::cout << std::setw(12) << "-" << std::setw(10) << "new" << (requireBaseline ? "  NO BASELINE" : "") << std::defaultfloat << std::endl;
+			missing++;
+			continue;
+		}
+		double base = (*entry)["value"].get<double>();
+		double allowed = entry->value("tolerance", tolerance);
+		double delta = entry->value("min_delta", minDelta);
+		double change = base > 0.0 ? (metric.second - base) / base : 0.0;
+		bool regressed = metric.second > base * (1.0 + allowed) && metric.second - base > delta;
+		if (regressed)
+			regressions++;
+
+		std::cout << std::setw(12) << base << std::setw(9) << std::setprecision(1) << change * 100.0 << "%"
+			<< (regressed ? "  REGRESSION" : "") << std::defaultfloat << std::endl;
+	}
+
+	std::cout << "PERF: " << metrics.size() << " metrics, " << regressions << " regressions, " << missing
+		<< " without a baseline value" << std::endl;
+	// A metric nothing is compared with can't catch a regression
+	if (missing > 0)
+	{
+		std::cerr << (requireBaseline ? "ERROR: " : "WARNING: ") << missing << " metrics have no baseline value in " << baselineFile
+			<< ", measure them with --perf-update-baseline on the reference machine" << std::endl;
+	}
+	return regressions == 0 && (!requireBaseline || missing == 0);
+}
+
+// Stores the measured values as the new baseline, keeping the tolerances already in the file
+bool PerfSuite::UpdateBaseline(const std::string& baselineFile) const
+{
+	nlohmann::ordered_json baseline;
+	if (!loadBaseline(baselineFile, baseline))
+	{
+		baseline["default_tolerance"] = defaultTolerance;
+		baseline["default_min_delta"] = defaultMinDelta;
+	}
+	for (const auto& metric : metrics)
+		baseline["metrics"][metric.first]["value"] = metric.second;
+
+	std::ofstream out(baselineFile);
+	if (!out)
+	{
+		std::cerr << "ERROR: Failed to write " << baselineFile << std::endl;
+		return false;
+	}
+	out << baseline.dump(1, '\t') << std::endl;
+	std::cout << "PERF: baseline updated -> " << baselineFile << std::endl;
+	return true;
+}
@@ -0,0 +1,28 @@
+#ifndef PERF_SUITE_CLASS_H
+#define PERF_SUITE_CLASS_H
+
+#include<functional>
+#include<string>
+#include<utility>
+#include<vector>
+
+// Measurements of the performance suite, compared against a baseline taken on the reference machine.
+// Lower is better for every metric
+class PerfSuite
+{
+public:
+	void Add(const std::string& name, double value);
+	// Median time of 'repeats' runs of fn, in milliseconds
+	static double MedianMs(const std::function<void()>& fn, int repeats);
+
+	bool Write(const std::string& file) const;
+	// Prints every metric next to its baseline, returns false if any got slower than its tolerance allows.
+	// Metrics the baseline has no value for yet only print a warning, unless 'requireBaseline' (CI) makes them fail
+	bool Compare(const std::string& baselineFile, bool requireBaseline = false) const;
+	// Stores the measured values as the new baseline, keeping the tolerances already in the file
+	bool UpdateBaseline(const std::string& baselineFile) const;
+
+private:
+	std::vector<std::pair<std::string, double>> metrics;
+};
+#endif
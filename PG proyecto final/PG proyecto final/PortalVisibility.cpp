@@ -0,0 +1,148 @@
+#include"PortalVisibility.h"
+#include"Camera.h"
+#include"Profiler.h"
+#include<algorithm>
+#include<limits>
+
+bool PortalVisibility::enabled = true;
+int PortalVisibility::maxDepth = 8;
+PortalCounters PortalVisibility::stats;
+
+// A camera between rooms (in a doorway gap) counts as in the nearest room this close to it
+static const float roomSnapDistance = 5.0f;
+// Closer than this to a portal's plane, the portal fills the view and the frustum goes through unchanged
+static const float portalNearDistance = 0.5f;
+
+PortalVisibility::PortalVisibility(const std::vector<SceneRoom>& rooms, const std::vector<ScenePortal>& portals)
+	: rooms(rooms), portals(portals), roomPortals(rooms.size()), visible(rooms.size(), 0)
+{
+	for (size_t i = 0; i < portals.size(); i++)
+	{
+		roomPortals[portals[i].rooms[0]].push_back((int)i);
+		roomPortals[portals[i].rooms[1]].push_back((int)i);
+	}
+}
+
+int PortalVisibility::findRoom(glm::vec3 position) const
+{
+	int nearest = -1;
+	float nearestDistance = roomSnapDistance;
+	for (size_t i = 0; i < rooms.size(); i++)
+	{
+		float distance = glm::length(glm::clamp(position, rooms[i].boundsMin, rooms[i].boundsMax) - position);
+		if (distance <= nearestDistance)
+		{
+			nearest = (int)i;
+			nearestDistance = distance;
+			if (distance == 0.0f)
+				break;
+		}
+	}
+	return nearest;
+}
+
+void PortalVisibility::Update(const Camera& camera)
+{
+	stats = PortalCounters();
+	if (rooms.empty())
+		return;
+	PROFILE_SCOPE("Portal visibility");
+	eye = camera.Position;
+	cameraRoom = enabled && !portals.empty() ? findRoom(eye) : -1;
+	std::fill(visible.begin(), visible.end(), (char)(cameraRoom < 0 ? 1 : 0));
+	if (cameraRoom >= 0)
+	{
+		// View frustum planes from the rows of the view projection matrix (Gribb/Hartmann)
+		glm::mat4 m = glm::transpose(camera.cameraMatrix);
+		Frustum frustum;
+		frustum.count = 6;
+		glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+		for (int i = 0; i < 6; i++)
+			frustum.planes[i] = planes[i] / glm::length(glm::vec3(planes[i]));
+		visit(cameraRoom, frustum, -1, 0);
+	}
+	for (char seen : visible)
+		stats.visibleRooms += seen;
+}
+
+// Marks the room and follows its portals with the part of the frustum that goes through each
+void PortalVisibility::visit(int room, const Frustum& frustum, int fromPortal, int depth)
+{
+	visible[room] = 1;
+	if (depth >= maxDepth)
+		return;
+
+	for (int index : roomPortals[room])
+	{
+		if (index == fromPortal)
+			continue;
+		const ScenePortal& portal = portals[index];
+		int next = portal.rooms[0] == room ? portal.rooms[1] : portal.rooms[0];
+		stats.portalsTested++;
+
+		// Degenerate portal (its first points on a line): nothing can be seen through it
+		glm::vec3 normal = glm::cross(portal.points[1] - portal.points[0], portal.points[2] - portal.points[0]);
+		float normalLength = glm::length(normal);
+		if (normalLength <= 0.0f)
+			continue;
+
+		// Standing in the doorway: the portal covers the whole view
+		float planeDistance = std::abs(glm::dot(normal / normalLength, eye - portal.points[0]));
+		if (planeDistance < portalNearDistance)
+		{
+			stats.portalsPassed++;
+			visit(next, frustum, index, depth + 1);
+			continue;
+		}
+
+		// Sutherland-Hodgman: the portal polygon clipped by every plane of the frustum
+		glm::vec3 polygon[maxPoints];
+		glm::vec3 clipped[maxPoints];
+		int count = (int)portal.points.size() < maxPoints ? (int)portal.points.size() : maxPoints;
+		std::copy(portal.points.begin(), portal.points.begin() + count, polygon);
+		for (int p = 0; p < frustum.count && count >= 3; p++)
+		{
+			const glm::vec4& plane = frustum.planes[p];
+			int out = 0;
+			for (int i = 0; i < count; i++)
+			{
+				const glm::vec3& a = polygon[i];
+				const glm::vec3& b = polygon[(i + 1) % count];
+				float da = glm::dot(glm::vec3(plane), a) + plane.w;
+				float db = glm::dot(glm::vec3(plane), b) + plane.w;
+				if (da >= 0.0f && out < maxPoints)
+					clipped[out++] = a;
+				if ((da >= 0.0f) != (db >= 0.0f) && out < maxPoints)
+					clipped[out++] = a + (b - a) * (da / (da - db));
+			}
+			count = out;
+			std::copy(clipped, clipped + count, polygon);
+		}
+		if (count < 3)
+			continue;
+
+		// The narrower frustum: a plane through the eye and each edge of what is left, facing its center
+		glm::vec3 center(0.0f);
+		for (int i = 0; i < count; i++)
+			center += polygon[i];
+		center /= (float)count;
+		Frustum narrowed;
+		narrowed.count = 0;
+		for (int i = 0; i < count && narrowed.count < maxPlanes - 1; i++)
+		{
+			glm::vec3 edgeNormal = glm::cross(polygon[i] - eye, polygon[(i + 1) % count] - eye);
+			float length = glm::length(edgeNormal);
+			if (length < 1e-6f)
+				continue;
+			edgeNormal /= length;
+			if (glm::dot(edgeNormal, center - eye) < 0.0f)
+				edgeNormal = -edgeNormal;
+			narrowed.planes[narrowed.count++] = glm::vec4(edgeNormal, -glm::dot(edgeNormal, eye));
+		}
+		// Keeps the far plane of the view
+		narrowed.planes[narrowed.count++] = frustum.planes[frustum.count - 1];
+
+		stats.portalsPassed++;
+		visit(next, narrowed, index, depth + 1);
+	}
+}
@@ -0,0 +1,64 @@
+#ifndef PORTAL_VISIBILITY_CLASS_H
+#define PORTAL_VISIBILITY_CLASS_H
+
+#include<glm/glm.hpp>
+#include<vector>
+
+#include"Scene.h"
+
+class Camera;
+
+// What portal culling found last frame, shown by the stats overlay
+struct PortalCounters
+{
+	int visibleRooms = 0;
+	int portalsTested = 0;
+	int portalsPassed = 0;
+	// Resident models left out because their room wasn't seen
+	int culledModels = 0;
+};
+
+// Cells and portals visibility: rooms are cells and the doorways between them portals. Starting in the
+// camera's room with the view frustum, every portal still in the frustum narrows it to the planes through
+// the camera and the edges of the part of the portal left, and the room behind is visited with that.
+// Rooms no frustum reaches are not drawn
+class PortalVisibility
+{
+public:
+	PortalVisibility(const std::vector<SceneRoom>& rooms, const std::vector<ScenePortal>& portals);
+
+	// Render thread, once per frame after camera.updateMatrix. Doesn't allocate
+	void Update(const Camera& camera);
+	// Models outside every room (-1) are always visible
+	bool IsVisible(int room) const { return room < 0 || visible[room] != 0; }
+	// Room of the camera, -1 when it's outside all of them and everything is visible
+	int CameraRoom() const { return cameraRoom; }
+
+	// Off: every room is visible
+	static bool enabled;
+	// Longest chain of portals followed from the camera's room
+	static int maxDepth;
+	static PortalCounters stats;
+
+private:
+	// Planes point inwards: dot(xyz, p) + w >= 0 inside
+	static const int maxPlanes = 24;
+	static const int maxPoints = 32;
+	struct Frustum
+	{
+		glm::vec4 planes[maxPlanes];
+		int count;
+	};
+
+	std::vector<SceneRoom> rooms;
+	std::vector<ScenePortal> portals;
+	// Portals of each room
+	std::vector<std::vector<int>> roomPortals;
+	std::vector<char> visible;
+	int cameraRoom = -1;
+	glm::vec3 eye;
+
+	int findRoom(glm::vec3 position) const;
+	void visit(int room, const Frustum& frustum, int fromPortal, int depth);
+};
+#endif
@@ -0,0 +1,172 @@
+#include"Profiler.h"
+#include<json/json.h>
+#include<algorithm>
+#include<chrono>
+#include<fstream>
+#include<iomanip>
+#include<iostream>
+#include<map>
+#include<memory>
+#include<mutex>
+
+std::atomic<bool> Profiler::enabled(false);
+
+// Events of one thread. Only the owning thread writes, readers copy what they need and
+// drop anything the writer may have overwritten meanwhile
+struct ProfileRing
+{
+	unsigned int id;
+	std::string name;
+	std::vector<ProfileEvent> events = std::vector<ProfileEvent>(Profiler::ringSize);
+	std::atomic<uint64_t> written{ 0 };
+};
+
+static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+static std::mutex ringsMutex;
+// Rings are never freed, so events of finished threads can still be exported
+static std::vector<std::unique_ptr<ProfileRing>>& rings()
+{
+	static std::vector<std::unique_ptr<ProfileRing>> all;
+	return all;
+}
+static thread_local ProfileRing* threadRing = nullptr;
+static thread_local std::string threadName;
+
+// Ring of the calling thread, created on its first event
+static ProfileRing* ring()
+{
+	if (!threadRing)
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		rings().push_back(std::make_unique<ProfileRing>());
+		threadRing = rings().back().get();
+		threadRing->id = (unsigned int)rings().size();
+		threadRing->name = threadName.empty() ? "thread " + std::to_string(threadRing->id) : threadName;
+	}
+	return threadRing;
+}
+
+// Copies the events of a ring that are still valid, oldest first
+static std::vector<ProfileEvent> snapshot(const ProfileRing& ring)
+{
+	uint64_t end = ring.written.load(std::memory_order_acquire);
+	uint64_t begin = end > Profiler::ringSize ? end - Profiler::ringSize : 0;
+	std::vector<ProfileEvent> events;
+	events.reserve((size_t)(end - begin));
+	for (uint64_t i = begin; i < end; i++)
+		events.push_back(ring.events[i % Profiler::ringSize]);
+
+	// Events the owner wrapped around and overwrote while they were being copied
+	uint64_t now = ring.written.load(std::memory_order_acquire);
+	uint64_t valid = now > Profiler::ringSize ? now - Profiler::ringSize : 0;
+	if (valid > begin)
+		events.erase(events.begin(), events.begin() + (size_t)std::min(valid - begin, (uint64_t)events.size()));
+	return events;
+}
+
+// Name of the calling thread in the trace
+void Profiler::SetThreadName(const std::string& name)
+{
+	// Threads that never record don't get a ring, the name waits for the first event
+	threadName = name;
+	if (threadRing)
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		threadRing->name = name;
+	}
+}
+
+int64_t Profiler::Now()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+// Stores a finished scope of the calling thread
+void Profiler::Record(const char* name, int64_t start, int64_t end)
+{
+	ProfileRing* own = ring();
+	uint64_t index = own->written.load(std::memory_order_relaxed);
+	own->events[index % ringSize] = ProfileEvent{ name, start, end };
+	own->written.store(index + 1, std::memory_order_release);
+}
+
+// Writes the events still in the rings as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+bool Profiler::WriteChromeTrace(const std::string& file)
+{
+	nlohmann::json events = nlohmann::json::array();
+	size_t count = 0;
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		for (const std::unique_ptr<ProfileRing>& thread : rings())
+		{
+			events.push_back({ { "name", "thread_name" }, { "ph", "M" }, { "pid", 1 }, { "tid", thread->id },
+				{ "args", { { "name", thread->name } } } });
+			for (const ProfileEvent& event : snapshot(*thread))
+			{
+				// Complete events, in microseconds
+				events.push_back({ { "name", event.name }, { "cat", "cpu" }, { "ph", "X" }, { "pid", 1 }, { "tid", thread->id },
+					{ "ts", event.start / 1000.0 }, { "dur", (event.end - event.start) / 1000.0 } });
+				count++;
+			}
+		}
+	}
+
+	std::ofstream out(file);
+	if (!out)
+	{
+		std::cerr << "ERROR: Failed to write profile trace " << file << std::endl;
+		return false;
+	}
+	nlohmann::json trace;
+	trace["traceEvents"] = std::move(events);
+	trace["displayTimeUnit"] = "ms";
+	out << trace.dump() << std::endl;
+	std::cout << "PROFILE: " << count << " events -> " << file << std::endl;
+	return true;
+}
+
+// Time per scope name over the last 'seconds', slowest first
+std::vector<ProfileStat> Profiler::Summary(double seconds)
+{
+	int64_t since = Now() - (int64_t)(seconds * 1e9);
+	std::map<std::string, ProfileStat> byName;
+	{
+		std::lock_guard<std::mutex> lock(ringsMutex);
+		for (const std::unique_ptr<ProfileRing>& thread : rings())
+		{
+			for (const ProfileEvent& event : snapshot(*thread))
+			{
+				if (event.end < since)
+					continue;
+				ProfileStat& stat = byName[event.name];
+				double ms = (event.end - event.start) / 1e6;
+				stat.calls++;
+				stat.totalMs += ms;
+				stat.maxMs = std::max(stat.maxMs, ms);
+			}
+		}
+	}
+
+	std::vector<ProfileStat> stats;
+	for (auto& entry : byName)
+	{
+		entry.second.name = entry.first;
+		stats.push_back(entry.second);
+	}
+	std::sort(stats.begin(), stats.end(), [](const ProfileStat& a, const ProfileStat& b) { return a.totalMs > b.totalMs; });
+	return stats;
+}
+
+void Profiler::PrintSummary(double seconds)
+{
+	std::vector<ProfileStat> stats = Summary(seconds);
+	std::streamsize precision = std::cout.precision();
+	std::cout << "PROFILE: last " << seconds << " s (calls, total ms, mean ms, max ms)" << std::endl;
+	for (const ProfileStat& stat : stats)
+	{
+		std::cout << "  " << std::left << std::setw(28) << stat.name << std::right
+			<< std::setw(8) << stat.calls << std::fixed << std::setprecision(2)
+			<< std::setw(10) << stat.totalMs << std::setw(9) << stat.totalMs / stat.calls
+			<< std::setw(9) << stat.maxMs << std::defaultfloat << std::setprecision(precision) << std::endl;
+	}
+}
@@ -0,0 +1,78 @@
+#ifndef PROFILER_CLASS_H
+#define PROFILER_CLASS_H
+
+#include<atomic>
+#include<cstdint>
+#include<string>
+#include<vector>
+
+// One timed scope. 'name' is never copied, it has to be a string literal
+struct ProfileEvent
+{
+	const char* name;
+	// Nanoseconds since the program started
+	int64_t start;
+	int64_t end;
+};
+
+// Time spent in one scope name over the last few seconds (nested scopes are included in their parent's time)
+struct ProfileStat
+{
+	std::string name;
+	int calls = 0;
+	double totalMs = 0.0;
+	double maxMs = 0.0;
+};
+
+// Scoped CPU timers. Every thread writes its events to its own ring, without locks, and the
+// oldest events are overwritten once the ring is full. Disabled scopes only check a flag
+class Profiler
+{
+public:
+	// Events each thread keeps
+	static const unsigned int ringSize = 1 << 16;
+	static std::atomic<bool> enabled;
+
+	// Name of the calling thread in the trace
+	static void SetThreadName(const std::string& name);
+	static int64_t Now();
+	// Stores a finished scope of the calling thread
+	static void Record(const char* name, int64_t start, int64_t end);
+
+	// Writes the events still in the rings as a Chrome trace (chrome://tracing, ui.perfetto.dev)
+	static bool WriteChromeTrace(const std::string& file);
+	// Time per scope name over the last 'seconds', slowest first
+	static std::vector<ProfileStat> Summary(double seconds);
+	static void PrintSummary(double seconds);
+};
+
+// Times the enclosing block, see PROFILE_SCOPE
+class ProfileScope
+{
+public:
+	ProfileScope(const char* name)
+		: name(Profiler::enabled.load(std::memory_order_relaxed) ? name : nullptr), start(this->name ? Profiler::Now() : 0)
+	{
+	}
+	~ProfileScope()
+	{
+		if (name)
+			Profiler::Record(name, start, Profiler::Now());
+	}
+	ProfileScope(const ProfileScope&) = delete;
+	ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+	const char* name;
+	int64_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+// Defining GALLERY_NO_PROFILER compiles the timers out completely
+#ifdef GALLERY_NO_PROFILER
+#define PROFILE_SCOPE(name)
+#else
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
+#endif
@@ -0,0 +1,62 @@
+#include"RenderStats.h"
+#include"AllocationCounter.h"
+
+RenderCounters RenderStats::frame;
+RenderCounters RenderStats::last;
+size_t RenderStats::bufferBytes = 0;
+uint64_t RenderStats::frameStartAllocations = 0;
+
+// Render thread, after the frame was presented
+void RenderStats::EndFrame()
+{
+	uint64_t allocations = AllocationCounter::ThisThread();
+	frame.heapAllocations = (unsigned int)(allocations - frameStartAllocations);
+	frameStartAllocations = allocations;
+	last = frame;
+	frame = RenderCounters();
+}
+
+GpuPassTimers::GpuPassTimers(unsigned int passes, unsigned int latency)
+	: passes(passes), latency(latency < 2 ? 2 : latency), queries(passes * this->latency), issued(passes * this->latency, false), ms(passes, 0.0)
+{
+	glGenQueries((GLsizei)queries.size(), queries.data());
+}
+
+void GpuPassTimers::BeginFrame()
+{
+	current = (current + 1) % latency;
+
+	// Reads what this set measured 'latency' frames ago, results that aren't ready are dropped instead of waited for
+	for (unsigned int pass = 0; pass < passes; pass++)
+	{
+		unsigned int index = current * passes + pass;
+		if (!issued[index])
+			continue;
+		issued[index] = false;
+
+		GLint available = 0;
+		glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available)
+			continue;
+		GLuint64 elapsed = 0;
+		glGetQueryObjectui64v(queries[index], GL_QUERY_RESULT, &elapsed);
+		ms[pass] = ms[pass] * 0.9 + elapsed / 1000000.0 * 0.1;
+	}
+}
+
+void GpuPassTimers::Begin(unsigned int pass)
+{
+	unsigned int index = current * passes + pass;
+	glBeginQuery(GL_TIME_ELAPSED, queries[index]);
+	issued[index] = true;
+}
+
+void GpuPassTimers::End()
+{
+	glEndQuery(GL_TIME_ELAPSED);
+}
+
+void GpuPassTimers::Delete()
+{
+	glDeleteQueries((GLsizei)queries.size(), queries.data());
+}
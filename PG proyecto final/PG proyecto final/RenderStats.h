@@ -0,0 +1,61 @@
+#ifndef RENDER_STATS_CLASS_H
+#define RENDER_STATS_CLASS_H
+
+#include<glad/glad.h>
+#include<cstddef>
+#include<cstdint>
+#include<vector>
+
+// Work sent to the GPU during one frame
+struct RenderCounters
+{
+	unsigned int drawCalls = 0;
+	size_t triangles = 0;
+	unsigned int textureBinds = 0;
+	unsigned int shaderSwitches = 0;
+	// operator new calls made by the render thread, zero in a steady gallery frame
+	unsigned int heapAllocations = 0;
+};
+
+// Counted where the GL calls are made (Mesh, Texture, Shader, TextRenderer)
+class RenderStats
+{
+public:
+	// Frame being drawn and the last finished one
+	static RenderCounters frame;
+	static RenderCounters last;
+	// Vertex and index buffers of every mesh created so far
+	static size_t bufferBytes;
+
+	// Render thread, after the frame was presented
+	static void EndFrame();
+
+private:
+	static uint64_t frameStartAllocations;
+};
+
+// GL_TIME_ELAPSED queries around each render pass. A frame's queries are only read 'latency' frames
+// later and skipped if still not ready, so reading them never stalls the CPU
+class GpuPassTimers
+{
+public:
+	GpuPassTimers(unsigned int passes, unsigned int latency = 3);
+
+	void BeginFrame();
+	// Passes can't overlap, End closes the pass that was begun last
+	void Begin(unsigned int pass);
+	void End();
+	// Smoothed GPU time of a pass
+	double Milliseconds(unsigned int pass) const { return ms[pass]; }
+	void Delete();
+
+private:
+	unsigned int passes;
+	unsigned int latency;
+	unsigned int current = 0;
+	// latency sets of one query per pass
+	std::vector<GLuint> queries;
+	std::vector<bool> issued;
+	std::vector<double> ms;
+};
+#endif
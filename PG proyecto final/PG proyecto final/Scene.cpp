@@ -0,0 +1,830 @@
+#include"Scene.h"
+#include<json/json.h>
+#include<glm/gtc/matrix_transform.hpp>
+#include<glm/gtc/type_ptr.hpp>
+#include<algorithm>
+#include<cmath>
+#include<cstdint>
+#include<cstring>
+#include<fstream>
+#include<iostream>
+#include<map>
+#include<random>
+
+using json = nlohmann::json;
+
+// Layout of the original gallery room, every generated room is a copy of it
+static const glm::vec3 roomCenter = glm::vec3(0.36923f, 0.174271f, 33.0354f);
+static const float roomRadius = 17.5f;
+static const float roomSpacing = 40.0f;
+// Paintings hang on the wall at this z, sculptures stand inside the box below
+static const float paintingWallZ = 15.5354f;
+static const glm::vec2 floorMin = glm::vec2(-12.0f, 20.0f);
+static const glm::vec2 floorMax = glm::vec2(12.5f, 46.0f);
+// Doorways between generated rooms
+static const float doorWidth = 6.0f;
+static const float doorHeight = 5.0f;
+
+// World space matrix of the placement above
+glm::mat4 SceneInstance::Placement() const
+{
+	glm::mat4 placement = glm::translate(glm::mat4(1.0f), position);
+	placement = glm::rotate(placement, glm::radians(yaw), glm::vec3(0.0f, 1.0f, 0.0f));
+	placement = glm::scale(placement, glm::vec3(size));
+	return glm::translate(placement, -anchor);
+}
+
+static json toJson(const glm::vec3& v)
+{
+	return json::array({ v.x, v.y, v.z });
+}
+
+// Array of at least 'size' elements, throws if it is something else
+static const json& arrayOf(const json& node, const char* key, size_t size)
+{
+	const json& v = node.at(key);
+	if (!v.is_array() || v.size() < size)
+		throw std::invalid_argument(std::string("'") + key + "' needs " + std::to_string(size) + " numbers");
+	return v;
+}
+
+static glm::vec3 vec3Of(const json& node, const char* key, glm::vec3 fallback)
+{
+	if (node.find(key) == node.end())
+		return fallback;
+	const json& v = arrayOf(node, key, 3);
+	return glm::vec3(v[0].get<float>(), v[1].get<float>(), v[2].get<float>());
+}
+
+// Compiled scenes: a header, the string table, then flat arrays of fixed size records read straight from the file.
+// Strings are referenced by offset into the table and every model path is stored once, in the asset table
+static const char binaryMagic[4] = { 'G', 'S', 'C', 'B' };
+static const uint32_t binaryVersion = 4;
+
+struct BinaryString
+{
+	uint32_t offset;
+	uint32_t length;
+};
+
+struct BinaryHeader
+{
+	char magic[4];
+	uint32_t version;
+	uint32_t assets, instances, colliders, lights, audioZones, rooms, portals, portalPoints, cameraKeys, stringBytes;
+	float spawn[3], boundsMin[3], boundsMax[3];
+};
+
+// Bits of BinaryInstance::flags
+static const uint32_t instanceDynamic = 1;
+static const uint32_t instanceOccluder = 2;
+
+struct BinaryInstance
+{
+	uint32_t asset;
+	uint32_t flags;
+	float scale[3], translation[3];
+	// w, x, y, z
+	float rotation[4];
+	float anchor[3], position[3];
+	float yaw, size;
+	int32_t room;
+};
+
+struct BinaryCollider
+{
+	float position[3];
+	float radius;
+	BinaryString title, text;
+};
+
+struct BinaryLight
+{
+	float position[3];
+	float color[4];
+};
+
+struct BinaryAudioZone
+{
+	float position[3];
+	float radius;
+	BinaryString music;
+};
+
+struct BinaryRoom
+{
+	BinaryString name;
+	float boundsMin[3], boundsMax[3];
+};
+
+// Points are portalPoints[firstPoint .. firstPoint + pointCount)
+struct BinaryPortal
+{
+	int32_t rooms[2];
+	uint32_t firstPoint;
+	uint32_t pointCount;
+};
+
+struct BinaryPoint
+{
+	float position[3];
+};
+
+struct BinaryCameraKey
+{
+	float time;
+	float position[3], target[3];
+};
+
+// Detects the compiled form by its magic, anything else is read as JSON
+bool Scene::Load(const std::string& file)
+{
+	std::ifstream in(file, std::ios::binary | std::ios::ate);
+	if (!in)
+	{
+		std::cerr << "ERROR: Failed to open scene " << file << std::endl;
+		return false;
+	}
+	std::vector<char> bytes((size_t)in.tellg());
+	in.seekg(0);
+	in.read(bytes.data(), bytes.size());
+
+	instances.clear();
+	colliders.clear();
+	lights.clear();
+	audioZones.clear();
+	rooms.clear();
+	portals.clear();
+	cameraPath.clear();
+	bool loaded = bytes.size() >= sizeof(binaryMagic) && std::memcmp(bytes.data(), binaryMagic, sizeof(binaryMagic)) == 0
+		? loadBinary(bytes, file) : loadJson(bytes, file);
+	if (loaded)
+		std::cout << "SCENE: " << file << " (" << instances.size() << " instances of " << Assets().size() << " assets, "
+			<< colliders.size() << " colliders)" << std::endl;
+	return loaded;
+}
+
+// Values of the wrong type or missing elements throw like a syntax error, the scene is rejected instead of half read
+bool Scene::loadJson(const std::vector<char>& bytes, const std::string& file)
+{
+	try
+	{
+		json JSON = json::parse(bytes.begin(), bytes.end());
+
+		spawn = vec3Of(JSON, "spawn", spawn);
+		if (JSON.find("bounds") != JSON.end())
+		{
+			boundsMin = vec3Of(JSON["bounds"], "min", boundsMin);
+			boundsMax = vec3Of(JSON["bounds"], "max", boundsMax);
+		}
+
+		for (const json& node : JSON.value("instances", json::array()))
+		{
+			SceneInstance instance;
+			instance.model = node.at("model").get<std::string>();
+			instance.scale = vec3Of(node, "scale", instance.scale);
+			instance.translation = vec3Of(node, "translation", instance.translation);
+			if (node.find("rotation") != node.end())
+			{
+				// Stored as w, x, y, z like glm::quat's constructor
+				const json& q = arrayOf(node, "rotation", 4);
+				instance.rotation = glm::quat(q[0].get<float>(), q[1].get<float>(), q[2].get<float>(), q[3].get<float>());
+			}
+			instance.anchor = vec3Of(node, "anchor", instance.anchor);
+			instance.position = vec3Of(node, "position", instance.position);
+			instance.yaw = node.value("yaw", 0.0f);
+			instance.size = node.value("size", 1.0f);
+			instance.dynamic = node.value("dynamic", false);
+			instance.occluder = node.value("occluder", false);
+			instance.room = node.value("room", -1);
+			instances.push_back(instance);
+		}
+
+		for (const json& node : JSON.value("colliders", json::array()))
+		{
+			SceneCollider collider;
+			collider.position = vec3Of(node, "position", glm::vec3(0.0f));
+			collider.radius = node.value("radius", 1.0f);
+			collider.title = node.value("title", "");
+			collider.text = node.value("text", "");
+			colliders.push_back(collider);
+		}
+
+		for (const json& node : JSON.value("lights", json::array()))
+		{
+			SceneLight light;
+			light.position = vec3Of(node, "position", light.position);
+			if (node.find("color") != node.end())
+			{
+				const json& c = arrayOf(node, "color", 3);
+				light.color = glm::vec4(c[0].get<float>(), c[1].get<float>(), c[2].get<float>(), c.size() > 3 ? c[3].get<float>() : 1.0f);
+			}
+			lights.push_back(light);
+		}
+
+		for (const json& node : JSON.value("audio_zones", json::array()))
+		{
+			SceneAudioZone zone;
+			zone.position = vec3Of(node, "position", glm::vec3(0.0f));
+			zone.radius = node.value("radius", 1.0f);
+			zone.music = node.value("music", "");
+			audioZones.push_back(zone);
+		}
+
+		for (const json& node : JSON.value("rooms", json::array()))
+		{
+			SceneRoom room;
+			room.name = node.value("name", "");
+			room.boundsMin = vec3Of(node, "min", glm::vec3(0.0f));
+			room.boundsMax = vec3Of(node, "max", glm::vec3(0.0f));
+			rooms.push_back(room);
+		}
+		for (const json& node : JSON.value("portals", json::array()))
+		{
+			ScenePortal portal;
+			const json& portalRooms = arrayOf(node, "rooms", 2);
+			portal.rooms[0] = portalRooms[0].get<int>();
+			portal.rooms[1] = portalRooms[1].get<int>();
+			for (const json& point : arrayOf(node, "points", 0))
+			{
+				if (!point.is_array() || point.size() < 3)
+					throw std::invalid_argument("portal points need 3 numbers");
+				portal.points.push_back(glm::vec3(point[0].get<float>(), point[1].get<float>(), point[2].get<float>()));
+			}
+			if (portal.rooms[0] < 0 || portal.rooms[1] < 0 || portal.rooms[0] >= (int)rooms.size() || portal.rooms[1] >= (int)rooms.size()
+				|| portal.points.size() < 3)
+			{
+				std::cerr << "ERROR: Portal " << portals.size() << " needs two rooms and at least three points in " << file << std::endl;
+				return false;
+			}
+			portals.push_back(portal);
+		}
+		for (const SceneInstance& instance : instances)
+		{
+			if (instance.room >= (int)rooms.size())
+			{
+				std::cerr << "ERROR: Instance of " << instance.model << " is in room " << instance.room << " of " << rooms.size() << " in " << file << std::endl;
+				return false;
+			}
+		}
+
+		for (const json& node : JSON.value("camera_path", json::array()))
+		{
+			CameraKey key;
+			key.time = node.value("time", 0.0f);
+			key.position = vec3Of(node, "position", glm::vec3(0.0f));
+			key.target = vec3Of(node, "target", glm::vec3(0.0f, 0.0f, -1.0f));
+			cameraPath.push_back(key);
+		}
+		return true;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "ERROR: Failed to read scene " << file << ": " << e.what() << std::endl;
+		return false;
+	}
+}
+
+// One pass over the records of a compiled scene, every array is checked to be inside the file first
+bool Scene::loadBinary(const std::vector<char>& bytes, const std::string& file)
+{
+	BinaryHeader header;
+	if (bytes.size() < sizeof(header))
+	{
+		std::cerr << "ERROR: Truncated scene " << file << std::endl;
+		return false;
+	}
+	std::memcpy(&header, bytes.data(), sizeof(header));
+	if (header.version != binaryVersion)
+	{
+		std::cerr << "ERROR: Scene " << file << " was compiled with version " << header.version << ", expected " << binaryVersion << std::endl;
+		return false;
+	}
+	size_t expected = sizeof(header) + (size_t)header.stringBytes + header.assets * sizeof(BinaryString)
+		+ header.instances * sizeof(BinaryInstance) + header.colliders * sizeof(BinaryCollider) + header.lights * sizeof(BinaryLight)
+		+ header.audioZones * sizeof(BinaryAudioZone) + header.rooms * sizeof(BinaryRoom) + header.portals * sizeof(BinaryPortal)
+		+ header.portalPoints * sizeof(BinaryPoint) + header.cameraKeys * sizeof(BinaryCameraKey);
+	if (bytes.size() < expected)
+	{
+		std::cerr << "ERROR: Truncated scene " << file << std::endl;
+		return false;
+	}
+
+	const char* cursor = bytes.data() + sizeof(header);
+	const char* strings = cursor;
+	cursor += header.stringBytes;
+	bool valid = true;
+	auto string = [&](const BinaryString& part)
+	{
+		if ((size_t)part.offset + part.length > header.stringBytes)
+		{
+			valid = false;
+			return std::string();
+		}
+		return std::string(strings + part.offset, part.length);
+	};
+	// Copies the next 'count' records out of the file
+	auto records = [&](auto* type, uint32_t count)
+	{
+		std::vector<typename std::remove_pointer<decltype(type)>::type> out(count);
+		std::memcpy(out.data(), cursor, count * sizeof(out[0]));
+		cursor += count * sizeof(out[0]);
+		return out;
+	};
+
+	spawn = glm::make_vec3(header.spawn);
+	boundsMin = glm::make_vec3(header.boundsMin);
+	boundsMax = glm::make_vec3(header.boundsMax);
+
+	std::vector<std::string> assets;
+	for (const BinaryString& asset : records((BinaryString*)nullptr, header.assets))
+		assets.push_back(string(asset));
+
+	instances.reserve(header.instances);
+	for (const BinaryInstance& record : records((BinaryInstance*)nullptr, header.instances))
+	{
+		if (record.asset >= assets.size() || record.room >= (int32_t)header.rooms)
+		{
+			valid = false;
+			break;
+		}
+		SceneInstance instance;
+		instance.model = assets[record.asset];
+		instance.scale = glm::make_vec3(record.scale);
+		instance.translation = glm::make_vec3(record.translation);
+		instance.rotation = glm::quat(record.rotation[0], record.rotation[1], record.rotation[2], record.rotation[3]);
+		instance.anchor = glm::make_vec3(record.anchor);
+		instance.position = glm::make_vec3(record.position);
+		instance.yaw = record.yaw;
+		instance.size = record.size;
+		instance.dynamic = (record.flags & instanceDynamic) != 0;
+		instance.occluder = (record.flags & instanceOccluder) != 0;
+		instance.room = record.room;
+		instances.push_back(instance);
+	}
+
+	colliders.reserve(header.colliders);
+	for (const BinaryCollider& record : records((BinaryCollider*)nullptr, header.colliders))
+		colliders.push_back({ glm::make_vec3(record.position), record.radius, string(record.title), string(record.text) });
+
+	for (const BinaryLight& record : records((BinaryLight*)nullptr, header.lights))
+		lights.push_back({ glm::make_vec3(record.position), glm::make_vec4(record.color) });
+
+	for (const BinaryAudioZone& record : records((BinaryAudioZone*)nullptr, header.audioZones))
+		audioZones.push_back({ glm::make_vec3(record.position), record.radius, string(record.music) });
+
+	for (const BinaryRoom& record : records((BinaryRoom*)nullptr, header.rooms))
+		rooms.push_back({ string(record.name), glm::make_vec3(record.boundsMin), glm::make_vec3(record.boundsMax) });
+
+	std::vector<BinaryPortal> portalRecords = records((BinaryPortal*)nullptr, header.portals);
+	std::vector<BinaryPoint> points = records((BinaryPoint*)nullptr, header.portalPoints);
+	for (const BinaryPortal& record : portalRecords)
+	{
+		if (record.rooms[0] < 0 || record.rooms[1] < 0 || record.rooms[0] >= (int32_t)header.rooms || record.rooms[1] >= (int32_t)header.rooms
+			|| record.pointCount < 3 || (size_t)record.firstPoint + record.pointCount > points.size())
+		{
+			valid = false;
+			break;
+		}
+		ScenePortal portal;
+		portal.rooms[0] = record.rooms[0];
+		portal.rooms[1] = record.rooms[1];
+		for (uint32_t i = 0; i < record.pointCount; i++)
+			portal.points.push_back(glm::make_vec3(points[record.firstPoint + i].position));
+		portals.push_back(portal);
+	}
+
+	cameraPath.reserve(header.cameraKeys);
+	for (const BinaryCameraKey& record : records((BinaryCameraKey*)nullptr, header.cameraKeys))
+		cameraPath.push_back({ record.time, glm::make_vec3(record.position), glm::make_vec3(record.target) });
+
+	if (!valid)
+	{
+		std::cerr << "ERROR: Corrupt scene " << file << std::endl;
+		return false;
+	}
+	return true;
+}
+
+// Every model the instances use, once each and in order of first use
+std::vector<std::string> Scene::Assets() const
+{
+	std::vector<std::string> assets;
+	std::map<std::string, size_t> seen;
+	for (const SceneInstance& instance : instances)
+	{
+		if (seen.emplace(instance.model, assets.size()).second)
+			assets.push_back(instance.model);
+	}
+	return assets;
+}
+
+bool Scene::Save(const std::string& file) const
+{
+	json JSON;
+	JSON["spawn"] = toJson(spawn);
+	JSON["bounds"] = { { "min", toJson(boundsMin) }, { "max", toJson(boundsMax) } };
+
+	json nodes = json::array();
+	for (const SceneInstance& instance : instances)
+	{
+		json node;
+		node["model"] = instance.model;
+		node["scale"] = toJson(instance.scale);
+		node["translation"] = toJson(instance.translation);
+		node["rotation"] = json::array({ instance.rotation.w, instance.rotation.x, instance.rotation.y, instance.rotation.z });
+		node["anchor"] = toJson(instance.anchor);
+		node["position"] = toJson(instance.position);
+		node["yaw"] = instance.yaw;
+		node["size"] = instance.size;
+		if (instance.dynamic)
+			node["dynamic"] = true;
+		if (instance.occluder)
+			node["occluder"] = true;
+		if (instance.room >= 0)
+			node["room"] = instance.room;
+		nodes.push_back(node);
+	}
+	JSON["instances"] = nodes;
+
+	json colliderNodes = json::array();
+	for (const SceneCollider& collider : colliders)
+	{
+		colliderNodes.push_back({ { "position", toJson(collider.position) }, { "radius", collider.radius },
+			{ "title", collider.title }, { "text", collider.text } });
+	}
+	JSON["colliders"] = colliderNodes;
+
+	json lightNodes = json::array();
+	for (const SceneLight& light : lights)
+	{
+		lightNodes.push_back({ { "position", toJson(light.position) },
+			{ "color", json::array({ light.color.r, light.color.g, light.color.b, light.color.a }) } });
+	}
+	JSON["lights"] = lightNodes;
+
+	json zoneNodes = json::array();
+	for (const SceneAudioZone& zone : audioZones)
+		zoneNodes.push_back({ { "position", toJson(zone.position) }, { "radius", zone.radius }, { "music", zone.music } });
+	JSON["audio_zones"] = zoneNodes;
+
+	json roomNodes = json::array();
+	for (const SceneRoom& room : rooms)
+		roomNodes.push_back({ { "name", room.name }, { "min", toJson(room.boundsMin) }, { "max", toJson(room.boundsMax) } });
+	JSON["rooms"] = roomNodes;
+
+	json portalNodes = json::array();
+	for (const ScenePortal& portal : portals)
+	{
+		json points = json::array();
+		for (const glm::vec3& point : portal.points)
+			points.push_back(toJson(point));
+		portalNodes.push_back({ { "rooms", json::array({ portal.rooms[0], portal.rooms[1] }) }, { "points", points } });
+	}
+	JSON["portals"] = portalNodes;
+
+	json path = json::array();
+	for (const CameraKey& key : cameraPath)
+		path.push_back({ { "time", key.time }, { "position", toJson(key.position) }, { "target", toJson(key.target) } });
+	JSON["camera_path"] = path;
+
+	std::ofstream out(file);
+	if (!out)
+	{
+		std::cerr << "ERROR: Failed to write scene " << file << std::endl;
+		return false;
+	}
+	out << JSON.dump(1, '\t') << std::endl;
+	return true;
+}
+
+bool Scene::SaveBinary(const std::string& file) const
+{
+	std::string strings;
+	std::map<std::string, BinaryString> stored;
+	// Equal strings (titles of repeated exhibits, model paths) are stored once
+	auto string = [&](const std::string& text)
+	{
+		auto found = stored.find(text);
+		if (found != stored.end())
+			return found->second;
+		BinaryString part = { (uint32_t)strings.size(), (uint32_t)text.size() };
+		strings += text;
+		stored[text] = part;
+		return part;
+	};
+	auto copy = [](float* out, const float* in, int count) { std::memcpy(out, in, count * sizeof(float)); };
+
+	std::vector<std::string> assets = Assets();
+	std::map<std::string, uint32_t> assetIndex;
+	std::vector<BinaryString> assetRecords;
+	for (const std::string& asset : assets)
+	{
+		assetIndex[asset] = (uint32_t)assetRecords.size();
+		assetRecords.push_back(string(asset));
+	}
+
+	std::vector<BinaryInstance> instanceRecords;
+	for (const SceneInstance& instance : instances)
+	{
+		BinaryInstance record;
+		record.asset = assetIndex[instance.model];
+		record.flags = (instance.dynamic ? instanceDynamic : 0) | (instance.occluder ? instanceOccluder : 0);
+		copy(record.scale, &instance.scale.x, 3);
+		copy(record.translation, &instance.translation.x, 3);
+		float rotation[4] = { instance.rotation.w, instance.rotation.x, instance.rotation.y, instance.rotation.z };
+		copy(record.rotation, rotation, 4);
+		copy(record.anchor, &instance.anchor.x, 3);
+		copy(record.position, &instance.position.x, 3);
+		record.yaw = instance.yaw;
+		record.size = instance.size;
+		record.room = instance.room;
+		instanceRecords.push_back(record);
+	}
+
+	std::vector<BinaryCollider> colliderRecords;
+	for (const SceneCollider& collider : colliders)
+	{
+		BinaryCollider record;
+		copy(record.position, &collider.position.x, 3);
+		record.radius = collider.radius;
+		record.title = string(collider.title);
+		record.text = string(collider.text);
+		colliderRecords.push_back(record);
+	}
+
+	std::vector<BinaryLight> lightRecords;
+	for (const SceneLight& light : lights)
+	{
+		BinaryLight record;
+		copy(record.position, &light.position.x, 3);
+		copy(record.color, &light.color.x, 4);
+		lightRecords.push_back(record);
+	}
+
+	std::vector<BinaryAudioZone> zoneRecords;
+	for (const SceneAudioZone& zone : audioZones)
+	{
+		BinaryAudioZone record;
+		copy(record.position, &zone.position.x, 3);
+		record.radius = zone.radius;
+		record.music = string(zone.music);
+		zoneRecords.push_back(record);
+	}
+
+	std::vector<BinaryRoom> roomRecords;
+	for (const SceneRoom& room : rooms)
+	{
+		BinaryRoom record;
+		record.name = string(room.name);
+		copy(record.boundsMin, &room.boundsMin.x, 3);
+		copy(record.boundsMax, &room.boundsMax.x, 3);
+		roomRecords.push_back(record);
+	}
+
+	std::vector<BinaryPortal> portalRecords;
+	std::vector<BinaryPoint> pointRecords;
+	for (const ScenePortal& portal : portals)
+	{
+		portalRecords.push_back({ { portal.rooms[0], portal.rooms[1] }, (uint32_t)pointRecords.size(), (uint32_t)portal.points.size() });
+		for (const glm::vec3& point : portal.points)
+			pointRecords.push_back({ { point.x, point.y, point.z } });
+	}
+
+	std::vector<BinaryCameraKey> keyRecords;
+	for (const CameraKey& key : cameraPath)
+	{
+		BinaryCameraKey record;
+		record.time = key.time;
+		copy(record.position, &key.position.x, 3);
+		copy(record.target, &key.target.x, 3);
+		keyRecords.push_back(record);
+	}
+
+	BinaryHeader header;
+	std::memcpy(header.magic, binaryMagic, sizeof(binaryMagic));
+	header.version = binaryVersion;
+	header.assets = (uint32_t)assetRecords.size();
+	header.instances = (uint32_t)instanceRecords.size();
+	header.colliders = (uint32_t)colliderRecords.size();
+	header.lights = (uint32_t)lightRecords.size();
+	header.audioZones = (uint32_t)zoneRecords.size();
+	header.rooms = (uint32_t)roomRecords.size();
+	header.portals = (uint32_t)portalRecords.size();
+	header.portalPoints = (uint32_t)pointRecords.size();
+	header.cameraKeys = (uint32_t)keyRecords.size();
+	header.stringBytes = (uint32_t)strings.size();
+	copy(header.spawn, &spawn.x, 3);
+	copy(header.boundsMin, &boundsMin.x, 3);
+	copy(header.boundsMax, &boundsMax.x, 3);
+
+	std::ofstream out(file, std::ios::binary);
+	if (!out)
+	{
+		std::cerr << "ERROR: Failed to write scene " << file << std::endl;
+		return false;
+	}
+	auto write = [&](const auto& records) { out.write((const char*)records.data(), records.size() * sizeof(records[0])); };
+	out.write((const char*)&header, sizeof(header));
+	out.write(strings.data(), strings.size());
+	write(assetRecords);
+	write(instanceRecords);
+	write(colliderRecords);
+	write(lightRecords);
+	write(zoneRecords);
+	write(roomRecords);
+	write(portalRecords);
+	write(pointRecords);
+	write(keyRecords);
+	return (bool)out;
+}
+
+// The hand placed gallery of the original project
+Scene Scene::Gallery()
+{
+	Scene scene;
+	auto add = [&](const char* model, float scale, glm::vec3 translation, glm::quat rotation)
+	{
+		SceneInstance instance;
+		instance.model = model;
+		instance.scale = glm::vec3(scale);
+		instance.translation = translation;
+		instance.rotation = rotation;
+		scene.instances.push_back(instance);
+	};
+	add("modelos/piso/scene.gltf", 2.0f, glm::vec3(0.0f, 13.0f, 0.0f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/da vinci/mona_lisa/scene.gltf", 0.8f, glm::vec3(3.0f, 16.5f, -4.0f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/miguel ang/david2/scene.gltf", 0.6f, glm::vec3(-0.7f, 31.0f, 5.4f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/miguel ang/pieta/scene.gltf", 1.3f, glm::vec3(13.0f, 18.0f, 0.8f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/miguel ang/moises/scene.gltf", 0.6f, glm::vec3(8.0f, 27.0f, -8.5f), glm::quat(0.0f, 0.0f, 1.0f, 0.0f));
+	add("modelos/Botticelli/joven/scene.gltf", 2.1f, glm::vec3(0.5f, 4.35f, -1.3f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/room2/scene.gltf", 1.3f, glm::vec3(0.0f, 20.0f, 0.5f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/fidias/atena/scene.gltf", 0.3f, glm::vec3(-11.0f, 5.0f, 18.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/policleto/dori/scene.gltf", 0.31f, glm::vec3(-20.0f, 58.0f, 28.5f), glm::quat(0.0f, 0.0f, 1.0f, 0.0f));
+	add("modelos/praxi/afrodita/scene.gltf", 0.7f, glm::vec3(10.0f, -12.0f, -22.5f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f));
+	add("modelos/van gogh/noche_estrella/scene.gltf", 0.9f, glm::vec3(-3.0f, 16.2f, -4.0f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/torso/scene.gltf", 1.5f, glm::vec3(3.8f, 26.0f, 1.5f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/pilar/scene.gltf", 0.09f, glm::vec3(-16.0f, 28.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/pilar/scene.gltf", 0.09f, glm::vec3(-16.0f, 42.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/pilar/scene.gltf", 0.09f, glm::vec3(16.0f, 28.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/pilar/scene.gltf", 0.09f, glm::vec3(16.0f, 42.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/vase/rosa1/scene.gltf", 1.8f, glm::vec3(-3.0f, 10.5f, -1.6f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/vase/rosa2/scene.gltf", 0.7f, glm::vec3(-8.0f, 51.3f, -12.4f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/vase/rosa3/scene.gltf", 1.5f, glm::vec3(-15.5f, 26.4f, 4.1f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	add("modelos/vase/rosa4/scene.gltf", 1.5f, glm::vec3(3.7f, 22.0f, -2.3f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+	// The floor and the walls of the room hide what is behind them
+	scene.instances[0].occluder = true;
+	scene.instances[6].occluder = true;
+
+	// Add Collider to scultures and set the info
+	scene.colliders = {
+		{ glm::vec3(0.3201f, 3.97696f, 32.9264f), 3.0f, "David", "Escultura de Miguel angel (1501-1504). Marmol blanco de 5.17 metros." },
+		{ glm::vec3(-13.9183f, 2.28625f, 18.5213f), 3.0f, "La Piedad", "Escultura de Miguel angel (1498-1499). Marmol, Basilica de San Pedro." },
+		{ glm::vec3(16.4938f, 3.65387f, 16.5488f), 2.0f, "Atenea Partenos", "Escultura de Fidias (siglo V a.C.). Replica moderna." },
+		{ glm::vec3(14.8127f, 3.80944f, 49.5978f), 2.0f, "Doriforo", "Escultura de Policleto (450-440 a.C.). Copia romana en marmol." },
+		{ glm::vec3(8.51457f, 2.15766f, 49.942f), 2.0f, "Afrodita de Cnido", "Escultura de Praxoteles (siglo IV a.C.). Copia romana." },
+		{ glm::vec3(-8.46455f, 1.67231f, 50.2564f), 2.0f, "Moises", "Escultura de Miguel angel (1513-1515). Marmol, tumba del Papa Julio II." },
+		{ glm::vec3(-16.9746f, 2.62017f, 45.6913f), 2.0f, "Torso de Belvedere", "Escultura helenestica (siglo I a.C.). Marmol, Museos Vaticanos." },
+		{ glm::vec3(-5.30144f, 2.5f, 15.5354f), 0.5f, "La Mona Lisa", "Obra maestra de Leonardo da Vinci (1503-1519). Pintura al oleo sobre tabla de alamo." },
+		{ glm::vec3(-0.381448f, 2.5f, 15.5354f), 0.5f, "Retrato de una joven", "Obra maestra de Sandro Botticelli (1480-1485). Pintura al temple sobre madera." },
+		{ glm::vec3(6.81855f, 2.5f, 15.5354f), 0.5f, "La Noche Estrellada", "Pintura de Vincent van Gogh (1889). oleo sobre lienzo." },
+		{ glm::vec3(-17.1125f, 2.5f, 25.5523f), 1.0f, "Pilares decorativos", "" },
+		{ glm::vec3(-17.1308f, 2.5f, 38.5671f), 1.0f, "Pilares decorativos", "" },
+		{ glm::vec3(17.507f, 2.5f, 25.7276f), 1.0f, "Pilares decorativos", "" },
+		{ glm::vec3(17.1492f, 2.5f, 38.6279f), 1.0f, "Pilares decorativos", "" },
+	};
+
+	scene.lights.push_back(SceneLight());
+	scene.spawn = glm::vec3(0.0f, 2.0f, 60.0f);
+	scene.boundsMin = roomCenter - glm::vec3(roomRadius, 0.174271f, roomRadius);
+	scene.boundsMax = roomCenter + glm::vec3(roomRadius, roomRadius / 2, roomRadius);
+	scene.cameraPath = CameraPath::Default().keys;
+	return scene;
+}
+
+// Exhibits of the gallery the generator picks from: the instance, its collider (whose position is
+// where the exhibit stands) and whether it hangs on the wall. Every other instance is part of the room
+struct ExhibitTemplate
+{
+	int instance;
+	int collider;
+	bool painting;
+};
+static const ExhibitTemplate exhibitTemplates[] = {
+	{ 2, 0, false }, { 3, 1, false }, { 7, 2, false }, { 8, 3, false }, { 9, 4, false },
+	{ 4, 5, false }, { 11, 6, false }, { 1, 7, true }, { 5, 8, true }, { 10, 9, true },
+};
+
+// Lays out 'rooms' copies of the gallery room, each with 'exhibits' exhibits picked and placed at random from 'seed'
+Scene Scene::Generate(int rooms, int exhibits, unsigned int seed)
+{
+	Scene gallery = Gallery();
+	Scene scene;
+	std::mt19937 random(seed);
+	std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+	const int numTemplates = sizeof(exhibitTemplates) / sizeof(exhibitTemplates[0]);
+
+	std::vector<bool> isExhibit(gallery.instances.size(), false);
+	std::vector<bool> isExhibitCollider(gallery.colliders.size(), false);
+	for (const ExhibitTemplate& exhibit : exhibitTemplates)
+	{
+		isExhibit[exhibit.instance] = true;
+		isExhibitCollider[exhibit.collider] = true;
+	}
+
+	// Rooms on a square grid growing away from the entrance, room 0 is where the original gallery is
+	int columns = std::max(1, (int)std::ceil(std::sqrt((float)rooms)));
+	float time = 0.0f;
+	for (int room = 0; room < rooms; room++)
+	{
+		glm::vec3 offset = glm::vec3((room % columns) * roomSpacing, 0.0f, -(room / columns) * roomSpacing);
+		scene.rooms.push_back({ "room " + std::to_string(room), gallery.boundsMin + offset, gallery.boundsMax + offset });
+
+		// Floor, walls, pillars and vases
+		for (unsigned int i = 0; i < gallery.instances.size(); i++)
+		{
+			if (isExhibit[i])
+				continue;
+			SceneInstance instance = gallery.instances[i];
+			instance.position = offset;
+			instance.room = room;
+			scene.instances.push_back(instance);
+		}
+		for (unsigned int i = 0; i < gallery.colliders.size(); i++)
+		{
+			if (isExhibitCollider[i])
+				continue;
+			SceneCollider collider = gallery.colliders[i];
+			collider.position += offset;
+			scene.colliders.push_back(collider);
+		}
+
+		// Exhibits: sculptures anywhere on the floor, paintings along the wall. A few tries are
+		// made to keep them apart, crowded rooms end up with overlapping exhibits
+		std::vector<SceneCollider> placed;
+		for (int e = 0; e < exhibits; e++)
+		{
+			const ExhibitTemplate& exhibit = exhibitTemplates[random() % numTemplates];
+			const SceneCollider& source = gallery.colliders[exhibit.collider];
+			SceneInstance instance = gallery.instances[exhibit.instance];
+			instance.room = room;
+			instance.anchor = source.position;
+			instance.size = 0.85f + 0.3f * unit(random);
+			instance.yaw = exhibit.painting ? 0.0f : 360.0f * unit(random);
+
+			SceneCollider collider = source;
+			collider.radius *= instance.size;
+			for (int tries = 0; tries < 30; tries++)
+			{
+				glm::vec3 position = exhibit.painting
+					? glm::vec3(floorMin.x + (floorMax.x - floorMin.x) * unit(random), source.position.y, paintingWallZ)
+					: glm::vec3(floorMin.x + (floorMax.x - floorMin.x) * unit(random), source.position.y,
+						floorMin.y + (floorMax.y - floorMin.y) * unit(random));
+				collider.position = position + offset;
+
+				bool free = true;
+				for (const SceneCollider& other : placed)
+					free = free && glm::length(other.position - collider.position) > other.radius + collider.radius + 1.0f;
+				if (free)
+					break;
+			}
+			instance.position = collider.position;
+			placed.push_back(collider);
+			scene.instances.push_back(instance);
+			scene.colliders.push_back(collider);
+		}
+
+		// A doorway in the middle of the wall shared with the next room of the row and of the column.
+		// Rooms are roomSpacing apart, so the doorway stands halfway across the gap between their boxes
+		glm::vec3 doorMin = gallery.boundsMin + offset;
+		glm::vec3 doorMax = glm::vec3(gallery.boundsMax.x, gallery.boundsMin.y + doorHeight, gallery.boundsMax.z) + offset;
+		glm::vec3 center = roomCenter + offset;
+		if (room % columns + 1 < columns && room + 1 < rooms)
+		{
+			float x = doorMax.x + (roomSpacing - (gallery.boundsMax.x - gallery.boundsMin.x)) / 2;
+			scene.portals.push_back({ { room, room + 1 }, {
+				glm::vec3(x, doorMin.y, center.z - doorWidth / 2), glm::vec3(x, doorMin.y, center.z + doorWidth / 2),
+				glm::vec3(x, doorMax.y, center.z + doorWidth / 2), glm::vec3(x, doorMax.y, center.z - doorWidth / 2) } });
+		}
+		if (room + columns < rooms)
+		{
+			float z = doorMin.z - (roomSpacing - (gallery.boundsMax.z - gallery.boundsMin.z)) / 2;
+			scene.portals.push_back({ { room, room + columns }, {
+				glm::vec3(center.x - doorWidth / 2, doorMin.y, z), glm::vec3(center.x + doorWidth / 2, doorMin.y, z),
+				glm::vec3(center.x + doorWidth / 2, doorMax.y, z), glm::vec3(center.x - doorWidth / 2, doorMax.y, z) } });
+		}
+
+		// The benchmark walks in from the entrance, then along the painting wall
+		scene.cameraPath.push_back({ time, offset + glm::vec3(0.0f, 2.5f, 48.0f), offset + roomCenter + glm::vec3(0.0f, 2.5f, 0.0f) });
+		scene.cameraPath.push_back({ time + 4.0f, offset + glm::vec3(-8.0f, 2.5f, 24.0f), offset + glm::vec3(0.0f, 2.5f, paintingWallZ) });
+		scene.cameraPath.push_back({ time + 8.0f, offset + glm::vec3(8.0f, 2.5f, 24.0f), offset + glm::vec3(12.0f, 2.5f, paintingWallZ) });
+		time += 12.0f;
+	}
+
+	int rows = (rooms + columns - 1) / columns;
+	scene.lights = gallery.lights;
+	scene.spawn = gallery.spawn;
+	scene.boundsMin = gallery.boundsMin - glm::vec3(0.0f, 0.0f, (rows - 1) * roomSpacing);
+	scene.boundsMax = gallery.boundsMax + glm::vec3((columns - 1) * roomSpacing, 0.0f, 0.0f);
+	return scene;
+}
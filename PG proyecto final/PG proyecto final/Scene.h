@@ -0,0 +1,110 @@
+#ifndef SCENE_CLASS_H
+#define SCENE_CLASS_H
+
+#include<glm/glm.hpp>
+#include<glm/gtc/quaternion.hpp>
+#include<string>
+#include<vector>
+
+#include"Benchmark.h"
+
+// One model placed in the scene
+struct SceneInstance
+{
+	std::string model;
+	// Transform handed to Model, tuned by hand for each asset
+	glm::vec3 scale = glm::vec3(1.0f);
+	glm::vec3 translation = glm::vec3(0.0f);
+	glm::quat rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f);
+
+	// Moves the placed model in world space: 'anchor' ends up at 'position', turned 'yaw' degrees and resized by 'size'
+	glm::vec3 anchor = glm::vec3(0.0f);
+	glm::vec3 position = glm::vec3(0.0f);
+	float yaw = 0.0f;
+	float size = 1.0f;
+	// Dynamic instances may be moved after loading, static ones keep the transform they were loaded with
+	bool dynamic = false;
+	// Large static geometry (walls, floors, pedestals) the CPU occlusion culling rasterizes to hide what is behind it
+	bool occluder = false;
+	// Room it streams in with, -1 keeps it loaded all the time
+	int room = -1;
+
+	// World space matrix of the placement above
+	glm::mat4 Placement() const;
+};
+
+// Sphere the camera can't walk into, with the text shown when touching it
+struct SceneCollider
+{
+	glm::vec3 position;
+	float radius;
+	std::string title;
+	std::string text;
+};
+
+// Point light, default.frag lights the gallery with the first one
+struct SceneLight
+{
+	glm::vec3 position = glm::vec3(0.5f, 0.5f, 0.5f);
+	glm::vec4 color = glm::vec4(1.0f);
+};
+
+// Part of the scene that is loaded and unloaded as a whole, depending on how close the visitor is to its box
+struct SceneRoom
+{
+	std::string name;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+};
+
+// Doorway between two rooms, a convex polygon the rooms can see each other through
+struct ScenePortal
+{
+	int rooms[2];
+	std::vector<glm::vec3> points;
+};
+
+// Sphere where 'music' plays instead of the gallery's songs
+struct SceneAudioZone
+{
+	glm::vec3 position;
+	float radius;
+	std::string music;
+};
+
+// Models, colliders, lights and camera limits of a gallery. Authored as JSON and compiled to a binary
+// file (--compile-scene) that loads without parsing, Load takes either
+class Scene
+{
+public:
+	std::vector<SceneInstance> instances;
+	std::vector<SceneCollider> colliders;
+	std::vector<SceneLight> lights;
+	std::vector<SceneAudioZone> audioZones;
+	// Empty when everything is loaded at start and always drawn
+	std::vector<SceneRoom> rooms;
+	std::vector<ScenePortal> portals;
+	// Where the visitor enters and the box the camera is kept in
+	glm::vec3 spawn = glm::vec3(0.0f, 2.0f, 60.0f);
+	glm::vec3 boundsMin = glm::vec3(0.0f);
+	glm::vec3 boundsMax = glm::vec3(0.0f);
+	// Path the benchmark flies through this scene
+	std::vector<CameraKey> cameraPath;
+
+	bool Load(const std::string& file);
+	bool Save(const std::string& file) const;
+	bool SaveBinary(const std::string& file) const;
+
+	// Every model the instances use, once each and in order of first use
+	std::vector<std::string> Assets() const;
+
+	// The hand placed gallery of the original project
+	static Scene Gallery();
+	// Lays out 'rooms' copies of the gallery room, each with 'exhibits' exhibits picked and placed at random from 'seed'
+	static Scene Generate(int rooms, int exhibits, unsigned int seed);
+
+private:
+	bool loadJson(const std::vector<char>& bytes, const std::string& file);
+	bool loadBinary(const std::vector<char>& bytes, const std::string& file);
+};
+#endif
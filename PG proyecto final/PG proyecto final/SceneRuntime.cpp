@@ -0,0 +1,318 @@
+#include"SceneRuntime.h"
+#include"Camera.h"
+#include"ImpostorRenderer.h"
+#include"MemoryTracker.h"
+#include"Profiler.h"
+#include"ThreadPool.h"
+#include<algorithm>
+#include<chrono>
+#include<iostream>
+#include<map>
+
+SceneRuntime::SceneRuntime(const Scene& scene, Camera& camera)
+	: instances(scene.instances), audioZones(scene.audioZones), rooms(scene.rooms.size()), loaded(scene.instances.size()),
+	streamer(scene.rooms), visibility(scene.rooms, scene.portals), lastPosition(scene.spawn)
+{
+	PROFILE_SCOPE("Scene build");
+	for (const SceneCollider& collider : scene.colliders)
+		camera.AddCollider(collider.position, collider.radius, collider.title, collider.text);
+
+	// One asset per file, shared by every instance of it. Instances without a room keep theirs loaded.
+	// The workers write into the assets, so they are only acquired once 'assets' doesn't grow anymore
+	std::map<std::string, unsigned int> assetIndex;
+	std::vector<unsigned int> roomless;
+	for (unsigned int i = 0; i < instances.size(); i++)
+	{
+		const SceneInstance& instance = instances[i];
+		auto found = assetIndex.find(instance.model);
+		if (found == assetIndex.end())
+		{
+			found = assetIndex.emplace(instance.model, (unsigned int)assets.size()).first;
+			assets.emplace_back();
+			assets.back().path = std::make_unique<std::string>(instance.model);
+		}
+		instanceAssets.push_back(found->second);
+		if (instance.room >= 0)
+		{
+			Room& room = rooms[instance.room];
+			room.instances.push_back(i);
+			if (std::find(room.assets.begin(), room.assets.end(), found->second) == room.assets.end())
+				room.assets.push_back(found->second);
+		}
+		else
+			roomless.push_back(found->second);
+	}
+	for (unsigned int asset : roomless)
+		acquire(asset);
+
+	// Rooms in reach of the spawn point are there for the first frame. The workers read every file at
+	// once while this thread uploads them in turn
+	streamer.Update(scene.spawn, camera.Orientation, 0, 0, false);
+	for (int room : streamer.Wanted())
+	{
+		rooms[room].requested = true;
+		rooms[room].resident = true;
+		for (unsigned int asset : rooms[room].assets)
+			acquire(asset);
+	}
+	for (Asset& asset : assets)
+	{
+		if (asset.state == AssetReading)
+		{
+			asset.job.wait();
+			finishRead(asset);
+		}
+	}
+	for (unsigned int i = 0; i < instances.size(); i++)
+	{
+		if (instances[i].room < 0 || rooms[instances[i].room].resident)
+			instantiate(i);
+	}
+
+	// Sized once, rebuilding them doesn't allocate
+	models.reserve(instances.size());
+	dynamicModels.reserve(instances.size());
+	visibleModels.reserve(instances.size());
+	occluderModels.reserve(instances.size());
+	modelRooms.reserve(instances.size());
+	modelOccluders.reserve(instances.size());
+	rebuildModels();
+	std::cout << "SCENE: " << models.size() << " of " << instances.size() << " instances loaded from " << assets.size() << " files, "
+		<< rooms.size() << " rooms, " << dynamicModels.size() << " dynamic" << std::endl;
+}
+
+SceneRuntime::~SceneRuntime()
+{
+	for (Asset& asset : assets)
+	{
+		if (asset.job.valid())
+			asset.job.wait();
+	}
+}
+
+// Render thread, once per frame: loads and unloads rooms around the camera. Returns true if 'models' changed
+bool SceneRuntime::Update(const Camera& camera)
+{
+	if (rooms.empty())
+		return false;
+	PROFILE_SCOPE("Level streaming");
+	bool changed = false;
+
+	// Where the visitor is walking, where they look when standing still
+	glm::vec3 moved = camera.Position - lastPosition;
+	glm::vec3 direction = glm::length(moved) > 0.0001f ? glm::normalize(moved) : camera.Orientation;
+	lastPosition = camera.Position;
+
+	size_t cpuBytes = MemoryTracker::Total(MemoryFileData) + MemoryTracker::Total(MemoryJson) + MemoryTracker::Total(MemoryGeometry);
+	size_t gpuBytes = MemoryTracker::Total(MemoryTextures) + MemoryTracker::Total(MemoryBuffers);
+	streamer.Update(camera.Position, direction, cpuBytes, gpuBytes, !Loading());
+
+	// Rooms left behind lose their instances now and their files once no other room uses them
+	for (size_t r = 0; r < rooms.size(); r++)
+	{
+		Room& room = rooms[r];
+		if (!room.requested || streamer.IsWanted((int)r))
+			continue;
+		for (unsigned int instance : room.instances)
+			loaded[instance].reset();
+		for (unsigned int asset : room.assets)
+			release(asset);
+		if (room.resident)
+			changed = true;
+		else
+			waitingRooms--;
+		room.requested = false;
+		room.resident = false;
+	}
+
+	// Rooms coming into reach, most urgent first so their files are read first
+	for (int r : streamer.Wanted())
+	{
+		Room& room = rooms[r];
+		if (room.requested)
+			continue;
+		room.requested = true;
+		waitingRooms++;
+		for (unsigned int asset : room.assets)
+			acquire(asset);
+	}
+
+	// One finished file is uploaded per frame, for the most urgent room waiting for one.
+	// A room shows up once all of its files are there
+	bool uploaded = false;
+	for (int r : streamer.Wanted())
+	{
+		Room& room = rooms[r];
+		if (room.resident)
+			continue;
+		bool ready = true;
+		for (unsigned int a : room.assets)
+		{
+			Asset& asset = assets[a];
+			if (asset.state == AssetReading && !uploaded && asset.job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			{
+				finishRead(asset);
+				uploaded = true;
+			}
+			ready = ready && (asset.state == AssetReady || asset.state == AssetFailed);
+		}
+		if (ready)
+		{
+			for (unsigned int instance : room.instances)
+				instantiate(instance);
+			room.resident = true;
+			waitingRooms--;
+			changed = true;
+		}
+	}
+
+	// Files nobody needs anymore: finished reads are dropped, uploaded models deleted. A model waits while a texture
+	// decode (the loaders' or residency's) or upload still refers to one of its textures, the name could be reused
+	for (Asset& asset : assets)
+	{
+		if (asset.users > 0)
+			continue;
+		if (asset.state == AssetReading && asset.job.wait_for(std::chrono::seconds(0)) == std::future_status::ready)
+			finishRead(asset);
+		else if (asset.state == AssetReady && !asset.model->TexturesBusy())
+		{
+			if (ImpostorRenderer::active)
+				ImpostorRenderer::active->Forget(*asset.path);
+			asset.model->Delete();
+			asset.model.reset();
+			asset.state = AssetUnloaded;
+			LevelStreamer::stats.unloads++;
+		}
+	}
+
+	LevelStreamer::stats.residentRooms = 0;
+	for (const Room& room : rooms)
+		LevelStreamer::stats.residentRooms += room.resident ? 1 : 0;
+	if (changed)
+		rebuildModels();
+	return changed;
+}
+
+// Starts reading a file on the workers the first time something needs it
+void SceneRuntime::acquire(unsigned int index)
+{
+	Asset& asset = assets[index];
+	asset.users++;
+	if (asset.state != AssetUnloaded)
+		return;
+	asset.state = AssetReading;
+	LevelStreamer::stats.loadingAssets++;
+	Asset* target = &asset;
+	asset.job = ThreadPool::Shared().Submit([target]()
+	{
+		try
+		{
+			target->read = std::make_unique<Model>(target->path->c_str(), Model::Deferred());
+		}
+		catch (const std::exception& e)
+		{
+			target->error = e.what();
+		}
+	});
+}
+
+// The file is deleted by Update once no room uses it
+void SceneRuntime::release(unsigned int index)
+{
+	assets[index].users--;
+}
+
+// Render thread: creates the GL objects of a finished read, or drops it if nobody needs it anymore
+void SceneRuntime::finishRead(Asset& asset)
+{
+	LevelStreamer::stats.loadingAssets--;
+	if (!asset.error.empty())
+	{
+		std::cerr << "ERROR: Failed to load " << *asset.path << ": " << asset.error << std::endl;
+		asset.state = AssetFailed;
+		return;
+	}
+	if (asset.users == 0)
+	{
+		asset.read.reset();
+		asset.state = AssetUnloaded;
+		return;
+	}
+
+	asset.model = std::move(asset.read);
+	try
+	{
+		asset.model->Upload();
+		asset.state = AssetReady;
+		LevelStreamer::stats.loads++;
+	}
+	catch (const std::exception& e)
+	{
+		std::cerr << "ERROR: Failed to load " << *asset.path << ": " << e.what() << std::endl;
+		asset.model->Delete();
+		asset.model.reset();
+		asset.state = AssetFailed;
+	}
+}
+
+void SceneRuntime::instantiate(unsigned int index)
+{
+	const SceneInstance& instance = instances[index];
+	const Asset& asset = assets[instanceAssets[index]];
+	if (asset.state != AssetReady)
+		return;
+	PROFILE_SCOPE("Scene instance");
+	loaded[index] = std::make_unique<Model>(*asset.model, instance.scale, instance.translation, instance.rotation, instance.Placement());
+	loaded[index]->impostor = !instance.dynamic && !instance.occluder;
+}
+
+void SceneRuntime::rebuildModels()
+{
+	models.clear();
+	dynamicModels.clear();
+	modelRooms.clear();
+	modelOccluders.clear();
+	for (unsigned int i = 0; i < instances.size(); i++)
+	{
+		if (!loaded[i])
+			continue;
+		models.push_back(loaded[i].get());
+		modelRooms.push_back(instances[i].room);
+		modelOccluders.push_back(instances[i].occluder && !instances[i].dynamic);
+		if (instances[i].dynamic)
+			dynamicModels.push_back(loaded[i].get());
+	}
+}
+
+// Render thread, after camera.updateMatrix: fills 'visibleModels' with the models in rooms seen through the portals
+void SceneRuntime::Cull(const Camera& camera)
+{
+	visibility.Update(camera);
+	visibleModels.clear();
+	occluderModels.clear();
+	for (size_t i = 0; i < models.size(); i++)
+	{
+		if (!visibility.IsVisible(modelRooms[i]))
+			continue;
+		visibleModels.push_back(models[i]);
+		if (modelOccluders[i])
+			occluderModels.push_back(models[i]);
+	}
+	PortalVisibility::stats.culledModels = (int)(models.size() - visibleModels.size());
+}
+
+const SceneAudioZone* SceneRuntime::AudioZoneAt(glm::vec3 position) const
+{
+	const SceneAudioZone* closest = nullptr;
+	float closestDistance = 0.0f;
+	for (const SceneAudioZone& zone : audioZones)
+	{
+		float distance = glm::length(position - zone.position);
+		if (distance <= zone.radius && (!closest || distance < closestDistance))
+		{
+			closest = &zone;
+			closestDistance = distance;
+		}
+	}
+	return closest;
+}
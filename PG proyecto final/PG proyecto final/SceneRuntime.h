@@ -0,0 +1,91 @@
+#ifndef SCENE_RUNTIME_CLASS_H
+#define SCENE_RUNTIME_CLASS_H
+
+#include<future>
+#include<memory>
+#include<string>
+#include<vector>
+
+#include"Model.h"
+#include"Scene.h"
+#include"LevelStreamer.h"
+#include"PortalVisibility.h"
+
+class Camera;
+
+// What the gallery runs on once a scene is loaded: one model per resident instance, with every file read and its
+// meshes and textures created only once, and the colliders handed to the camera.
+// Instances in rooms stream in and out with LevelStreamer, files are read on the workers and uploaded here
+class SceneRuntime
+{
+public:
+	// Loads what isn't in a room and the rooms in reach of the spawn point before returning
+	SceneRuntime(const Scene& scene, Camera& camera);
+	// Waits for the reads still running
+	~SceneRuntime();
+
+	// Every resident instance in scene order, and the dynamic ones again on their own
+	std::vector<Model*> models;
+	std::vector<Model*> dynamicModels;
+	// Resident occluders (walls and floors) in the rooms Cull found visible
+	std::vector<Model*> occluderModels;
+	// What Cull left of 'models' for the last camera
+	std::vector<Model*> visibleModels;
+
+	// Render thread, once per frame: loads and unloads rooms around the camera. Returns true if 'models' changed
+	bool Update(const Camera& camera);
+	// True while files are being read or uploaded, or rooms wait for them
+	bool Loading() const { return LevelStreamer::stats.loadingAssets > 0 || waitingRooms > 0; }
+	// Render thread, after camera.updateMatrix: fills 'visibleModels' with the models in rooms seen through the portals
+	void Cull(const Camera& camera);
+
+	// Audio zone the position is in (the closest center wins when they overlap), nullptr outside every zone
+	const SceneAudioZone* AudioZoneAt(glm::vec3 position) const;
+
+private:
+	enum AssetState { AssetUnloaded, AssetReading, AssetReady, AssetFailed };
+	struct Asset
+	{
+		// Model keeps the path pointer, so it lives as long as the asset
+		std::unique_ptr<std::string> path;
+		AssetState state = AssetUnloaded;
+		// Rooms (and the instances without a room) that need the file
+		int users = 0;
+		// Uploaded model the instances share, the worker fills 'read' and 'error' first
+		std::unique_ptr<Model> model;
+		std::unique_ptr<Model> read;
+		std::string error;
+		std::future<void> job;
+	};
+	struct Room
+	{
+		// Its assets were asked for, and its instances were created
+		bool requested = false;
+		bool resident = false;
+		std::vector<unsigned int> instances;
+		std::vector<unsigned int> assets;
+	};
+
+	std::vector<SceneInstance> instances;
+	std::vector<SceneAudioZone> audioZones;
+	std::vector<Asset> assets;
+	std::vector<Room> rooms;
+	// Asset of each instance, and its model while resident
+	std::vector<unsigned int> instanceAssets;
+	std::vector<std::unique_ptr<Model>> loaded;
+	// Room of each of 'models', and whether it is a static occluder
+	std::vector<int> modelRooms;
+	std::vector<char> modelOccluders;
+	LevelStreamer streamer;
+	PortalVisibility visibility;
+	glm::vec3 lastPosition;
+	int waitingRooms = 0;
+
+	void acquire(unsigned int asset);
+	void release(unsigned int asset);
+	// Render thread: creates the GL objects of a finished read, or drops it if nobody needs it anymore
+	void finishRead(Asset& asset);
+	void instantiate(unsigned int instance);
+	void rebuildModels();
+};
+#endif
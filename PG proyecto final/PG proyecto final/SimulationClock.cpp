@@ -0,0 +1,59 @@
+#include"SimulationClock.h"
+#include<GLFW/glfw3.h>
+#include<algorithm>
+#include<chrono>
+#include<thread>
+
+SimulationClock::SimulationClock(double stepSeconds, int maxSteps)
+	: step(stepSeconds), maxSteps(maxSteps)
+{
+}
+
+// Starts over from 'now' without simulating the time that passed (e.g. while in the menu)
+void SimulationClock::Reset(double now)
+{
+	lastTime = now;
+	accumulator = 0.0;
+}
+
+// Starts a rendered frame and returns how many fixed steps it has to simulate
+int SimulationClock::BeginFrame(double now)
+{
+	if (lastTime < 0.0)
+		lastTime = now;
+	accumulator += now - lastTime;
+	lastTime = now;
+
+	int steps = (int)(accumulator / step);
+	if (steps > maxSteps)
+	{
+		// Too far behind, the rest of the time is dropped instead of simulated
+		steps = maxSteps;
+		accumulator = 0.0;
+	}
+	else
+		accumulator -= steps * step;
+	return steps;
+}
+
+FrameLimiter::FrameLimiter(double maxFps)
+	: frameSeconds(1.0 / std::max(maxFps, 1.0))
+{
+}
+
+// Waits until the next frame is due
+void FrameLimiter::Wait()
+{
+	double now = glfwGetTime();
+	if (nextFrame < 0.0 || now - nextFrame > frameSeconds)
+		nextFrame = now;
+
+	// Sleeps most of the wait and spins the last millisecond, sleeps are too coarse on some systems
+	while (nextFrame - now > 0.002)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		now = glfwGetTime();
+	}
+	while (glfwGetTime() < nextFrame);
+	nextFrame += frameSeconds;
+}
@@ -0,0 +1,39 @@
+#ifndef SIMULATION_CLOCK_CLASS_H
+#define SIMULATION_CLOCK_CLASS_H
+
+// Splits real time into fixed simulation steps, so movement doesn't depend on the frame rate
+class SimulationClock
+{
+public:
+	// 'maxSteps' caps the steps of one frame, so a long stall doesn't have to be caught up all at once
+	SimulationClock(double stepSeconds = 1.0 / 60.0, int maxSteps = 8);
+
+	// Starts over from 'now' without simulating the time that passed (e.g. while in the menu)
+	void Reset(double now);
+	// Starts a rendered frame and returns how many fixed steps it has to simulate
+	int BeginFrame(double now);
+	// How far the frame is between the last simulated step and the next one, for interpolation
+	float Alpha() const { return (float)(accumulator / step); }
+	double Step() const { return step; }
+
+private:
+	double step;
+	int maxSteps;
+	double lastTime = -1.0;
+	double accumulator = 0.0;
+};
+
+// Sleeps at the end of a frame so frames aren't rendered faster than 'maxFps'
+class FrameLimiter
+{
+public:
+	FrameLimiter(double maxFps);
+
+	// Waits until the next frame is due
+	void Wait();
+
+private:
+	double frameSeconds;
+	double nextFrame = -1.0;
+};
+#endif
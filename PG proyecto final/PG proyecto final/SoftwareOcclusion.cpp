@@ -0,0 +1,381 @@
+#include"SoftwareOcclusion.h"
+#include"Camera.h"
+#include"Model.h"
+#include"Profiler.h"
+#include<algorithm>
+#include<chrono>
+#include<cmath>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include<emmintrin.h>
+#define OCCLUSION_USE_SSE2
+#endif
+
+bool SoftwareOcclusion::enabled = false;
+int SoftwareOcclusion::triangleBudget = 20000;
+SoftwareOcclusionCounters SoftwareOcclusion::stats;
+
+static const int tilesX = SoftwareOcclusion::width / SoftwareOcclusion::tileSize;
+static const int tilesY = SoftwareOcclusion::height / SoftwareOcclusion::tileSize;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+SoftwareOcclusion::SoftwareOcclusion()
+	: depth(width * height, 0.0f), tileDepth(tilesX * tilesY, 0.0f)
+{
+	worker = std::thread([this]()
+	{
+		Profiler::SetThreadName("occlusion");
+		workerLoop();
+	});
+}
+
+SoftwareOcclusion::~SoftwareOcclusion()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	worker.join();
+}
+
+void SoftwareOcclusion::workerLoop()
+{
+	std::unique_lock<std::mutex> lock(mutex);
+	while (true)
+	{
+		condition.wait(lock, [this]() { return jobReady || stopping; });
+		if (stopping)
+			return;
+		jobReady = false;
+		lock.unlock();
+		run();
+		lock.lock();
+		jobDone = true;
+		condition.notify_all();
+	}
+}
+
+// Render thread, once the models to draw are known: hands the camera, occluders and models to the worker
+void SoftwareOcclusion::Submit(const Camera& camera, const std::vector<Model*>& occluders, const std::vector<Model*>& drawn)
+{
+	visible.clear();
+	if (!enabled)
+	{
+		visible.insert(visible.end(), drawn.begin(), drawn.end());
+		return;
+	}
+	PROFILE_SCOPE("CPU occlusion submit");
+
+	// Nearest occluders first, they hide the most and go in before the budget runs out
+	occluderList.clear();
+	for (Model* occluder : occluders)
+	{
+		glm::vec3 boxMin, boxMax;
+		occluder->GetBounds(boxMin, boxMax);
+		float distance = glm::length(glm::clamp(camera.Position, boxMin, boxMax) - camera.Position);
+		occluderList.push_back({ occluder, distance, &occluderOf(*occluder) });
+	}
+	std::sort(occluderList.begin(), occluderList.end(),
+		[](const Candidate& a, const Candidate& b) { return a.distance < b.distance; });
+	cameraMatrix = camera.cameraMatrix;
+	models.assign(drawn.begin(), drawn.end());
+	if (visible.capacity() < models.size())
+		visible.reserve(models.size() * 2);
+
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobReady = true;
+		jobDone = false;
+	}
+	condition.notify_all();
+	submitted = true;
+}
+
+// Render thread: waits for the worker and returns the submitted models that aren't hidden
+const std::vector<Model*>& SoftwareOcclusion::Collect()
+{
+	if (!submitted)
+		return visible;
+	PROFILE_SCOPE("CPU occlusion wait");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return jobDone; });
+	}
+	submitted = false;
+	stats.waitMs = stats.waitMs * 0.9f + (float)millisecondsSince(start) * 0.1f;
+	return visible;
+}
+
+// Forgets the occluder geometry, models may have been unloaded since it was read
+void SoftwareOcclusion::Reset()
+{
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		condition.wait(lock, [this]() { return jobDone; });
+	}
+	occluderCache.clear();
+}
+
+// Reads an occluder model the first time it is seen
+const SoftwareOcclusion::Occluder& SoftwareOcclusion::occluderOf(const Model& model)
+{
+	auto found = occluderCache.find(&model);
+	if (found != occluderCache.end())
+		return found->second;
+
+	Occluder& occluder = occluderCache[&model];
+	for (unsigned int i = 0; i < model.GetMeshes().size(); i++)
+	{
+		model.GetMeshPositions(i, meshPositions);
+		GLuint base = (GLuint)occluder.positions.size();
+		occluder.positions.insert(occluder.positions.end(), meshPositions.begin(), meshPositions.end());
+		for (GLuint index : model.GetMeshes()[i].indices)
+			occluder.indices.push_back(base + index);
+	}
+	return occluder;
+}
+
+// Worker: the depth buffer from the occluders, then the test of every model
+void SoftwareOcclusion::run()
+{
+	PROFILE_SCOPE("CPU occlusion");
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	std::fill(depth.begin(), depth.end(), 0.0f);
+	stats.occluders = 0;
+	stats.occluderTriangles = 0;
+	stats.rasterizedTriangles = 0;
+
+	for (const Candidate& candidate : occluderList)
+	{
+		if (stats.occluderTriangles >= triangleBudget)
+			break;
+		const Occluder& occluder = *candidate.occluder;
+		if (clipPositions.size() < occluder.positions.size())
+			clipPositions.resize(occluder.positions.size());
+		for (size_t i = 0; i < occluder.positions.size(); i++)
+			clipPositions[i] = cameraMatrix * glm::vec4(occluder.positions[i], 1.0f);
+		for (size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+			rasterizeTriangle(clipPositions[occluder.indices[i]], clipPositions[occluder.indices[i + 1]], clipPositions[occluder.indices[i + 2]]);
+		stats.occluders++;
+		stats.occluderTriangles += (int)(occluder.indices.size() / 3);
+	}
+	buildTiles();
+	stats.rasterMs = stats.rasterMs * 0.9f + (float)millisecondsSince(start) * 0.1f;
+
+	start = std::chrono::steady_clock::now();
+	for (Model* model : models)
+	{
+		if (!isOccluded(*model))
+			visible.push_back(model);
+	}
+	stats.tested = (int)models.size();
+	stats.culled = (int)(models.size() - visible.size());
+	stats.testMs = stats.testMs * 0.9f + (float)millisecondsSince(start) * 0.1f;
+}
+
+// Clips a triangle against the near plane and draws what is left
+void SoftwareOcclusion::rasterizeTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c)
+{
+	// Entirely outside one side of the view
+	for (int axis = 0; axis < 2; axis++)
+	{
+		if ((a[axis] > a.w && b[axis] > b.w && c[axis] > c.w) || (a[axis] < -a.w && b[axis] < -b.w && c[axis] < -c.w))
+			return;
+	}
+
+	// Near plane: z + w >= 0
+	glm::vec4 corners[3] = { a, b, c };
+	glm::vec4 clipped[4];
+	int count = 0;
+	for (int i = 0; i < 3; i++)
+	{
+		const glm::vec4& current = corners[i];
+		const glm::vec4& next = corners[(i + 1) % 3];
+		float dc = current.z + current.w;
+		float dn = next.z + next.w;
+		if (dc >= 0.0f)
+			clipped[count++] = current;
+		if ((dc >= 0.0f) != (dn >= 0.0f))
+			clipped[count++] = current + (next - current) * (dc / (dc - dn));
+	}
+	if (count < 3)
+		return;
+
+	// Pixels, with z holding 1 / w, which is linear across the screen
+	glm::vec3 screen[4];
+	for (int i = 0; i < count; i++)
+	{
+		float inverseW = 1.0f / clipped[i].w;
+		screen[i] = glm::vec3((clipped[i].x * inverseW * 0.5f + 0.5f) * width, (clipped[i].y * inverseW * 0.5f + 0.5f) * height, inverseW);
+	}
+	rasterizeScreenTriangle(screen);
+	if (count == 4)
+	{
+		glm::vec3 second[3] = { screen[0], screen[2], screen[3] };
+		rasterizeScreenTriangle(second);
+	}
+}
+
+// Keeps the nearest depth of every pixel whose center is inside the triangle. Back faces are skipped like
+// GL_CULL_FACE does in the gallery, a wall seen from behind hides nothing
+void SoftwareOcclusion::rasterizeScreenTriangle(const glm::vec3* screen)
+{
+	const glm::vec3& a = screen[0];
+	const glm::vec3& b = screen[1];
+	const glm::vec3& c = screen[2];
+	float area = (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+	if (area <= 0.0f)
+		return;
+
+	int minX = std::max(0, (int)std::ceil(std::min(a.x, std::min(b.x, c.x)) - 0.5f));
+	int maxX = std::min(width - 1, (int)std::floor(std::max(a.x, std::max(b.x, c.x)) - 0.5f));
+	int minY = std::max(0, (int)std::ceil(std::min(a.y, std::min(b.y, c.y)) - 0.5f));
+	int maxY = std::min(height - 1, (int)std::floor(std::max(a.y, std::max(b.y, c.y)) - 0.5f));
+	if (minX > maxX || minY > maxY)
+		return;
+	stats.rasterizedTriangles++;
+
+	// Edge functions as dx * x + dy * y + offset, positive inside. Each is the weight of the opposite corner times the area
+	glm::vec3 edgeX(b.y - c.y, c.y - a.y, a.y - b.y);
+	glm::vec3 edgeY(c.x - b.x, a.x - c.x, b.x - a.x);
+	glm::vec3 edgeOffset(b.x * c.y - b.y * c.x, c.x * a.y - c.y * a.x, a.x * b.y - a.y * b.x);
+	glm::vec3 depths(a.z, b.z, c.z);
+	float depthX = glm::dot(edgeX, depths) / area;
+	float depthY = glm::dot(edgeY, depths) / area;
+	float depthOffset = glm::dot(edgeOffset, depths) / area;
+
+#ifdef OCCLUSION_USE_SSE2
+	// Four pixels of a row at a time, starting 4 aligned (width is a multiple of 4, so the last group fits)
+	const __m128 lanes = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+	int startX = minX & ~3;
+	__m128 e0x = _mm_set1_ps(edgeX[0]), e1x = _mm_set1_ps(edgeX[1]), e2x = _mm_set1_ps(edgeX[2]), zx = _mm_set1_ps(depthX);
+	__m128 e0Step = _mm_set1_ps(edgeX[0] * 4.0f), e1Step = _mm_set1_ps(edgeX[1] * 4.0f), e2Step = _mm_set1_ps(edgeX[2] * 4.0f);
+	__m128 zStep = _mm_set1_ps(depthX * 4.0f);
+	for (int y = minY; y <= maxY; y++)
+	{
+		float py = y + 0.5f;
+		__m128 px = _mm_add_ps(_mm_set1_ps((float)startX), lanes);
+		__m128 e0 = _mm_add_ps(_mm_mul_ps(e0x, px), _mm_set1_ps(edgeY[0] * py + edgeOffset[0]));
+		__m128 e1 = _mm_add_ps(_mm_mul_ps(e1x, px), _mm_set1_ps(edgeY[1] * py + edgeOffset[1]));
+		__m128 e2 = _mm_add_ps(_mm_mul_ps(e2x, px), _mm_set1_ps(edgeY[2] * py + edgeOffset[2]));
+		__m128 z = _mm_add_ps(_mm_mul_ps(zx, px), _mm_set1_ps(depthY * py + depthOffset));
+		float* row = &depth[y * width];
+		for (int x = startX; x <= maxX; x += 4)
+		{
+			__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+			if (_mm_movemask_ps(inside))
+			{
+				// Pixels outside add 0, which never wins the max
+				__m128 old = _mm_loadu_ps(row + x);
+				_mm_storeu_ps(row + x, _mm_max_ps(old, _mm_and_ps(inside, z)));
+			}
+			e0 = _mm_add_ps(e0, e0Step);
+			e1 = _mm_add_ps(e1, e1Step);
+			e2 = _mm_add_ps(e2, e2Step);
+			z = _mm_add_ps(z, zStep);
+		}
+	}
+#else
+	for (int y = minY; y <= maxY; y++)
+	{
+		float py = y + 0.5f;
+		float* row = &depth[y * width];
+		for (int x = minX; x <= maxX; x++)
+		{
+			float px = x + 0.5f;
+			if (edgeX[0] * px + edgeY[0] * py + edgeOffset[0] >= 0.0f && edgeX[1] * px + edgeY[1] * py + edgeOffset[1] >= 0.0f
+				&& edgeX[2] * px + edgeY[2] * py + edgeOffset[2] >= 0.0f)
+				row[x] = std::max(row[x], depthX * px + depthY * py + depthOffset);
+		}
+	}
+#endif
+}
+
+// Farthest depth of each tile, a box nearer than that over a whole tile needs no look at its pixels
+void SoftwareOcclusion::buildTiles()
+{
+	for (int ty = 0; ty < tilesY; ty++)
+	{
+		for (int tx = 0; tx < tilesX; tx++)
+		{
+			const float* tile = &depth[ty * tileSize * width + tx * tileSize];
+#ifdef OCCLUSION_USE_SSE2
+			__m128 farthest = _mm_loadu_ps(tile);
+			for (int y = 0; y < tileSize; y++)
+			{
+				for (int x = 0; x < tileSize; x += 4)
+					farthest = _mm_min_ps(farthest, _mm_loadu_ps(tile + y * width + x));
+			}
+			farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(1, 0, 3, 2)));
+			farthest = _mm_min_ps(farthest, _mm_shuffle_ps(farthest, farthest, _MM_SHUFFLE(2, 3, 0, 1)));
+			tileDepth[ty * tilesX + tx] = _mm_cvtss_f32(farthest);
+#else
+			float farthest = tile[0];
+			for (int y = 0; y < tileSize; y++)
+			{
+				for (int x = 0; x < tileSize; x++)
+					farthest = std::min(farthest, tile[y * width + x]);
+			}
+			tileDepth[ty * tilesX + tx] = farthest;
+#endif
+		}
+	}
+}
+
+// True when the nearest point of the model's box is behind the occluders on every pixel the box covers
+bool SoftwareOcclusion::isOccluded(const Model& model) const
+{
+	glm::vec3 boxMin, boxMax;
+	model.GetBounds(boxMin, boxMax);
+	glm::vec2 screenMin(width, height);
+	glm::vec2 screenMax(0.0f);
+	float nearest = 0.0f;
+	for (int corner = 0; corner < 8; corner++)
+	{
+		glm::vec3 position((corner & 1) ? boxMax.x : boxMin.x, (corner & 2) ? boxMax.y : boxMin.y, (corner & 4) ? boxMax.z : boxMin.z);
+		glm::vec4 clip = cameraMatrix * glm::vec4(position, 1.0f);
+		// Crossing the near plane, the box surrounds the camera or is too close to tell
+		if (clip.z < -clip.w || clip.w <= 0.0f)
+			return false;
+		float inverseW = 1.0f / clip.w;
+		glm::vec2 pixel((clip.x * inverseW * 0.5f + 0.5f) * width, (clip.y * inverseW * 0.5f + 0.5f) * height);
+		screenMin = glm::min(screenMin, pixel);
+		screenMax = glm::max(screenMax, pixel);
+		nearest = std::max(nearest, inverseW);
+	}
+	// Off screen, the view frustum test is left to the GPU
+	if (screenMax.x < 0.0f || screenMax.y < 0.0f || screenMin.x >= width || screenMin.y >= height)
+		return false;
+
+	int minX = std::max(0, (int)std::floor(screenMin.x));
+	int maxX = std::min(width - 1, (int)std::floor(screenMax.x));
+	int minY = std::max(0, (int)std::floor(screenMin.y));
+	int maxY = std::min(height - 1, (int)std::floor(screenMax.y));
+	for (int ty = minY / tileSize; ty <= maxY / tileSize; ty++)
+	{
+		for (int tx = minX / tileSize; tx <= maxX / tileSize; tx++)
+		{
+			if (tileDepth[ty * tilesX + tx] > nearest)
+				continue;
+			// Some pixel of the tile may be behind the box, only the ones the box covers count
+			int y1 = std::min(maxY, ty * tileSize + tileSize - 1);
+			int x1 = std::min(maxX, tx * tileSize + tileSize - 1);
+			for (int y = std::max(minY, ty * tileSize); y <= y1; y++)
+			{
+				for (int x = std::max(minX, tx * tileSize); x <= x1; x++)
+				{
+					if (depth[y * width + x] <= nearest)
+						return false;
+				}
+			}
+		}
+	}
+	return true;
+}
@@ -0,0 +1,101 @@
+#ifndef SOFTWARE_OCCLUSION_CLASS_H
+#define SOFTWARE_OCCLUSION_CLASS_H
+
+#include<glad/glad.h>
+#include<glm/glm.hpp>
+#include<condition_variable>
+#include<mutex>
+#include<thread>
+#include<unordered_map>
+#include<vector>
+
+class Camera;
+class Model;
+
+// What the CPU occlusion culling did last frame, shown by the stats overlay
+struct SoftwareOcclusionCounters
+{
+	int occluders = 0;
+	// Occluder triangles sent, and drawn into the depth buffer after clipping and back face culling
+	int occluderTriangles = 0;
+	int rasterizedTriangles = 0;
+	int tested = 0;
+	int culled = 0;
+	// Smoothed times of the worker, and of the render thread waiting for it
+	float rasterMs = 0.0f;
+	float testMs = 0.0f;
+	float waitMs = 0.0f;
+};
+
+// Occlusion culling on the CPU, for drivers where occlusion queries cost as much as drawing. The walls and floors
+// of the scene (instances marked occluder) are rasterized at low resolution into a depth buffer with a tile hierarchy
+// of the farthest depth in each tile, and the box of every model is tested against it: a model is hidden when its
+// nearest point is behind the occluders over every pixel it covers. It all runs on its own thread, started as soon
+// as the frame knows what to draw and collected right before the models are drawn
+class SoftwareOcclusion
+{
+public:
+	SoftwareOcclusion();
+	~SoftwareOcclusion();
+
+	// Render thread, once the models to draw are known: hands the camera, occluders and models to the worker
+	void Submit(const Camera& camera, const std::vector<Model*>& occluders, const std::vector<Model*>& drawn);
+	// Render thread: waits for the worker and returns the submitted models that aren't hidden
+	const std::vector<Model*>& Collect();
+	// Forgets the occluder geometry, models may have been unloaded since it was read
+	void Reset();
+
+	// Off: Collect returns every submitted model
+	static bool enabled;
+	// Occluder triangles rasterized per frame at most, the nearest occluders go first
+	static int triangleBudget;
+	// Size of the depth buffer, width a multiple of 4 and both of the tile size
+	static const int width = 256;
+	static const int height = 128;
+	static const int tileSize = 8;
+	static SoftwareOcclusionCounters stats;
+
+private:
+	// Triangles of an occluder model in world space
+	struct Occluder
+	{
+		std::vector<glm::vec3> positions;
+		std::vector<GLuint> indices;
+	};
+	struct Candidate
+	{
+		Model* model;
+		float distance;
+		const Occluder* occluder;
+	};
+
+	std::thread worker;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool jobReady = false;
+	bool jobDone = true;
+	bool stopping = false;
+	bool submitted = false;
+
+	// Job handed to the worker, sized once and reused
+	glm::mat4 cameraMatrix;
+	std::vector<Candidate> occluderList;
+	std::vector<Model*> models;
+	std::vector<Model*> visible;
+	std::unordered_map<const Model*, Occluder> occluderCache;
+	std::vector<glm::vec4> clipPositions;
+	std::vector<glm::vec3> meshPositions;
+	// Inverse of w per pixel (bigger is nearer, 0 is nothing drawn) and the smallest of each tile
+	std::vector<float> depth;
+	std::vector<float> tileDepth;
+
+	void workerLoop();
+	void run();
+	void rasterizeTriangle(glm::vec4 a, glm::vec4 b, glm::vec4 c);
+	void rasterizeScreenTriangle(const glm::vec3* screen);
+	void buildTiles();
+	bool isOccluded(const Model& model) const;
+	// Reads an occluder model the first time it is seen
+	const Occluder& occluderOf(const Model& model);
+};
+#endif
@@ -1,4 +1,7 @@
 #include "TextRenderer.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "MemoryTracker.h"
 #include <ft2build.h>
 #include FT_FREETYPE_H
 
@@ -20,7 +23,8 @@ TextRenderer::TextRenderer(const std::string& fontPath, int fontSize) {
     // Disable byte-alignment restriction (since we're using 1-byte grayscale)
     glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
 
-    // Load first 128 ASCII characters
+    // Load first 128 ASCII characters (one texture each, counted against the font in the memory tracker)
+    size_t glyphBytes = 0;
     for (unsigned char c = 0; c < 128; c++) {
         // Load character glyph with rendering
         if (FT_Load_Char(face, c, FT_LOAD_RENDER)) {
@@ -43,6 +47,7 @@ TextRenderer::TextRenderer(const std::string& fontPath, int fontSize) {
             GL_UNSIGNED_BYTE,
             face->glyph->bitmap.buffer
         );
+        glyphBytes += (size_t)face->glyph->bitmap.width * face->glyph->bitmap.rows;
 
         // Set texture parameters
         glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
@@ -71,6 +76,8 @@ TextRenderer::TextRenderer(const std::string& fontPath, int fontSize) {
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     // Allocate memory for 6 vertices (2 triangles) with 4 floats each (x,y,s,t)
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
+    MemoryTracker::Add(fontPath, MemoryTextures, glyphBytes);
+    MemoryTracker::Add(fontPath, MemoryBuffers, sizeof(float) * 6 * 4);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
@@ -90,6 +97,12 @@ float TextRenderer::CalculateTextWidth(const std::string& text, float scale) {
 
 // Renders text string at specified position with given color and scale
 void TextRenderer::RenderText(Shader& shader, const std::string& text, float x, float y, float scale, glm::vec3 color) {
+    RenderText(shader, text.c_str(), x, y, scale, color);
+}
+
+// Same, for text that isn't in a std::string (e.g. formatted in frame memory)
+void TextRenderer::RenderText(Shader& shader, const char* text, float x, float y, float scale, glm::vec3 color) {
+    PROFILE_SCOPE("TextRenderer::RenderText");
     // Activate shader and set text color
     shader.Activate();
     glUniform3f(glGetUniformLocation(shader.ID, "textColor"), color.x, color.y, color.z);
@@ -97,9 +110,12 @@ void TextRenderer::RenderText(Shader& shader, const std::string& text, float x,
     glBindVertexArray(VAO);
 
     // Render each character in the string
-    std::string::const_iterator c;
-    for (c = text.begin(); c != text.end(); c++) {
-        Character ch = Characters[*c];
+    for (const char* c = text; *c; c++) {
+        // find instead of [], an unknown character must not insert (and allocate) a map node every frame
+        auto found = Characters.find(*c);
+        if (found == Characters.end())
+            continue;
+        const Character& ch = found->second;
 
         // Calculate position and size of character quad
         float xpos = x + ch.Bearing.x * scale;
@@ -125,6 +141,9 @@ void TextRenderer::RenderText(Shader& shader, const std::string& text, float x,
         glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
         glBindBuffer(GL_ARRAY_BUFFER, 0);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        RenderStats::frame.drawCalls++;
+        RenderStats::frame.triangles += 2;
+        RenderStats::frame.textureBinds++;
 
         // Advance cursor position for next character
         // Bitshift by 6 to get value in pixels (2^6 = 64)
@@ -22,6 +22,8 @@ public:
         return Characters.at(c);
     }
     void RenderText(Shader& shader, const std::string& text, float x, float y, float scale, glm::vec3 color);
+    // Same, for text that isn't in a std::string (e.g. formatted in frame memory)
+    void RenderText(Shader& shader, const char* text, float x, float y, float scale, glm::vec3 color);
 
 private:
     std::map<char, Character> Characters;
@@ -1,16 +1,194 @@
 #include"Texture.h"
+#include"MipGenerator.h"
+#include"TextureStreamer.h"
+#include"TextureResidency.h"
+#include"Profiler.h"
+#include"RenderStats.h"
+#include"LoadReport.h"
+#include"MemoryTracker.h"
+#include<algorithm>
+#include<map>
+#include<mutex>
 
-Texture::Texture(const char* image, const char* texType, GLuint slot)
+size_t Texture::totalBytes = 0;
+size_t Texture::totalSavedBytes = 0;
+int Texture::qualityLevel = 0;
+int Texture::maxDimension = 0;
+size_t Texture::memoryBudget = 0;
+
+// Images that live in memory instead of a file, by the name textures use for them
+struct EmbeddedImage
+{
+	std::shared_ptr<const std::vector<unsigned char>> bytes;
+	size_t offset;
+	size_t size;
+	// Models that registered it, every copy of a file registers the same names
+	int users;
+};
+static std::mutex embeddedMutex;
+static std::map<std::string, EmbeddedImage> embeddedImages;
+
+static bool findEmbedded(const std::string& name, EmbeddedImage& image)
+{
+	std::lock_guard<std::mutex> lock(embeddedMutex);
+	auto found = embeddedImages.find(name);
+	if (found == embeddedImages.end())
+		return false;
+	image = found->second;
+	return true;
+}
+
+bool Texture::RegisterEmbeddedImage(const std::string& name, std::shared_ptr<const std::vector<unsigned char>> bytes, size_t offset, size_t size)
+{
+	std::lock_guard<std::mutex> lock(embeddedMutex);
+	auto found = embeddedImages.find(name);
+	if (found != embeddedImages.end())
+	{
+		found->second.users++;
+		return false;
+	}
+	embeddedImages[name] = EmbeddedImage{ bytes, offset, size, 1 };
+	return true;
+}
+
+size_t Texture::UnregisterEmbeddedImage(const std::string& name)
+{
+	std::lock_guard<std::mutex> lock(embeddedMutex);
+	auto found = embeddedImages.find(name);
+	if (found == embeddedImages.end() || --found->second.users > 0)
+		return 0;
+	size_t freed = found->second.bytes.use_count() == 1 ? found->second.bytes->capacity() : 0;
+	embeddedImages.erase(found);
+	return freed;
+}
+
+// stbi_info and stbi_load that also find embedded images
+static bool imageInfo(const std::string& image, int* width, int* height, int* channels)
+{
+	EmbeddedImage embedded;
+	if (findEmbedded(image, embedded))
+		return stbi_info_from_memory(embedded.bytes->data() + embedded.offset, (int)embedded.size, width, height, channels) != 0;
+	return stbi_info(image.c_str(), width, height, channels) != 0;
+}
+
+static unsigned char* loadImage(const std::string& image, int* width, int* height, int* channels)
+{
+	EmbeddedImage embedded;
+	if (findEmbedded(image, embedded))
+		return stbi_load_from_memory(embedded.bytes->data() + embedded.offset, (int)embedded.size, width, height, channels, 0);
+	return stbi_load(image.c_str(), width, height, channels, 0);
+}
+
+static TextureLayout planLayout(int widthImg, int heightImg, int numColCh, const std::string& texType, int maxSize)
+{
+	TextureLayout layout;
+	layout.sourceChannels = numColCh;
+
+	// Pick the GPU format from what the texture is used for instead of always using RGBA
+	if (numColCh < 1 || numColCh > 4)
+		throw std::invalid_argument("Automatic Texture type recognition failed");
+	if (texType == "diffuse")
+	{
+		// Base color is authored in sRGB, so let the GPU linearize it when sampling.
+		// Grey (+ alpha) base colors are expanded to RGB(A) so they still sample as grey
+		layout.channels = (numColCh == 2 || numColCh == 4) ? 4 : 3;
+		layout.internalFormat = layout.channels == 4 ? GL_SRGB8_ALPHA8 : GL_SRGB8;
+		layout.format = layout.channels == 4 ? GL_RGBA : GL_RGB;
+	}
+	else
+	{
+		// default.frag only samples the red channel of the specular (metallicRoughness) map,
+		// so keep just that channel and drop the rest
+		layout.channels = 1;
+		layout.internalFormat = GL_R8;
+		layout.format = GL_RED;
+	}
+
+	// Drops the top levels the quality tier and the size limits don't want, so they never reach the GPU
+	int fullLevels = 1;
+	while ((widthImg >> fullLevels) > 0 || (heightImg >> fullLevels) > 0)
+		fullLevels++;
+	int limit = Texture::maxDimension;
+	if (maxSize > 0 && (limit == 0 || maxSize < limit))
+		limit = maxSize;
+	auto largestSide = [&](int level)
+	{
+		return std::max(std::max(1, widthImg >> level), std::max(1, heightImg >> level));
+	};
+	layout.skip = std::min(std::max(Texture::qualityLevel, 0), fullLevels - 1);
+	while (limit > 0 && layout.skip < fullLevels - 1 && largestSide(layout.skip) > limit)
+		layout.skip++;
+
+	layout.width = std::max(1, widthImg >> layout.skip);
+	layout.height = std::max(1, heightImg >> layout.skip);
+	layout.levels = fullLevels - layout.skip;
+	return layout;
+}
+
+// Reads the image, repacks its channels and builds the mip chain. Element 0 of the result is the base level of the layout
+std::vector<MipLevel> Texture::DecodeLevels(const std::string& image, const TextureLayout& layout, const std::string& asset)
+{
+	PROFILE_SCOPE("Texture decode");
+	LoadTimer decodeTimer(asset, StageTextureDecode, image);
+	// Flips the image so it appears right side up (per thread, the loaders decode in parallel)
+	stbi_set_flip_vertically_on_load_thread(true);
+	int widthImg, heightImg, numColCh;
+	unsigned char* bytes = loadImage(image, &widthImg, &heightImg, &numColCh);
+	if (!bytes)
+	{
+		std::cerr << "ERROR: Failed to load texture " << image << std::endl;
+		return std::vector<MipLevel>();
+	}
+
+	// Repacks the source channels into the layout picked for the GPU
+	MipLevel base;
+	base.width = widthImg;
+	base.height = heightImg;
+	base.pixels.resize((size_t)widthImg * heightImg * layout.channels);
+	for (size_t i = 0; i < (size_t)widthImg * heightImg; i++)
+	{
+		const unsigned char* in = bytes + i * numColCh;
+		unsigned char* out = base.pixels.data() + i * layout.channels;
+		if (layout.channels == 1 || numColCh >= 3)
+		{
+			for (int c = 0; c < layout.channels; c++)
+				out[c] = in[c];
+		}
+		else
+		{
+			// Grey (+ alpha) to RGB(A)
+			out[0] = out[1] = out[2] = in[0];
+			if (layout.channels == 4)
+				out[3] = numColCh == 2 ? in[1] : 255;
+		}
+	}
+	stbi_image_free(bytes);
+	decodeTimer.bytes = base.pixels.size();
+
+	// Generates the MipMaps on the worker threads
+	LoadTimer mipTimer(asset, StageMipGeneration, image);
+	std::vector<MipLevel> mips = GenerateMipChain(base.pixels.data(), base.width, base.height, layout.channels, layout.channels != 1);
+	for (const MipLevel& mip : mips)
+		mipTimer.bytes += mip.pixels.size();
+	mips.insert(mips.begin(), std::move(base));
+
+	// Throws away the levels above the quality tier
+	mips.erase(mips.begin(), mips.begin() + std::min((size_t)layout.skip, mips.size() - 1));
+	return mips;
+}
+
+Texture::Texture(const char* image, const char* texType, GLuint slot, int maxSize)
 {
+	PROFILE_SCOPE("Texture create");
 	// Assigns the type of the texture ot the texture object
 	type = texType;
 
 	// Stores the width, height, and the number of color channels of the image
 	int widthImg, heightImg, numColCh;
-	// Flips the image so it appears right side up
-	stbi_set_flip_vertically_on_load(true);
-	// Reads the image from a file and stores it in bytes
-	unsigned char* bytes = stbi_load(image, &widthImg, &heightImg, &numColCh, 0);
+	// Only reads the header here, the pixels are decoded later (on a worker thread when streaming)
+	if (!imageInfo(image, &widthImg, &heightImg, &numColCh))
+		throw std::invalid_argument(std::string("Failed to load texture: ") + image);
+	TextureLayout layout = planLayout(widthImg, heightImg, numColCh, texType, maxSize);
 
 	// Generates an OpenGL texture object
 	glGenTextures(1, &ID);
@@ -31,57 +209,82 @@ Texture::Texture(const char* image, const char* texType, GLuint slot)
 	// float flatColor[] = {1.0f, 1.0f, 1.0f, 1.0f};
 	// glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, flatColor);
 
-	// Check what type of color channels the texture has and load it accordingly
-	if (numColCh == 4)
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_RGBA,
-			widthImg,
-			heightImg,
-			0,
-			GL_RGBA,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
-	else if (numColCh == 3)
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_RGBA,
-			widthImg,
-			heightImg,
-			0,
-			GL_RGB,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
-	else if (numColCh == 1)
-		glTexImage2D
-		(
-			GL_TEXTURE_2D,
-			0,
-			GL_RGBA,
-			widthImg,
-			heightImg,
-			0,
-			GL_RED,
-			GL_UNSIGNED_BYTE,
-			bytes
-		);
-	else
-		throw std::invalid_argument("Automatic Texture type recognition failed");
+	internalFormat = layout.internalFormat;
+	// Asset the texture belongs to in the load report and the memory tracker
+	std::string asset = LoadReport::current;
+	TextureStreamer* streamer = TextureStreamer::active;
+	if (streamer)
+	{
+		// With residency management the finest levels wait until a mesh using the texture is seen up close
+		GLint firstLevel = TextureResidency::active ? TextureResidency::active->Register(ID, image, layout, asset) : 0;
 
-	// Generates MipMaps
-	glGenerateMipmap(GL_TEXTURE_2D);
+		// Allocates the levels now and only shows the coarsest one, finer levels replace it as they arrive
+		{
+			LoadTimer timer(asset, StageGpuUpload, image);
+			for (int level = firstLevel; level < layout.levels; level++)
+			{
+				glTexImage2D(GL_TEXTURE_2D, level, layout.internalFormat,
+					std::max(1, layout.width >> level), std::max(1, layout.height >> level), 0,
+					layout.format, GL_UNSIGNED_BYTE, NULL);
+			}
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, layout.levels - 1);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, layout.levels - 1);
+			// The upload context can only see the storage once this context has flushed
+			glFlush();
+		}
 
-	// Deletes the image data as it is already in the OpenGL Texture object
-	stbi_image_free(bytes);
+		// Decodes on a worker and streams the levels from the coarsest to the finest
+		GLuint texture = ID;
+		std::string path = image;
+		TextureResidency* residency = TextureResidency::active;
+		LoadReport::inFlight++;
+		streamer->Begin(texture);
+		ThreadPool::Shared().Submit([streamer, residency, texture, path, layout, firstLevel, asset]()
+		{
+			std::vector<MipLevel> mips = DecodeLevels(path, layout, asset);
+			if ((int)mips.size() <= firstLevel && residency)
+				residency->DecodeFailed(texture);
+			for (int level = (int)mips.size() - 1; level >= firstLevel; level--)
+			{
+				streamer->Upload(texture, GL_TEXTURE_2D, level, mips[level].width, mips[level].height,
+					layout.format, std::move(mips[level].pixels), asset, path);
+			}
+			streamer->End(texture);
+			LoadReport::inFlight--;
+		});
+	}
+	else
+	{
+		// Decodes and uploads every level right away
+		std::vector<MipLevel> mips = DecodeLevels(image, layout, asset);
+		if (!mips.empty())
+		{
+			LoadTimer timer(asset, StageGpuUpload, image);
+			for (const MipLevel& mip : mips)
+				timer.bytes += mip.pixels.size();
+			std::vector<MipLevel> lower(std::make_move_iterator(mips.begin() + 1), std::make_move_iterator(mips.end()));
+			UploadMipChain(mips[0].pixels.data(), mips[0].width, mips[0].height, lower, layout.internalFormat, layout.format);
+		}
+	}
 
 	// Unbinds the OpenGL Texture object so that it can't accidentally be modified
 	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Keeps track of the memory used compared to storing everything as RGBA8 (a full mip chain is ~4/3 of the base level)
+	width = layout.width;
+	height = layout.height;
+	bytes = (size_t)width * height * BytesPerTexel(internalFormat) * 4 / 3;
+	size_t rgbaBytes = (size_t)widthImg * heightImg * 4 * 4 / 3;
+	totalBytes += bytes;
+	totalSavedBytes += rgbaBytes - bytes;
+	// Residency counts the levels it keeps allocated itself
+	if (!TextureResidency::active || !streamer)
+		MemoryTracker::Add(asset, MemoryTextures, bytes);
+
+	std::cout << "TEXTURE: " << image << " " << width << "x" << height
+		<< (layout.skip > 0 ? " (from " + std::to_string(widthImg) + "x" + std::to_string(heightImg) + ")" : "")
+		<< " " << BytesPerTexel(internalFormat) << " bytes/texel, " << bytes / 1024 << " KB"
+		<< " (saved " << (rgbaBytes - bytes) / 1024 << " KB)" << std::endl;
 }
 
 void Texture::texUnit(Shader& shader, const char* uniform, GLuint unit)
@@ -98,6 +301,7 @@ void Texture::Bind()
 {
 	glActiveTexture(GL_TEXTURE0 + unit);
 	glBindTexture(GL_TEXTURE_2D, ID);
+	RenderStats::frame.textureBinds++;
 }
 
 void Texture::Unbind()
@@ -108,4 +312,29 @@ void Texture::Unbind()
 void Texture::Delete()
 {
 	glDeleteTextures(1, &ID);
+}
+
+void Texture::PrintMemoryReport()
+{
+	std::cout << "TEXTURE MEMORY: " << totalBytes / (1024 * 1024) << " MB used, "
+		<< totalSavedBytes / (1024 * 1024) << " MB saved compared to full resolution RGBA8"
+		<< " (quality level " << qualityLevel << ", max size " << maxDimension << ")" << std::endl;
+	if (memoryBudget > 0)
+	{
+		std::cout << "TEXTURE BUDGET: " << totalBytes / (1024 * 1024) << " / " << memoryBudget / (1024 * 1024) << " MB" << std::endl;
+		if (totalBytes > memoryBudget)
+			std::cerr << "WARNING: Textures exceed the memory budget, lower --texture-quality or --max-texture-size" << std::endl;
+	}
+}
+
+GLuint Texture::BytesPerTexel(GLenum internalFormat)
+{
+	switch (internalFormat)
+	{
+	case GL_R8: return 1;
+	case GL_RG8: return 2;
+	case GL_SRGB8:
+	case GL_RGB8: return 3;
+	default: return 4;
+	}
 }
\ No newline at end of file
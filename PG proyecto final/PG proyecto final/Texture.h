@@ -3,8 +3,24 @@
 
 #include<glad/glad.h>
 #include<stb/stb_image.h>
+#include<memory>
 
 #include"shaderClass.h"
+#include"MipGenerator.h"
+
+// How an image is going to be stored on the GPU, worked out from the file header and the texture usage
+struct TextureLayout
+{
+	int sourceChannels;
+	int channels;
+	GLenum internalFormat;
+	GLenum format;
+	// Top levels dropped by the quality settings, and size/level count of what is left
+	int skip;
+	int width;
+	int height;
+	int levels;
+};
 
 class Texture
 {
@@ -13,7 +29,25 @@ public:
 	const char* type;
 	GLuint unit;
 
-	Texture(const char* image, const char* texType, GLuint slot);
+	// Size and GPU format of the texture, used for the memory report
+	int width;
+	int height;
+	GLenum internalFormat;
+	size_t bytes;
+
+	// Running totals of texture memory (including mipmaps) over all loaded textures
+	static size_t totalBytes;
+	static size_t totalSavedBytes;
+
+	// Global quality tier: number of top mip levels that are dropped at decode time (0 = full resolution)
+	static int qualityLevel;
+	// Global cap on the largest side of any texture in texels (0 = no limit)
+	static int maxDimension;
+	// Texture memory the machine is expected to hold in bytes, only used for the startup report (0 = unknown)
+	static size_t memoryBudget;
+
+	// maxSize caps the largest side of this texture on top of the global settings (0 = no limit)
+	Texture(const char* image, const char* texType, GLuint slot, int maxSize = 0);
 
 	// Assigns a texture unit to a texture
 	void texUnit(Shader& shader, const char* uniform, GLuint unit);
@@ -23,5 +57,20 @@ public:
 	void Unbind();
 	// Deletes a texture
 	void Delete();
+
+	// Prints the total texture memory and how much the compact formats saved
+	static void PrintMemoryReport();
+	// Bytes used by one texel of the given internal format
+	static GLuint BytesPerTexel(GLenum internalFormat);
+	// Image file held in memory (embedded in a .glb or a data URI). Textures created with 'name' as their image
+	// decode it from 'bytes' instead of reading a file, the bytes stay alive as long as anything may decode them again.
+	// Registering a name again only counts one more user and keeps the first bytes, returns false then
+	static bool RegisterEmbeddedImage(const std::string& name, std::shared_ptr<const std::vector<unsigned char>> bytes, size_t offset, size_t size);
+	// One user of an embedded image is done with it, it is forgotten with the last one. Returns the bytes freed, 0 if
+	// it is still registered or someone else still holds them
+	static size_t UnregisterEmbeddedImage(const std::string& name);
+	// Reads the image, repacks its channels and builds the mip chain. Element 0 of the result is the base level of the layout.
+	// The decode and mip times are added to the load report of 'asset' when one is given
+	static std::vector<MipLevel> DecodeLevels(const std::string& image, const TextureLayout& layout, const std::string& asset = std::string());
 };
 #endif
\ No newline at end of file
@@ -0,0 +1,263 @@
+#include"TextureResidency.h"
+#include"Model.h"
+#include"LoadReport.h"
+#include"MemoryTracker.h"
+#include<algorithm>
+#include<cmath>
+#include<thread>
+
+int TextureResidency::initialMaxSize = 256;
+float TextureResidency::lodBias = 0.0f;
+TextureResidency* TextureResidency::active = nullptr;
+
+// Textures streamed in per frame at most, so walking into a new room does not queue everything at once
+static const int maxStreamInsPerFrame = 2;
+
+TextureResidency::TextureResidency(TextureStreamer& streamer, size_t budgetBytes)
+	: streamer(streamer), budget(budgetBytes)
+{
+}
+
+TextureResidency::~TextureResidency()
+{
+	// The decodes of the loaders and of streamIn count in LoadReport::inFlight
+	while (LoadReport::inFlight > 0)
+		std::this_thread::yield();
+	if (active == this)
+		active = nullptr;
+}
+
+// Registers a new texture and returns the finest level it should be created with
+GLint TextureResidency::Register(GLuint texture, const std::string& image, const TextureLayout& layout, const std::string& asset)
+{
+	GLint level = 0;
+	while (initialMaxSize > 0 && level < layout.levels - 1 &&
+		std::max(layout.width >> level, layout.height >> level) > initialMaxSize)
+		level++;
+
+	Entry entry;
+	entry.image = image;
+	entry.asset = asset;
+	entry.layout = layout;
+	entry.allocatedLevel = level;
+	entry.targetLevel = level;
+	entry.loading = true;
+	entry.undecodable = false;
+	loadingTextures++;
+	entry.desiredLevel = level;
+	entry.screenSize = 0.0f;
+	entries[texture] = entry;
+
+	residentBytes += levelBytes(layout, level);
+	MemoryTracker::Add(asset, MemoryTextures, levelBytes(layout, level));
+	return level;
+}
+
+// Forgets a texture that is about to be deleted and releases its levels, returns false if it wasn't registered
+bool TextureResidency::Unregister(GLuint texture)
+{
+	auto found = entries.find(texture);
+	if (found == entries.end())
+		return false;
+	const Entry& entry = found->second;
+	residentBytes -= levelBytes(entry.layout, entry.allocatedLevel);
+	MemoryTracker::Release(entry.asset, MemoryTextures, levelBytes(entry.layout, entry.allocatedLevel));
+	if (entry.loading)
+		loadingTextures--;
+	entries.erase(found);
+	return true;
+}
+
+// Any thread: the image of a texture couldn't be decoded, the next Update stops waiting for its levels
+void TextureResidency::DecodeFailed(GLuint texture)
+{
+	std::lock_guard<std::mutex> lock(failedMutex);
+	failed.push_back(texture);
+}
+
+// Render thread, once per frame: picks the level each texture needs and streams/evicts levels
+void TextureResidency::Update(const std::vector<Model*>& models, const Camera& camera, float FOVdeg)
+{
+	// The levels a failed decode was to upload never arrive: the texture settles on what is visible and isn't
+	// streamed again, its image would fail the same way
+	{
+		std::lock_guard<std::mutex> lock(failedMutex);
+		for (GLuint texture : failed)
+		{
+			auto found = entries.find(texture);
+			if (found == entries.end())
+				continue;
+			Entry& entry = found->second;
+			GLint base = streamer.BaseLevel(texture);
+			entry.targetLevel = base >= 0 ? base : entry.layout.levels - 1;
+			entry.undecodable = true;
+			if (entry.loading)
+				loadingTextures--;
+			entry.loading = false;
+		}
+		failed.clear();
+	}
+
+	for (auto& item : entries)
+		item.second.screenSize = 0.0f;
+
+	// Projected diameter in pixels of every mesh, kept per texture as the largest of its meshes
+	float pixelsPerUnit = camera.height / (2.0f * std::tan(glm::radians(FOVdeg) * 0.5f));
+	for (Model* model : models)
+	{
+		const std::vector<Mesh>& meshes = model->GetMeshes();
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			BoundingSphere bounds = model->GetMeshBounds(i);
+			float distance = glm::length(bounds.center - camera.Position);
+			float size = distance <= bounds.radius ? (float)camera.height : 2.0f * bounds.radius * pixelsPerUnit / distance;
+
+			for (const Texture& texture : meshes[i].textures)
+			{
+				auto entry = entries.find(texture.ID);
+				if (entry != entries.end())
+					entry->second.screenSize = std::max(entry->second.screenSize, size);
+			}
+		}
+	}
+
+	// About one texel per pixel: every halving of the on screen size allows one coarser level
+	size_t desiredBytes = 0;
+	for (auto& item : entries)
+	{
+		Entry& entry = item.second;
+		GLint lastLevel = entry.layout.levels - 1;
+		if (entry.screenSize <= 0.0f)
+			entry.desiredLevel = lastLevel;
+		else
+		{
+			float side = (float)std::max(entry.layout.width, entry.layout.height);
+			float level = std::floor(std::log2(side / entry.screenSize) + lodBias);
+			entry.desiredLevel = (GLint)std::min(std::max(level, 0.0f), (float)lastLevel);
+		}
+		desiredBytes += levelBytes(entry.layout, entry.desiredLevel);
+	}
+
+	// Over budget: keep dropping a level from the texture with the most texels per pixel
+	while (budget > 0 && desiredBytes > budget)
+	{
+		Entry* worst = nullptr;
+		float worstRatio = -1.0f;
+		for (auto& item : entries)
+		{
+			Entry& entry = item.second;
+			if (entry.desiredLevel >= entry.layout.levels - 1)
+				continue;
+			float side = (float)(std::max(entry.layout.width, entry.layout.height) >> entry.desiredLevel);
+			float ratio = side / std::max(entry.screenSize, 1.0f);
+			if (ratio > worstRatio)
+			{
+				worstRatio = ratio;
+				worst = &entry;
+			}
+		}
+		if (!worst)
+			break;
+		desiredBytes -= levelBytes(worst->layout, worst->desiredLevel) - levelBytes(worst->layout, worst->desiredLevel + 1);
+		worst->desiredLevel++;
+	}
+
+	// Streams finer levels in and evicts the ones that are no longer needed
+	int streamIns = 0;
+	waitingTextures = 0;
+	for (auto& item : entries)
+	{
+		Entry& entry = item.second;
+		if (entry.loading)
+		{
+			GLint base = streamer.BaseLevel(item.first);
+			if (base < 0 || base > entry.targetLevel)
+				continue;
+			entry.loading = false;
+			loadingTextures--;
+		}
+
+		if (entry.desiredLevel < entry.targetLevel && !entry.undecodable && streamIns >= maxStreamInsPerFrame)
+			waitingTextures++;
+		else if (entry.desiredLevel < entry.targetLevel && !entry.undecodable)
+		{
+			streamIn(item.first, entry, entry.desiredLevel);
+			streamIns++;
+		}
+		// One level of hysteresis so a visitor walking back and forth doesn't reload the same level every few frames
+		else if (entry.desiredLevel > entry.targetLevel + 1 ||
+			(budget > 0 && residentBytes > budget && entry.desiredLevel > entry.targetLevel))
+		{
+			evict(item.first, entry, entry.desiredLevel);
+		}
+	}
+}
+
+// Bytes of the levels from 'level' to the last one
+size_t TextureResidency::levelBytes(const TextureLayout& layout, GLint level)
+{
+	size_t bytes = 0;
+	for (GLint i = level; i < layout.levels; i++)
+		bytes += (size_t)std::max(1, layout.width >> i) * std::max(1, layout.height >> i) * Texture::BytesPerTexel(layout.internalFormat);
+	return bytes;
+}
+
+void TextureResidency::streamIn(GLuint texture, Entry& entry, GLint level)
+{
+	// Allocates the missing levels, the coarser ones stay visible until the new ones arrive
+	glBindTexture(GL_TEXTURE_2D, texture);
+	for (GLint i = level; i < entry.allocatedLevel; i++)
+	{
+		glTexImage2D(GL_TEXTURE_2D, i, entry.layout.internalFormat,
+			std::max(1, entry.layout.width >> i), std::max(1, entry.layout.height >> i), 0,
+			entry.layout.format, GL_UNSIGNED_BYTE, NULL);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glFlush();
+
+	residentBytes += levelBytes(entry.layout, level) - levelBytes(entry.layout, entry.allocatedLevel);
+	MemoryTracker::Add(entry.asset, MemoryTextures, levelBytes(entry.layout, level) - levelBytes(entry.layout, entry.allocatedLevel));
+	GLint firstMissing = entry.targetLevel - 1;
+	entry.allocatedLevel = level;
+	entry.targetLevel = level;
+	if (!entry.loading)
+		loadingTextures++;
+	entry.loading = true;
+
+	// Marked busy like the loaders' decodes, so room streaming doesn't delete the texture while the job still refers to
+	// it, and counted in LoadReport::inFlight so the destructors of residency and streamer wait for it
+	TextureResidency* residency = this;
+	TextureStreamer* uploader = &streamer;
+	std::string image = entry.image;
+	TextureLayout layout = entry.layout;
+	LoadReport::inFlight++;
+	streamer.Begin(texture);
+	ThreadPool::Shared().Submit([residency, uploader, texture, image, layout, level, firstMissing]()
+	{
+		std::vector<MipLevel> mips = Texture::DecodeLevels(image, layout);
+		if ((GLint)mips.size() <= level)
+			residency->DecodeFailed(texture);
+		else
+		{
+			for (GLint i = std::min(firstMissing, (GLint)mips.size() - 1); i >= level; i--)
+				uploader->Upload(texture, GL_TEXTURE_2D, i, mips[i].width, mips[i].height, layout.format, std::move(mips[i].pixels));
+		}
+		uploader->End(texture);
+		LoadReport::inFlight--;
+	});
+}
+
+void TextureResidency::evict(GLuint texture, Entry& entry, GLint level)
+{
+	// Stops sampling the finer levels first, then gives their storage back by redefining them as empty
+	streamer.SetBaseLevel(texture, level);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	for (GLint i = entry.allocatedLevel; i < level; i++)
+		glTexImage2D(GL_TEXTURE_2D, i, entry.layout.internalFormat, 0, 0, 0, entry.layout.format, GL_UNSIGNED_BYTE, NULL);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	residentBytes -= levelBytes(entry.layout, entry.allocatedLevel) - levelBytes(entry.layout, level);
+	MemoryTracker::Release(entry.asset, MemoryTextures, levelBytes(entry.layout, entry.allocatedLevel) - levelBytes(entry.layout, level));
+	entry.allocatedLevel = level;
+	entry.targetLevel = level;
+}
\ No newline at end of file
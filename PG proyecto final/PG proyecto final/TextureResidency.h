@@ -0,0 +1,82 @@
+#ifndef TEXTURE_RESIDENCY_CLASS_H
+#define TEXTURE_RESIDENCY_CLASS_H
+
+#include<map>
+#include<mutex>
+#include<string>
+#include<vector>
+
+#include"Texture.h"
+#include"TextureStreamer.h"
+
+class Model;
+class Camera;
+
+// Keeps each streamed texture resident only down to the mip level its meshes need on screen
+class TextureResidency
+{
+public:
+	TextureResidency(TextureStreamer& streamer, size_t budgetBytes = 0);
+	// Waits for the decodes still running, they report back to it
+	~TextureResidency();
+
+	// Registers a new texture of an asset and returns the finest level it should be created with
+	GLint Register(GLuint texture, const std::string& image, const TextureLayout& layout, const std::string& asset = std::string());
+	// Forgets a texture that is about to be deleted and releases its levels, returns false if it wasn't registered
+	bool Unregister(GLuint texture);
+	// Any thread: the image of a texture couldn't be decoded, the next Update stops waiting for its levels
+	void DecodeFailed(GLuint texture);
+	// Render thread, once per frame: picks the level each texture needs and streams/evicts levels
+	void Update(const std::vector<Model*>& models, const Camera& camera, float FOVdeg);
+
+	// Bytes currently allocated on the GPU for the registered textures
+	size_t ResidentBytes() const { return residentBytes; }
+	size_t Budget() const { return budget; }
+	// Textures waiting for levels they were given, 0 once residency has settled
+	int Loading() const { return loadingTextures; }
+	// True while levels are on their way or the last Update left textures to stream in next frame
+	bool Busy() const { return loadingTextures > 0 || waitingTextures > 0; }
+
+	// Largest side textures start with before their meshes are seen (0 = full size)
+	static int initialMaxSize;
+	// Extra levels of blur accepted before streaming finer levels (hysteresis for evictions is one level more)
+	static float lodBias;
+	// Residency manager used by Texture, nullptr when every level stays resident
+	static TextureResidency* active;
+
+private:
+	struct Entry
+	{
+		std::string image;
+		// Owner of the texture in the memory tracker
+		std::string asset;
+		TextureLayout layout;
+		// Finest level with storage allocated, and finest level being/been uploaded into it
+		GLint allocatedLevel;
+		GLint targetLevel;
+		bool loading;
+		// Its image failed to decode, it keeps the levels it has
+		bool undecodable;
+		// Level wanted this frame
+		GLint desiredLevel;
+		// Largest projected size in pixels of the meshes using the texture
+		float screenSize;
+	};
+
+	TextureStreamer& streamer;
+	size_t budget;
+	size_t residentBytes = 0;
+	int loadingTextures = 0;
+	// Textures that wanted finer levels in the last Update but went over maxStreamInsPerFrame
+	int waitingTextures = 0;
+	std::map<GLuint, Entry> entries;
+	// Textures reported by DecodeFailed since the last Update
+	std::mutex failedMutex;
+	std::vector<GLuint> failed;
+
+	// Bytes of the levels from 'level' to the last one
+	static size_t levelBytes(const TextureLayout& layout, GLint level);
+	void streamIn(GLuint texture, Entry& entry, GLint level);
+	void evict(GLuint texture, Entry& entry, GLint level);
+};
+#endif
\ No newline at end of file
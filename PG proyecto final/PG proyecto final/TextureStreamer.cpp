@@ -0,0 +1,251 @@
+#include"TextureStreamer.h"
+#include"Profiler.h"
+#include"LoadReport.h"
+#include<cstring>
+#include<iostream>
+#include<algorithm>
+
+TextureStreamer* TextureStreamer::active = nullptr;
+
+// Bytes per texel of the client formats the loaders use
+static int channelsOf(GLenum format)
+{
+	switch (format)
+	{
+	case GL_RED: return 1;
+	case GL_RG: return 2;
+	case GL_RGB: return 3;
+	default: return 4;
+	}
+}
+
+// Creates a hidden window sharing objects with mainWindow and starts the upload thread on it
+TextureStreamer::TextureStreamer(GLFWwindow* mainWindow, unsigned int ringSize, size_t slotBytes)
+	: ringSize(ringSize), slotBytes(slotBytes), pending(0)
+{
+	// GLFW windows can only be created on the main thread, the context is then moved to the upload thread
+	glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+	uploadWindow = glfwCreateWindow(1, 1, "Texture upload", NULL, mainWindow);
+	glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
+	if (!uploadWindow)
+	{
+		std::cerr << "ERROR: Failed to create the texture upload context, textures will load synchronously" << std::endl;
+		return;
+	}
+
+	uploadThread = std::thread(&TextureStreamer::uploadLoop, this);
+}
+
+// Stops the upload thread and releases the ring
+TextureStreamer::~TextureStreamer()
+{
+	if (!uploadWindow)
+		return;
+
+	// Texture decodes still running on the workers hand their levels to it
+	while (LoadReport::inFlight > 0)
+		std::this_thread::yield();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	uploadThread.join();
+
+	for (Completion& completion : completions)
+		glDeleteSync(completion.fence);
+	glfwDestroyWindow(uploadWindow);
+	if (active == this)
+		active = nullptr;
+}
+
+// Queues one level of a texture (or one cube map face) whose storage was already allocated. Can be called from any thread
+void TextureStreamer::Upload(GLuint texture, GLenum target, GLint level, int width, int height, GLenum format, std::vector<unsigned char> pixels,
+	const std::string& asset, const std::string& image)
+{
+	pending++;
+	Begin(texture);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		requests.push_back(Request{ texture, target, level, width, height, format, std::move(pixels), asset, image });
+	}
+	condition.notify_one();
+}
+
+// Render thread, once per frame: lowers GL_TEXTURE_BASE_LEVEL of textures whose finer levels have arrived.
+// Returns true if anything new became visible
+bool TextureStreamer::Update()
+{
+	std::vector<Completion> ready;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (completions.empty())
+			return false;
+
+		// Only take the uploads the GPU has actually finished, the rest are checked again next frame
+		for (unsigned int i = 0; i < completions.size(); )
+		{
+			if (glClientWaitSync(completions[i].fence, 0, 0) != GL_TIMEOUT_EXPIRED)
+			{
+				ready.push_back(completions[i]);
+				completions.erase(completions.begin() + i);
+			}
+			else
+				i++;
+		}
+	}
+
+	for (Completion& completion : ready)
+	{
+		glDeleteSync(completion.fence);
+		pending--;
+		End(completion.texture);
+
+		// Cube map faces have no mips, waiting for the fence is enough to make them visible
+		if (completion.target != GL_TEXTURE_2D)
+			continue;
+
+		auto base = baseLevels.find(completion.texture);
+		if (base == baseLevels.end() || completion.level < base->second)
+		{
+			baseLevels[completion.texture] = completion.level;
+			glBindTexture(GL_TEXTURE_2D, completion.texture);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, completion.level);
+		}
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+	return !ready.empty();
+}
+
+// Render thread: finest visible level of a streamed 2D texture, -1 if none arrived yet
+GLint TextureStreamer::BaseLevel(GLuint texture) const
+{
+	auto base = baseLevels.find(texture);
+	return base == baseLevels.end() ? -1 : base->second;
+}
+
+// Render thread: forces the finest visible level, used when finer levels are evicted
+void TextureStreamer::SetBaseLevel(GLuint texture, GLint level)
+{
+	baseLevels[texture] = level;
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+// Render thread: drops the level of a texture about to be deleted, GL reuses its name for the next one
+void TextureStreamer::Forget(GLuint texture)
+{
+	baseLevels.erase(texture);
+}
+
+void TextureStreamer::Begin(GLuint texture)
+{
+	std::lock_guard<std::mutex> lock(busyMutex);
+	busy[texture]++;
+}
+
+void TextureStreamer::End(GLuint texture)
+{
+	std::lock_guard<std::mutex> lock(busyMutex);
+	auto found = busy.find(texture);
+	if (found != busy.end() && --found->second <= 0)
+		busy.erase(found);
+}
+
+bool TextureStreamer::Busy(GLuint texture) const
+{
+	std::lock_guard<std::mutex> lock(busyMutex);
+	return busy.find(texture) != busy.end();
+}
+
+void TextureStreamer::uploadLoop()
+{
+	Profiler::SetThreadName("texture upload");
+	glfwMakeContextCurrent(uploadWindow);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+	// Ring of pixel buffers: the CPU fills one slot while the GPU copies out of the others
+	std::vector<Slot> ring(ringSize);
+	for (Slot& slot : ring)
+	{
+		glGenBuffers(1, &slot.buffer);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+		glBufferData(GL_PIXEL_UNPACK_BUFFER, slotBytes, NULL, GL_STREAM_DRAW);
+	}
+	unsigned int nextSlot = 0;
+
+	while (true)
+	{
+		Request request;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !requests.empty(); });
+			if (stopping)
+				break;
+			request = std::move(requests.front());
+			requests.pop_front();
+		}
+		PROFILE_SCOPE("Texture upload");
+		LoadTimer loadTimer(request.asset, StageGpuUpload, request.image);
+		loadTimer.bytes = request.pixels.size();
+
+		GLenum bindTarget = request.target == GL_TEXTURE_2D ? GL_TEXTURE_2D : GL_TEXTURE_CUBE_MAP;
+		size_t rowBytes = (size_t)request.width * channelsOf(request.format);
+		int rowsPerSlot = std::max(1, (int)(slotBytes / rowBytes));
+		glBindTexture(bindTarget, request.texture);
+
+		// Big levels are split into bands of rows that fit in one slot
+		for (int y = 0; y < request.height; y += rowsPerSlot)
+		{
+			int rows = std::min(rowsPerSlot, request.height - y);
+			size_t bytes = rows * rowBytes;
+			Slot& slot = ring[nextSlot];
+			nextSlot = (nextSlot + 1) % ringSize;
+
+			// Waits until the GPU is done with the previous copy out of this slot
+			if (slot.fence)
+			{
+				while (glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED);
+				glDeleteSync(slot.fence);
+				slot.fence = 0;
+			}
+
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, slot.buffer);
+			void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes,
+				GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+			if (mapped)
+			{
+				std::memcpy(mapped, request.pixels.data() + y * rowBytes, bytes);
+				glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+				glTexSubImage2D(request.target, request.level, 0, y, request.width, rows,
+					request.format, GL_UNSIGNED_BYTE, (void*)0);
+			}
+			else
+			{
+				// Mapping can fail on some drivers, fall back to a plain client memory upload
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				glTexSubImage2D(request.target, request.level, 0, y, request.width, rows,
+					request.format, GL_UNSIGNED_BYTE, request.pixels.data() + y * rowBytes);
+			}
+			slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		glBindTexture(bindTarget, 0);
+
+		// Hands the level to the render thread once the GPU has it
+		GLsync done = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		glFlush();
+		std::lock_guard<std::mutex> lock(mutex);
+		completions.push_back(Completion{ request.texture, request.target, request.level, done });
+	}
+
+	for (Slot& slot : ring)
+	{
+		if (slot.fence)
+			glDeleteSync(slot.fence);
+		glDeleteBuffers(1, &slot.buffer);
+	}
+	glFinish();
+	glfwMakeContextCurrent(NULL);
+}
\ No newline at end of file
@@ -0,0 +1,98 @@
+#ifndef TEXTURE_STREAMER_CLASS_H
+#define TEXTURE_STREAMER_CLASS_H
+
+#include<glad/glad.h>
+#include<GLFW/glfw3.h>
+#include<vector>
+#include<deque>
+#include<map>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<atomic>
+#include<string>
+
+class TextureStreamer
+{
+public:
+	// Creates a hidden window sharing objects with mainWindow and starts the upload thread on it
+	TextureStreamer(GLFWwindow* mainWindow, unsigned int ringSize = 4, size_t slotBytes = 8 * 1024 * 1024);
+	// Stops the upload thread and releases the ring
+	~TextureStreamer();
+
+	// True if the shared context could be created
+	bool IsRunning() const { return uploadWindow != nullptr; }
+
+	// Queues one level of a texture (or one cube map face) whose storage was already allocated. Can be called from any thread.
+	// The upload time is added to the load report of 'asset' when one is given
+	void Upload(GLuint texture, GLenum target, GLint level, int width, int height, GLenum format, std::vector<unsigned char> pixels,
+		const std::string& asset = std::string(), const std::string& image = std::string());
+	// Render thread, once per frame: lowers GL_TEXTURE_BASE_LEVEL of textures whose finer levels have arrived.
+	// Returns true if anything new became visible
+	bool Update();
+	// Levels queued or uploaded but not yet visible to the render thread
+	int Pending() const { return pending; }
+	// Render thread: finest visible level of a streamed 2D texture, -1 if none arrived yet
+	GLint BaseLevel(GLuint texture) const;
+	// Render thread: forces the finest visible level, used when finer levels are evicted
+	void SetBaseLevel(GLuint texture, GLint level);
+	// Render thread: drops the level of a texture about to be deleted, GL reuses its name for the next one
+	void Forget(GLuint texture);
+	// Work on a texture that must finish before it is deleted: a decode started with Begin and ended with End once its
+	// levels are queued, and every queued level until it is visible. Begin and End can be called from any thread
+	void Begin(GLuint texture);
+	void End(GLuint texture);
+	bool Busy(GLuint texture) const;
+
+	// Streamer used by Texture and the other loaders, nullptr when everything is uploaded synchronously
+	static TextureStreamer* active;
+
+private:
+	struct Request
+	{
+		GLuint texture;
+		GLenum target;
+		GLint level;
+		int width;
+		int height;
+		GLenum format;
+		std::vector<unsigned char> pixels;
+		// Load report entry of the level
+		std::string asset;
+		std::string image;
+	};
+	struct Completion
+	{
+		GLuint texture;
+		GLenum target;
+		GLint level;
+		GLsync fence;
+	};
+	// One pixel buffer of the ring and the fence of the last copy that used it
+	struct Slot
+	{
+		GLuint buffer = 0;
+		GLsync fence = 0;
+	};
+
+	GLFWwindow* uploadWindow = nullptr;
+	std::thread uploadThread;
+	unsigned int ringSize;
+	size_t slotBytes;
+
+	std::mutex mutex;
+	std::condition_variable condition;
+	std::deque<Request> requests;
+	std::vector<Completion> completions;
+	bool stopping = false;
+	std::atomic<int> pending;
+
+	// Finest level that is already visible for every streamed 2D texture
+	std::map<GLuint, GLint> baseLevels;
+	// Decodes and levels still on their way, by texture
+	mutable std::mutex busyMutex;
+	std::map<GLuint, int> busy;
+
+	void uploadLoop();
+};
+#endif
\ No newline at end of file
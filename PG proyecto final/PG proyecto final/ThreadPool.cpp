@@ -0,0 +1,126 @@
+#include"ThreadPool.h"
+#include"Profiler.h"
+#include<atomic>
+#include<algorithm>
+
+// Starts the worker threads (one per core by default)
+ThreadPool::ThreadPool(unsigned int numThreads)
+{
+	if (numThreads == 0)
+		numThreads = std::max(1u, std::thread::hardware_concurrency());
+
+	for (unsigned int i = 0; i < numThreads; i++)
+	{
+		workers.emplace_back([this, i]()
+		{
+			Profiler::SetThreadName("worker " + std::to_string(i));
+			workerLoop();
+		});
+	}
+}
+
+// Finishes the queued jobs and joins the workers
+ThreadPool::~ThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	condition.notify_all();
+	for (std::thread& worker : workers)
+		worker.join();
+}
+
+// Queues a job to run on a worker thread
+std::future<void> ThreadPool::Submit(std::function<void()> job)
+{
+	auto task = std::make_shared<std::packaged_task<void()>>(std::move(job));
+	std::future<void> result = task->get_future();
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		jobs.push([task]() { (*task)(); });
+	}
+	condition.notify_one();
+	return result;
+}
+
+// Splits [0, count) into chunks and runs fn(begin, end) on the workers, returns when all chunks are done
+void ThreadPool::ParallelFor(int count, const std::function<void(int, int)>& fn, int minChunk)
+{
+	if (count <= 0)
+		return;
+
+	// Not worth waking the workers for a single chunk
+	int numChunks = std::min((int)Size() + 1, (count + minChunk - 1) / minChunk);
+	if (numChunks <= 1)
+	{
+		fn(0, count);
+		return;
+	}
+
+	int chunkSize = (count + numChunks - 1) / numChunks;
+	std::atomic<int> remaining(numChunks - 1);
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (int chunk = 1; chunk < numChunks; chunk++)
+		{
+			int begin = chunk * chunkSize;
+			int end = std::min(count, begin + chunkSize);
+			jobs.push([&fn, &remaining, begin, end]()
+			{
+				if (begin < end)
+					fn(begin, end);
+				remaining--;
+			});
+		}
+	}
+	condition.notify_all();
+
+	// The calling thread takes the first chunk, then helps with the queue so that
+	// calling ParallelFor from inside a worker can never deadlock the pool
+	fn(0, std::min(count, chunkSize));
+	while (remaining > 0)
+	{
+		if (!runPendingJob())
+			std::this_thread::yield();
+	}
+}
+
+// Pool shared by the loaders
+ThreadPool& ThreadPool::Shared()
+{
+	static ThreadPool pool;
+	return pool;
+}
+
+// Runs one queued job on the calling thread, returns false if the queue was empty
+bool ThreadPool::runPendingJob()
+{
+	std::function<void()> job;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if (jobs.empty())
+			return false;
+		job = std::move(jobs.front());
+		jobs.pop();
+	}
+	job();
+	return true;
+}
+
+void ThreadPool::workerLoop()
+{
+	while (true)
+	{
+		std::function<void()> job;
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			condition.wait(lock, [this]() { return stopping || !jobs.empty(); });
+			if (stopping && jobs.empty())
+				return;
+			job = std::move(jobs.front());
+			jobs.pop();
+		}
+		job();
+	}
+}
\ No newline at end of file
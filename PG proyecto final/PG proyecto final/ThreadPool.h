@@ -0,0 +1,41 @@
+#ifndef THREAD_POOL_CLASS_H
+#define THREAD_POOL_CLASS_H
+
+#include<vector>
+#include<queue>
+#include<thread>
+#include<mutex>
+#include<condition_variable>
+#include<functional>
+#include<future>
+
+class ThreadPool
+{
+public:
+	// Starts the worker threads (one per core by default)
+	ThreadPool(unsigned int numThreads = 0);
+	// Finishes the queued jobs and joins the workers
+	~ThreadPool();
+
+	// Queues a job to run on a worker thread
+	std::future<void> Submit(std::function<void()> job);
+	// Splits [0, count) into chunks and runs fn(begin, end) on the workers, returns when all chunks are done
+	void ParallelFor(int count, const std::function<void(int, int)>& fn, int minChunk = 1);
+	// Number of worker threads
+	unsigned int Size() const { return (unsigned int)workers.size(); }
+
+	// Pool shared by the loaders
+	static ThreadPool& Shared();
+
+private:
+	std::vector<std::thread> workers;
+	std::queue<std::function<void()>> jobs;
+	std::mutex mutex;
+	std::condition_variable condition;
+	bool stopping = false;
+
+	// Runs one queued job on the calling thread, returns false if the queue was empty
+	bool runPendingJob();
+	void workerLoop();
+};
+#endif
\ No newline at end of file
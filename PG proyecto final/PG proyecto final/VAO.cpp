@@ -6,11 +6,11 @@ VAO::VAO()
 	glGenVertexArrays(1, &ID);
 }
 
-// Links a VBO Attribute such as a position or color to the VAO
-void VAO::LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset)
+// Links a VBO Attribute such as a position or color to the VAO, normalized integers are read as [0, 1] or [-1, 1]
+void VAO::LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset, GLboolean normalized)
 {
 	VBO.Bind();
-	glVertexAttribPointer(layout, numComponents, type, GL_FALSE, stride, offset);
+	glVertexAttribPointer(layout, numComponents, type, normalized, stride, offset);
 	glEnableVertexAttribArray(layout);
 	VBO.Unbind();
 }
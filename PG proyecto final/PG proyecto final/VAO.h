@@ -12,8 +12,8 @@ public:
 	// Constructor that generates a VAO ID
 	VAO();
 
-	// Links a VBO Attribute such as a position or color to the VAO
-	void LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset);
+	// Links a VBO Attribute such as a position or color to the VAO, normalized integers are read as [0, 1] or [-1, 1]
+	void LinkAttrib(VBO& VBO, GLuint layout, GLuint numComponents, GLenum type, GLsizeiptr stride, void* offset, GLboolean normalized = GL_FALSE);
 	// Binds the VAO
 	void Bind();
 	// Unbinds the VAO
@@ -8,6 +8,14 @@ VBO::VBO(std::vector<Vertex>& vertices)
 	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), vertices.data(), GL_STATIC_DRAW);
 }
 
+// Constructor that generates a Vertex Buffer Object and links it to vertices in a VertexFormat
+VBO::VBO(std::vector<unsigned char>& bytes)
+{
+	glGenBuffers(1, &ID);
+	glBindBuffer(GL_ARRAY_BUFFER, ID);
+	glBufferData(GL_ARRAY_BUFFER, bytes.size(), bytes.data(), GL_STATIC_DRAW);
+}
+
 // Binds the VBO
 void VBO::Bind()
 {
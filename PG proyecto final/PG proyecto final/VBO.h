@@ -14,6 +14,24 @@ struct Vertex
 	glm::vec2 texUV;
 };
 
+// Where an attribute is in a vertex that isn't a Vertex, e.g. 8/16 bit KHR_mesh_quantization data
+struct VertexAttribute
+{
+	// GL_FLOAT, GL_SHORT, GL_UNSIGNED_BYTE...
+	GLenum type;
+	GLint components;
+	GLboolean normalized;
+	GLsizeiptr offset;
+};
+
+// Layout of such vertices, every attribute starts 4 byte aligned
+struct VertexFormat
+{
+	VertexAttribute position;
+	VertexAttribute normal;
+	VertexAttribute texUV;
+	GLsizei stride;
+};
 
 
 class VBO
@@ -23,6 +41,8 @@ public:
 	GLuint ID;
 	// Constructor that generates a Vertex Buffer Object and links it to vertices
 	VBO(std::vector<Vertex>& vertices);
+	// Constructor that generates a Vertex Buffer Object and links it to vertices in a VertexFormat
+	VBO(std::vector<unsigned char>& bytes);
 
 	// Binds the VBO
 	void Bind();
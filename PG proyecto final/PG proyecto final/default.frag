@@ -23,6 +23,16 @@ uniform vec4 lightColor;
 uniform vec3 lightPos;
 // Gets the position of the camera from the main function
 uniform vec3 camPos;
+// Below 1 the model is dithered out while its impostor fades in (impostor.frag keeps the other pixels)
+uniform float fade = 1.0;
+
+// 4x4 ordered dither threshold of the pixel, in (0, 1)
+float dither()
+{
+	const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+	ivec2 pixel = ivec2(gl_FragCoord.xy) % 4;
+	return (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+}
 
 
 
@@ -106,6 +116,8 @@ vec4 spotLight()
 
 void main()
 {
+	if (fade < 1.0 && dither() >= fade)
+		discard;
 	// outputs final color
 	FragColor = direcLight();
 }
\ No newline at end of file
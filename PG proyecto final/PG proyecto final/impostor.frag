@@ -0,0 +1,59 @@
+#version 330 core
+out vec4 FragColor;
+
+in vec2 texCoord;
+in vec3 bakedPos;
+
+uniform sampler2D albedo;
+uniform sampler2D normalDepth;
+// The four views around the camera direction: where each starts in the atlas and how much it counts
+uniform vec2 frames[4];
+uniform vec4 weights;
+// Size of one view in the atlas
+uniform float frameSize;
+
+uniform mat4 camMatrix;
+uniform mat4 instance;
+uniform float radius;
+// Towards the camera, in the baked space
+uniform vec3 viewDirection;
+uniform vec4 lightColor;
+// The mesh's fade: it keeps the pixels default.frag's dither lets through and the impostor the rest
+uniform float fade;
+
+float dither()
+{
+	const float bayer[16] = float[16](0.0, 8.0, 2.0, 10.0, 12.0, 4.0, 14.0, 6.0, 3.0, 11.0, 1.0, 9.0, 15.0, 7.0, 13.0, 5.0);
+	ivec2 pixel = ivec2(gl_FragCoord.xy) % 4;
+	return (bayer[pixel.y * 4 + pixel.x] + 0.5) / 16.0;
+}
+
+void main()
+{
+	if (dither() < fade)
+		discard;
+
+	// Texels outside the model are all zero, so the blend is premultiplied by coverage
+	vec4 color = vec4(0.0);
+	vec4 surface = vec4(0.0);
+	for (int i = 0; i < 4; i++)
+	{
+		vec2 uv = frames[i] + texCoord * frameSize;
+		color += texture(albedo, uv) * weights[i];
+		surface += texture(normalDepth, uv) * weights[i];
+	}
+	if (color.a < 0.5)
+		discard;
+	color.rgb /= color.a;
+	surface /= color.a;
+
+	// Depth of the surface instead of the quad's: 0 is the front of the sphere and 1 the back
+	vec3 position = bakedPos - viewDirection * radius * (surface.a * 2.0 - 1.0);
+	vec4 clip = camMatrix * instance * vec4(position, 1.0);
+	gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+
+	// default.frag's directional light, without the specular highlight
+	vec3 normal = normalize(surface.rgb * 2.0 - 1.0);
+	float diffuse = max(dot(normal, normalize(vec3(1.0f, 1.0f, 0.0f))), 0.0f);
+	FragColor = vec4(color.rgb * (diffuse + 0.9f), 1.0) * lightColor;
+}
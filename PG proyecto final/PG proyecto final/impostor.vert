@@ -0,0 +1,23 @@
+#version 330 core
+// Corner of the quad, -1 to 1
+layout (location = 0) in vec2 aPos;
+
+out vec2 texCoord;
+// Position on the quad in the space the atlas was baked in
+out vec3 bakedPos;
+
+uniform mat4 camMatrix;
+// Baked space to the world space of this instance
+uniform mat4 instance;
+// Bounding sphere of the baked model, and the quad axes facing the camera
+uniform vec3 center;
+uniform float radius;
+uniform vec3 right;
+uniform vec3 up;
+
+void main()
+{
+	texCoord = aPos * 0.5 + 0.5;
+	bakedPos = center + (right * aPos.x + up * aPos.y) * radius;
+	gl_Position = camMatrix * instance * vec4(bakedPos, 1.0);
+}
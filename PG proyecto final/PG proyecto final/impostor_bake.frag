@@ -0,0 +1,19 @@
+#version 330 core
+
+// Atlas of ImpostorRenderer: albedo and coverage, and the normal with the depth across the bounding sphere
+layout (location = 0) out vec4 albedo;
+layout (location = 1) out vec4 normalDepth;
+
+// Imports the normal from default.vert, lit by impostor.frag the same way default.frag lights the mesh
+in vec3 Normal;
+// Imports the texture coordinates from default.vert
+in vec2 texCoord;
+
+uniform sampler2D diffuse0;
+
+void main()
+{
+	albedo = vec4(texture(diffuse0, texCoord).rgb, 1.0);
+	// The orthographic views put the near and far planes on the sphere, so depth is linear across it
+	normalDepth = vec4(normalize(Normal) * 0.5 + 0.5, gl_FragCoord.z);
+}
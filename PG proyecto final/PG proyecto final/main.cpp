@@ -6,6 +6,14 @@
 #include <vector>
 #include <string>
 #include <limits>
+#include <memory>
+#include <fstream>
+#include <thread>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <algorithm>
+#include <random>
 #include "ShaderClass.h"
 #include "Model.h"
 #include "TextRenderer.h"
@@ -14,6 +22,26 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include "AudioManager.h"
+#include "MipGenerator.h"
+#include "TextureStreamer.h"
+#include "TextureResidency.h"
+#include "Benchmark.h"
+#include "InputSystem.h"
+#include "Scene.h"
+#include "SceneRuntime.h"
+#include "LevelStreamer.h"
+#include "PortalVisibility.h"
+#include "OcclusionCuller.h"
+#include "SoftwareOcclusion.h"
+#include "ImpostorRenderer.h"
+#include "SimulationClock.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "FrameAllocator.h"
+#include "AllocationCounter.h"
+#include "PerfSuite.h"
+#include "LoadReport.h"
+#include "MemoryTracker.h"
 
 // Structure for model information display
 struct ModelInfo {
@@ -28,6 +56,8 @@ bool showHelp = false;
 bool showHelpPage2 = false;
 bool showCredits = false;
 bool showModelInfoFlag = false;
+// GPU pass timings and render counters overlay, toggled with F3
+bool showStats = false;
 std::string currentModelTitle;
 std::string currentModelDescription;
 std::string currentMusic = "";
@@ -39,6 +69,8 @@ std::vector<Button> menuButtons;
 glm::vec2 mousePos;
 bool mousePressed = false;
 bool menu = true;
+// Set by any window event, an idle screen is only drawn again once something happened
+bool redrawRequested = true;
 
 // Camera movement boundaries
 float radius = 17.5f;
@@ -123,9 +155,11 @@ unsigned int skyboxIndices[] = {
 // Mouse callback functions
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
     mousePos = glm::vec2(xpos, ypos);
+    redrawRequested = true;
 }
 
 void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
+    redrawRequested = true;
     if (button == GLFW_MOUSE_BUTTON_LEFT) {
         mousePressed = (action == GLFW_PRESS);
 
@@ -161,6 +195,13 @@ void mouse_button_callback(GLFWwindow* window, int button, int action, int mods)
 
 // Keyboard callback function
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
+    redrawRequested = true;
+    if (key == GLFW_KEY_F3 && action == GLFW_PRESS)
+        showStats = !showStats;
+    if (key == GLFW_KEY_F4 && action == GLFW_PRESS) {
+        MemoryTracker::Print();
+        MemoryTracker::Write("memory_report.json");
+    }
     if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
         if (!menu && !showHelp && !showHelpPage2 && !showCredits) {
             menu = true;
@@ -175,18 +216,26 @@ void key_callback(GLFWwindow* window, int key, int scancode, int action, int mod
     }
 }
 
+// The window was uncovered or resized and its contents have to be drawn again
+void window_refresh_callback(GLFWwindow* window) {
+    redrawRequested = true;
+}
+
 // Model information display functions
 void showModelInfo(const std::string& title, const std::string& description) {
     showModelInfoFlag = true;
-    currentModelTitle = title;
-    currentModelDescription = description;
+    // Called every step while touching a model, the strings are only copied when the model changes
+    if (currentModelTitle != title || currentModelDescription != description) {
+        currentModelTitle = title;
+        currentModelDescription = description;
+    }
 }
 
 void hideModelInfo() {
     showModelInfoFlag = false;
 }
 
-void renderModelInfo(TextRenderer& textRenderer, Shader& textShader, int width, int height) {
+void renderModelInfo(TextRenderer& textRenderer, Shader& textShader, Shader& panelShader, int width, int height) {
     if (!showModelInfoFlag) return;
 
     // Set up rendering state for 2D overlay
@@ -200,7 +249,6 @@ void renderModelInfo(TextRenderer& textRenderer, Shader& textShader, int width,
     float margin = 20.0f;
 
     // Render semi-transparent background panel
-    Shader panelShader("panel.vert", "panel.frag");
     panelShader.Activate();
     glm::mat4 projection = glm::ortho(0.0f, (float)width, (float)height, 0.0f);
     glUniformMatrix4fv(glGetUniformLocation(panelShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
@@ -232,6 +280,8 @@ void renderModelInfo(TextRenderer& textRenderer, Shader& textShader, int width,
 
     glBindVertexArray(VAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    RenderStats::frame.drawCalls++;
+    RenderStats::frame.triangles += 2;
     glBindVertexArray(0);
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
@@ -291,12 +341,83 @@ void RenderPanel(Shader& panelShader, float x, float y, float width, float heigh
 
     glBindVertexArray(panelVAO);
     glDrawArrays(GL_TRIANGLES, 0, 6);
+    RenderStats::frame.drawCalls++;
+    RenderStats::frame.triangles += 2;
 
     // Clean up
     glDeleteVertexArrays(1, &panelVAO);
     glDeleteBuffers(1, &panelVBO);
 }
 
+// Render passes timed on the GPU
+enum RenderPass { PassSkybox, PassModels, PassUI, PassCount };
+
+// Stats overlay: GPU time per pass and what the last frame sent to the GPU
+void renderStatsOverlay(TextRenderer& textRenderer, Shader& textShader, Shader& panelShader, const GpuPassTimers& passTimers,
+    float frameMs, int width, int height) {
+    // Formatted in frame memory, the overlay must not add heap allocations to the frames it measures
+    const RenderCounters& counters = RenderStats::last;
+    FrameAllocator& frameMemory = FrameAllocator::Frame();
+    const float MB = 1024.0f * 1024.0f;
+    const unsigned int assetLines = 5;
+    const char* lines[15 + assetLines];
+    unsigned int lineCount = 0;
+    lines[lineCount++] = frameMemory.Format("FRAME %.2f MS  (%.0f FPS)", frameMs, frameMs > 0.0f ? 1000.0f / frameMs : 0.0f);
+    lines[lineCount++] = frameMemory.Format("GPU SKYBOX %.2f MS", passTimers.Milliseconds(PassSkybox));
+    lines[lineCount++] = frameMemory.Format("GPU MODELS %.2f MS", passTimers.Milliseconds(PassModels));
+    lines[lineCount++] = frameMemory.Format("GPU UI %.2f MS", passTimers.Milliseconds(PassUI));
+    lines[lineCount++] = frameMemory.Format("DRAW CALLS %u  TRIANGLES %zu", counters.drawCalls, counters.triangles);
+    lines[lineCount++] = frameMemory.Format("TEXTURE BINDS %u  SHADER SWITCHES %u", counters.textureBinds, counters.shaderSwitches);
+    lines[lineCount++] = frameMemory.Format("HEAP ALLOCATIONS %u", counters.heapAllocations);
+    lines[lineCount++] = frameMemory.Format("GPU TEXTURES %.1f MB  BUFFERS %.1f MB",
+        MemoryTracker::Total(MemoryTextures) / MB, MemoryTracker::Total(MemoryBuffers) / MB);
+    lines[lineCount++] = frameMemory.Format("CPU FILES %.1f MB  JSON %.1f MB  GEOMETRY %.1f MB", MemoryTracker::Total(MemoryFileData) / MB,
+        MemoryTracker::Total(MemoryJson) / MB, MemoryTracker::Total(MemoryGeometry) / MB);
+    const StreamingCounters& streaming = LevelStreamer::stats;
+    lines[lineCount++] = frameMemory.Format("ROOMS %d/%d RESIDENT  %d FILES LOADING  %d LOADS  %d UNLOADS", streaming.residentRooms,
+        streaming.rooms, streaming.loadingAssets, streaming.loads, streaming.unloads);
+    const PortalCounters& portals = PortalVisibility::stats;
+    lines[lineCount++] = frameMemory.Format("PORTALS %d/%d PASSED  %d ROOMS VISIBLE  %d MODELS CULLED", portals.portalsPassed,
+        portals.portalsTested, portals.visibleRooms, portals.culledModels);
+    const OcclusionCounters& occlusion = OcclusionCuller::stats;
+    lines[lineCount++] = frameMemory.Format("OCCLUDED %d/%d MODELS  %d OFF SCREEN  %d QUERIES  LATENCY %.1f FRAMES %.2f MS",
+        occlusion.occluded, occlusion.models, occlusion.outside, occlusion.queriesIssued, occlusion.latencyFrames, occlusion.latencyMs);
+    const SoftwareOcclusionCounters& software = SoftwareOcclusion::stats;
+    lines[lineCount++] = frameMemory.Format("CPU OCCLUSION %d/%d CULLED (%.0f%%)  %d TRIS  RASTER %.2f MS  TEST %.2f MS  WAIT %.2f MS",
+        software.culled, software.tested, software.tested > 0 ? 100.0f * software.culled / software.tested : 0.0f,
+        software.rasterizedTriangles, software.rasterMs, software.testMs, software.waitMs);
+    const ImpostorCounters& impostors = ImpostorRenderer::stats;
+    lines[lineCount++] = frameMemory.Format("IMPOSTORS %d  %d FADING  %d ATLASES  LAST BAKE %.2f MS", impostors.impostors,
+        impostors.fading, impostors.atlases, impostors.bakeMs);
+    // Largest assets, F4 dumps all of them
+    const std::vector<AssetMemory>& assets = MemoryTracker::Assets();
+    lines[lineCount++] = frameMemory.Format("TOP %u OF %zu ASSETS (F4 DUMPS ALL)", std::min(assetLines, (unsigned int)assets.size()), assets.size());
+    for (unsigned int i = 0; i < assetLines && i < assets.size(); i++)
+        lines[lineCount++] = frameMemory.Format("  %.1f MB GPU  %.1f MB CPU  %s", assets[i].Gpu() / MB, assets[i].Cpu() / MB, assets[i].asset.c_str());
+
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+    float scale = 0.3f;
+    float lineHeight = 78.0f * scale * 1.4f;
+    float margin = 20.0f;
+    glm::mat4 projection = glm::ortho(0.0f, (float)width, (float)height, 0.0f);
+    RenderPanel(panelShader, margin, margin, 900.0f, lineHeight * lineCount + margin,
+        glm::vec4(0.0f, 0.0f, 0.0f, 0.6f), projection);
+
+    textShader.Activate();
+    glUniformMatrix4fv(glGetUniformLocation(textShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    float y = margin + lineHeight;
+    for (unsigned int i = 0; i < lineCount; i++) {
+        textRenderer.RenderText(textShader, lines[i], margin + 10.0f, y, scale, glm::vec3(1.0f, 1.0f, 0.6f));
+        y += lineHeight;
+    }
+
+    glEnable(GL_DEPTH_TEST);
+    glDisable(GL_BLEND);
+}
+
 // Music and sound configuration
 std::vector<std::string> envSongs = {
     "Sound/env1.mp3",
@@ -311,16 +432,232 @@ std::string pickRandomSong(const std::vector<std::string>& songs) {
     return songs[index];
 }
 
+// Loads an image into level 0 of the texture bound to target (GL_TEXTURE_2D or a cube map face).
+// When streaming, only the header is read here and the pixels are decoded and uploaded in the background
+bool loadImageInto(GLuint texture, GLenum target, const std::string& path, int channels,
+    GLenum internalFormat, GLenum format, bool flip) {
+    TextureStreamer* streamer = TextureStreamer::active;
+    if (streamer) {
+        int imgWidth, imgHeight, imgChannels;
+        if (!stbi_info(path.c_str(), &imgWidth, &imgHeight, &imgChannels))
+            return false;
+        glTexImage2D(target, 0, internalFormat, imgWidth, imgHeight, 0, format, GL_UNSIGNED_BYTE, NULL);
+        glFlush();
+        MemoryTracker::Add(path, MemoryTextures, (size_t)imgWidth * imgHeight * channels);
+
+        ThreadPool::Shared().Submit([=]() {
+            stbi_set_flip_vertically_on_load_thread(flip);
+            int w, h, c;
+            unsigned char* data = stbi_load(path.c_str(), &w, &h, &c, channels);
+            if (!data) {
+                std::cerr << "ERROR: Failed to load " << path << std::endl;
+                return;
+            }
+            std::vector<unsigned char> pixels(data, data + (size_t)w * h * channels);
+            stbi_image_free(data);
+            streamer->Upload(texture, target, 0, w, h, format, std::move(pixels));
+        });
+        return true;
+    }
+
+    stbi_set_flip_vertically_on_load_thread(flip);
+    int imgWidth, imgHeight, imgChannels;
+    unsigned char* data = stbi_load(path.c_str(), &imgWidth, &imgHeight, &imgChannels, channels);
+    if (!data)
+        return false;
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(target, 0, internalFormat, imgWidth, imgHeight, 0, format, GL_UNSIGNED_BYTE, data);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    stbi_image_free(data);
+    MemoryTracker::Add(path, MemoryTextures, (size_t)imgWidth * imgHeight * channels);
+    return true;
+}
+
 // Window dimensions
 const unsigned int width = 1920;
 const unsigned int height = 1080;
 
-int main() {
+int main(int argc, char** argv) {
+    // Command line options
+    bool benchMips = false;
+    bool streamTextures = true;
+    bool textureResidency = true;
+    bool benchmark = false;
+    std::string benchPath;
+    std::string benchOutput = "benchmark.json";
+    int benchWidth = width;
+    int benchHeight = height;
+    float benchTimestep = 1.0f / 60.0f;
+    int benchWarmup = 60;
+    int benchFrames = 0;
+    int checkAllocationFrames = 0;
+    bool perfSuite = false;
+    bool perfUpdateBaseline = false;
+    bool perfCi = false;
+    std::string perfBaseline = "perf_baseline.json";
+    std::string perfOutput = "perf_results.json";
+    std::string loadReportOutput = "load_report.json";
+    bool loadReportOnly = false;
+    int contextApi = GLFW_NATIVE_CONTEXT_API;
+    std::string recordFile;
+    std::string replayFile;
+    std::string sceneFile;
+    bool vsync = true;
+    double fpsLimit = 0.0;
+    bool idleRendering = true;
+    std::string profileOutput = "profile.json";
+    double profileSummary = 5.0;
+    std::string generateFile;
+    std::string compileFile;
+    int generateRooms = 10;
+    int generateExhibits = 10;
+    unsigned int generateSeed = 1;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--bench-mips")
+            benchMips = true;
+        else if (arg == "--sync-textures")
+            streamTextures = false;
+        else if (arg == "--all-mips-resident")
+            textureResidency = false;
+        else if (arg == "--initial-texture-size" && i + 1 < argc)
+            TextureResidency::initialMaxSize = std::atoi(argv[++i]);   // largest side before a texture is seen, 0 = full
+        else if (arg == "--benchmark")
+            benchmark = true;
+        else if (arg == "--bench-path" && i + 1 < argc)
+            benchPath = argv[++i];                              // "time px py pz tx ty tz" per line
+        else if (arg == "--bench-output" && i + 1 < argc)
+            benchOutput = argv[++i];
+        else if (arg == "--bench-size" && i + 1 < argc)
+            std::sscanf(argv[++i], "%dx%d", &benchWidth, &benchHeight);
+        else if (arg == "--bench-timestep" && i + 1 < argc)
+            benchTimestep = (float)std::atof(argv[++i]);        // seconds of camera path per frame
+        else if (arg == "--bench-warmup" && i + 1 < argc)
+            benchWarmup = std::atoi(argv[++i]);                 // frames rendered before measuring
+        else if (arg == "--bench-frames" && i + 1 < argc)
+            benchFrames = std::atoi(argv[++i]);                 // 0 = the whole path
+        else if (arg == "--check-allocations" && i + 1 < argc) {
+            checkAllocationFrames = std::atoi(argv[++i]);       // steady frames that must not touch the heap
+            benchmark = true;
+        }
+        else if (arg == "--perf-suite") {
+            perfSuite = true;                                   // microbenchmarks + render benchmark, compared to the baseline
+            benchmark = true;
+        }
+        else if (arg == "--perf-baseline" && i + 1 < argc)
+            perfBaseline = argv[++i];
+        else if (arg == "--perf-output" && i + 1 < argc)
+            perfOutput = argv[++i];
+        else if (arg == "--load-report" && i + 1 < argc)
+            loadReportOutput = argv[++i];                       // per asset load times, written once textures have arrived
+        else if (arg == "--load-report-only")
+            loadReportOnly = true;                              // loads the scene, prints the load report and exits
+        else if (arg == "--perf-update-baseline")
+            perfUpdateBaseline = true;                          // stores this run as the new baseline instead of comparing
+        else if (arg == "--perf-ci")
+            perfCi = true;                                      // metrics without a baseline value fail the run too
+        else if (arg == "--record" && i + 1 < argc)
+            recordFile = argv[++i];                             // input log of the next walk through the gallery
+        else if (arg == "--replay" && i + 1 < argc)
+            replayFile = argv[++i];                             // walks through the gallery with a recorded input log
+        else if (arg == "--no-vsync")
+            vsync = false;
+        else if (arg == "--fps-limit" && i + 1 < argc)
+            fpsLimit = std::atof(argv[++i]);                    // frames per second, 0 = no limit
+        else if (arg == "--always-render")
+            idleRendering = false;                              // draws every frame even when nothing changed
+        else if (arg == "--stats")
+            showStats = true;                                   // starts with the stats overlay (F3) shown
+        else if (arg == "--profile")
+            Profiler::enabled = true;                           // CPU scope timers, written as a Chrome trace on exit
+        else if (arg == "--profile-output" && i + 1 < argc)
+            profileOutput = argv[++i];
+        else if (arg == "--profile-summary" && i + 1 < argc)
+            profileSummary = std::atof(argv[++i]);              // seconds between summaries, 0 = none
+        else if (arg == "--scene" && i + 1 < argc)
+            sceneFile = argv[++i];                              // JSON or compiled scene instead of the built in gallery
+        else if (arg == "--compile-scene" && i + 1 < argc)
+            compileFile = argv[++i];                            // writes the scene in its binary form and exits
+        else if (arg == "--generate-scene" && i + 1 < argc)
+            generateFile = argv[++i];                           // writes a generated gallery and exits
+        else if (arg == "--rooms" && i + 1 < argc)
+            generateRooms = std::atoi(argv[++i]);
+        else if (arg == "--exhibits" && i + 1 < argc)
+            generateExhibits = std::atoi(argv[++i]);            // per room
+        else if (arg == "--seed" && i + 1 < argc)
+            generateSeed = (unsigned int)std::strtoul(argv[++i], nullptr, 10);
+        else if (arg == "--context-api" && i + 1 < argc) {
+            // egl or osmesa for hosts without a GPU driver (osmesa renders on Mesa llvmpipe)
+            std::string api = argv[++i];
+            contextApi = api == "egl" ? GLFW_EGL_CONTEXT_API : api == "osmesa" ? GLFW_OSMESA_CONTEXT_API : GLFW_NATIVE_CONTEXT_API;
+        }
+        else if (arg == "--texture-quality" && i + 1 < argc)
+            Texture::qualityLevel = std::atoi(argv[++i]);       // 0 = full, 1 = half, 2 = quarter resolution...
+        else if (arg == "--max-texture-size" && i + 1 < argc)
+            Texture::maxDimension = std::atoi(argv[++i]);       // largest side in texels
+        else if (arg == "--texture-budget" && i + 1 < argc)
+            Texture::memoryBudget = (size_t)std::atoi(argv[++i]) * 1024 * 1024;   // in MB
+        else if (arg == "--no-level-streaming")
+            LevelStreamer::enabled = false;                     // loads every room of the scene at start
+        else if (arg == "--no-portal-culling")
+            PortalVisibility::enabled = false;                  // draws every resident room
+        else if (arg == "--no-occlusion-culling")
+            OcclusionCuller::enabled = false;                   // draws every model of the visible rooms
+        else if (arg == "--cpu-occlusion") {
+            SoftwareOcclusion::enabled = true;                  // occluders rasterized on the CPU instead of occlusion queries
+            OcclusionCuller::enabled = false;
+        }
+        else if (arg == "--occluder-triangles" && i + 1 < argc)
+            SoftwareOcclusion::triangleBudget = std::atoi(argv[++i]);   // rasterized per frame, nearest occluders first
+        else if (arg == "--no-impostors")
+            ImpostorRenderer::enabled = false;                  // distant exhibits keep their meshes
+        else if (arg == "--impostor-size" && i + 1 < argc)
+            ImpostorRenderer::screenSize = (float)std::atof(argv[++i]);   // in pixels across
+        else if (arg == "--load-distance" && i + 1 < argc)
+            LevelStreamer::loadDistance = (float)std::atof(argv[++i]);
+        else if (arg == "--unload-distance" && i + 1 < argc)
+            LevelStreamer::unloadDistance = (float)std::atof(argv[++i]);
+        else if (arg == "--stream-cpu-budget" && i + 1 < argc)
+            LevelStreamer::cpuBudget = (size_t)std::atoi(argv[++i]) * 1024 * 1024;   // in MB
+        else if (arg == "--stream-gpu-budget" && i + 1 < argc)
+            LevelStreamer::gpuBudget = (size_t)std::atoi(argv[++i]) * 1024 * 1024;   // in MB
+    }
+
+    // --generate-scene: lays out rooms x exhibits from the gallery's assets with a fixed seed, no window needed
+    if (!generateFile.empty()) {
+        Scene generated = Scene::Generate(generateRooms, generateExhibits, generateSeed);
+        if (!generated.Save(generateFile))
+            return -1;
+        std::cout << "SCENE: wrote " << generateFile << " (" << generateRooms << " rooms x " << generateExhibits << " exhibits, seed "
+            << generateSeed << ", " << generated.instances.size() << " instances)" << std::endl;
+        return 0;
+    }
+
+    Profiler::SetThreadName("main");
+
+    // Models and colliders of the gallery, the hand placed one unless --scene is given
+    Scene scene = Scene::Gallery();
+    if (!sceneFile.empty() && !scene.Load(sceneFile))
+        return -1;
+    limit_min = scene.boundsMin;
+    limit_max = scene.boundsMax;
+
+    // --compile-scene: the --scene file (or the gallery) as a binary that loads without parsing JSON
+    if (!compileFile.empty()) {
+        if (!scene.SaveBinary(compileFile))
+            return -1;
+        std::cout << "SCENE: compiled " << (sceneFile.empty() ? "gallery" : sceneFile) << " to " << compileFile << std::endl;
+        return 0;
+    }
+
     // Initialize GLFW
     glfwInit();
     glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
     glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
     glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    // Base color textures are sRGB, so the window needs an sRGB capable framebuffer
+    glfwWindowHint(GLFW_SRGB_CAPABLE, GLFW_TRUE);
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, contextApi);
 
     // Initialize random seed and audio manager
     srand(static_cast<unsigned int>(time(nullptr)));
@@ -328,8 +665,12 @@ int main() {
     Sound.setMusicVolume(0.5f); // volume of music
     Sound.setEffectsVolume(0.9f); // volume of steps
 
-    // Create window
-    GLFWwindow* window = glfwCreateWindow(width, height, "The Virtual Gallery", glfwGetPrimaryMonitor(), NULL);
+    // Create window (the benchmark renders into a framebuffer, so its window is never shown)
+    if (benchmark || loadReportOnly)
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = benchmark || loadReportOnly
+        ? glfwCreateWindow(64, 64, "The Virtual Gallery benchmark", NULL, NULL)
+        : glfwCreateWindow(width, height, "The Virtual Gallery", glfwGetPrimaryMonitor(), NULL);
     if (!window) {
         std::cerr << "ERROR: Failed to create GLFW window" << std::endl;
         glfwTerminate();
@@ -343,6 +684,53 @@ int main() {
         return -1;
     }
 
+    // Camera input, live from the window, recorded to a log or replayed from one
+    InputSystem input(window);
+    if (!replayFile.empty()) {
+        if (!input.Replay(replayFile))
+            return -1;
+        // A log starts when the visitor enters the gallery
+        menu = false;
+    }
+    else if (!recordFile.empty() && !input.Record(recordFile)) {
+        return -1;
+    }
+
+    // --bench-mips: compares the CPU mip generator against glGenerateMipmap on every model texture and exits
+    if (benchMips) {
+        std::vector<std::string> images;
+        for (const auto& entry : std::filesystem::recursive_directory_iterator("modelos")) {
+            std::string ext = entry.path().extension().string();
+            if (ext == ".png" || ext == ".jpg" || ext == ".jpeg")
+                images.push_back(entry.path().generic_string());
+        }
+        BenchmarkMipGeneration(images);
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
+
+    // Background texture uploads on a second context that shares objects with the window
+    TextureStreamer* textureStreamer = nullptr;
+    if (streamTextures) {
+        textureStreamer = new TextureStreamer(window);
+        if (textureStreamer->IsRunning()) {
+            TextureStreamer::active = textureStreamer;
+        }
+        else {
+            delete textureStreamer;
+            textureStreamer = nullptr;
+        }
+        glfwMakeContextCurrent(window);
+    }
+
+    // Streams texture mip levels in and out depending on how close their meshes are, within --texture-budget
+    TextureResidency* residency = nullptr;
+    if (textureStreamer && textureResidency) {
+        residency = new TextureResidency(*textureStreamer, Texture::memoryBudget);
+        TextureResidency::active = residency;
+    }
+
     // Set up OpenGL state
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
@@ -358,12 +746,20 @@ int main() {
     glfwSetCursorPosCallback(window, mouse_callback);
     glfwSetMouseButtonCallback(window, mouse_button_callback);
     glfwSetKeyCallback(window, key_callback);
+    glfwSetWindowRefreshCallback(window, window_refresh_callback);
 
     // Load shaders
     Shader menuShader("menu.vert", "menu.frag");
     Shader shaderProgram("default.vert", "default.frag");
     Shader skyboxShader("skybox.vert", "skybox.frag");
     Shader textShader("text.vert", "text.frag");
+    // Panels drawn over the gallery every frame
+    Shader overlayPanelShader("panel.vert", "panel.frag");
+    // Occlusion queries of the gallery models
+    OcclusionCuller occlusion;
+    SoftwareOcclusion softwareOcclusion;
+    // Distant exhibits drawn as baked views
+    ImpostorRenderer impostors;
 
     // Set up menu buttons
     menuButtons.emplace_back(
@@ -409,9 +805,10 @@ int main() {
          1.0f,  1.0f,  1.0f, 1.0f   // Top right
     };
 
-    // Light configuration
-    glm::vec4 lightColor = glm::vec4(1.0f, 1.0f, 1.0f, 1.0f);
-    glm::vec3 lightPos = glm::vec3(0.5f, 0.5f, 0.5f);
+    // Light configuration, default.frag has a single light so only the scene's first one is used
+    SceneLight light = scene.lights.empty() ? SceneLight() : scene.lights.front();
+    glm::vec4 lightColor = light.color;
+    glm::vec3 lightPos = light.position;
 
     shaderProgram.Activate();
     glUniform4f(glGetUniformLocation(shaderProgram.ID, "lightColor"), lightColor.x, lightColor.y, lightColor.z, lightColor.w);
@@ -439,15 +836,9 @@ int main() {
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    stbi_set_flip_vertically_on_load(true);
-    int imgWidth, imgHeight, channels;
-    unsigned char* data = stbi_load("imagenes/pru.jpg", &imgWidth, &imgHeight, &channels, STBI_rgb_alpha);
-    if (data) {
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, imgWidth, imgHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
-        stbi_image_free(data);
-    }
-    else {
+    // Only level 0 is ever sampled (GL_LINEAR), so no mipmaps are built for the menu background
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+    if (!loadImageInto(menuTexture, GL_TEXTURE_2D, "imagenes/pru.jpg", STBI_rgb_alpha, GL_RGBA, GL_RGBA, true)) {
         std::cerr << "ERROR: Failed to load menu texture (pru.jpg)" << std::endl;
         return -1;
     }
@@ -456,29 +847,40 @@ int main() {
     Camera camera(width, height, glm::vec3(4.0f, 2.0f, 60.0f));
     camera.setAudioManager(&Sound);
 
-    stbi_set_flip_vertically_on_load(false); // Important for 3D models
-
-    // Load all 3D models
-    Model model("modelos/piso/scene.gltf", glm::vec3(2.0f), glm::vec3(0.0f, 13.0f, 0.0f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model pit("modelos/da vinci/mona_lisa/scene.gltf", glm::vec3(0.8f), glm::vec3(3.0f, 16.5f, -4.0f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model escul("modelos/miguel ang/david2/scene.gltf", glm::vec3(0.6f), glm::vec3(-0.7f, 31.0f, 5.4f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model escul2("modelos/miguel ang/pieta/scene.gltf", glm::vec3(1.3f), glm::vec3(13.0f, 18.0f, 0.8f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model escul3("modelos/miguel ang/moises/scene.gltf", glm::vec3(0.6f), glm::vec3(8.0f, 27.0f, -8.5f), glm::quat(0.0f, 0.0f, 1.0f, 0.0f));
-    Model escul4("modelos/Botticelli/joven/scene.gltf", glm::vec3(2.1f), glm::vec3(0.5f, 4.35f, -1.3f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model room2("modelos/room2/scene.gltf", glm::vec3(1.3f), glm::vec3(0.0f, 20.0f, 0.5f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model escul5("modelos/fidias/atena/scene.gltf", glm::vec3(0.3f), glm::vec3(-11.0f, 5.0f, 18.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model escul6("modelos/policleto/dori/scene.gltf", glm::vec3(0.31f), glm::vec3(-20.0f, 58.0f, 28.5f), glm::quat(0.0f, 0.0f, 1.0f, 0.0f));
-    Model escul7("modelos/praxi/afrodita/scene.gltf", glm::vec3(0.7f), glm::vec3(10.0f, -12.0f, -22.5f), glm::quat(0.0f, 0.0f, 0.0f, 1.0f));
-    Model pit2("modelos/van gogh/noche_estrella/scene.gltf", glm::vec3(0.9f), glm::vec3(-3.0f, 16.2f, -4.0f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model escul8("modelos/torso/scene.gltf", glm::vec3(1.5f), glm::vec3(3.8f, 26.0f, 1.5f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model pilar("modelos/pilar/scene.gltf", glm::vec3(0.09f), glm::vec3(-16.0f, 28.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model pilar2("modelos/pilar/scene.gltf", glm::vec3(0.09f), glm::vec3(-16.0f, 42.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model pilar3("modelos/pilar/scene.gltf", glm::vec3(0.09f), glm::vec3(16.0f, 28.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model pilar4("modelos/pilar/scene.gltf", glm::vec3(0.09f), glm::vec3(16.0f, 42.0f, 0.9f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model vase("modelos/vase/rosa1/scene.gltf", glm::vec3(1.8f), glm::vec3(-3.0f, 10.5f, -1.6f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model vase2("modelos/vase/rosa2/scene.gltf", glm::vec3(0.7f), glm::vec3(-8.0f, 51.3f, -12.4f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model vase3("modelos/vase/rosa3/scene.gltf", glm::vec3(1.5f), glm::vec3(-15.5f, 26.4f, 4.1f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
-    Model vase4("modelos/vase/rosa4/scene.gltf", glm::vec3(1.5f), glm::vec3(3.7f, 22.0f, -2.3f), glm::quat(0.0f, 1.0f, 0.0f, 0.0f));
+    stbi_set_flip_vertically_on_load_thread(false); // Important for 3D models
+
+    // Load all 3D models (each file once) and give the colliders to the camera
+    SceneRuntime runtime(scene, camera);
+    const std::vector<Model*>& sceneModels = runtime.models;
+    Texture::PrintMemoryReport();
+    if (residency)
+        std::cout << "TEXTURE RESIDENCY: " << residency->ResidentBytes() / (1024 * 1024) << " MB resident at start" << std::endl;
+
+    // Where the load time of every model went, reported once its textures have been decoded and uploaded in the background
+    bool loadReported = false;
+    auto reportLoadTimes = [&]() {
+        if (loadReported || LoadReport::inFlight > 0 || (textureStreamer && textureStreamer->Pending() > 0))
+            return;
+        LoadReport::Print();
+        LoadReport::Write(loadReportOutput);
+        loadReported = true;
+    };
+
+    // --load-report-only: waits for the textures of the scene, prints the report and exits
+    if (loadReportOnly) {
+        while (!loadReported) {
+            if (textureStreamer)
+                textureStreamer->Update();
+            reportLoadTimes();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        MemoryTracker::Print();
+        delete residency;
+        delete textureStreamer;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return 0;
+    }
 
     // Set up skybox VAO, VBO, EBO
     unsigned int skyboxVAO, skyboxVBO, skyboxEBO;
@@ -512,21 +914,400 @@ int main() {
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
 
-    stbi_set_flip_vertically_on_load(false);
     for (unsigned int i = 0; i < 6; i++) {
-        int width, height, nrChannels;
-        unsigned char* data = stbi_load(facesCubemap[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-            stbi_image_free(data);
-        }
-        else {
+        if (!loadImageInto(cubemapTexture, GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, facesCubemap[i], STBI_rgb, GL_RGB, GL_RGB, false)) {
             std::cout << "Failed to load skybox texture: " << facesCubemap[i] << std::endl;
-            stbi_image_free(data);
         }
     }
 
+    // Skybox and every model of the gallery, seen from the given camera
+    // 'passTimers' times the skybox and model passes on the GPU, the benchmark times whole frames instead
+    auto drawGallery = [&](Camera& viewer, GpuPassTimers* passTimers) {
+        PROFILE_SCOPE("Draw gallery");
+        // Only the rooms seen through the doorways. The CPU occlusion culling of their models runs on its
+        // thread while the skybox is drawn
+        runtime.Cull(viewer);
+        softwareOcclusion.Submit(viewer, runtime.occluderModels, runtime.visibleModels);
+
+        // Render Skybox
+        {
+            PROFILE_SCOPE("Skybox");
+            if (passTimers)
+                passTimers->Begin(PassSkybox);
+            glDepthFunc(GL_LEQUAL);
+            skyboxShader.Activate();
+
+            glm::mat4 view = glm::mat4(glm::mat3(glm::lookAt(viewer.Position, viewer.Position + viewer.Orientation, viewer.Up)));
+            glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)viewer.width / viewer.height, 0.1f, 100.0f);
+
+            glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
+            glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+
+            glBindVertexArray(skyboxVAO);
+            glActiveTexture(GL_TEXTURE0);
+            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
+            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+            glBindVertexArray(0);
+            RenderStats::frame.drawCalls++;
+            RenderStats::frame.triangles += 12;
+            RenderStats::frame.textureBinds++;
+
+            glDepthFunc(GL_LESS);
+            if (passTimers)
+                passTimers->End();
+        }
+
+        // Models Render 3D (sRGB textures are sampled as linear, so encode the output back to sRGB)
+        PROFILE_SCOPE("Models");
+        if (passTimers)
+            passTimers->Begin(PassModels);
+        glEnable(GL_FRAMEBUFFER_SRGB);
+        shaderProgram.Activate();
+        viewer.Matrix(shaderProgram, "camMatrix");
+
+        // Of those, the models neither occlusion culling found hidden. The ones small on screen are impostors
+        impostors.Split(softwareOcclusion.Collect(), viewer);
+        occlusion.Draw(impostors.meshModels, shaderProgram, viewer);
+        impostors.Draw(viewer, lightColor);
+        glDisable(GL_FRAMEBUFFER_SRGB);
+        if (passTimers)
+            passTimers->End();
+    };
+
+    // --benchmark: flies the camera path offscreen at a fixed timestep, writes the frame times as JSON and exits
+    if (benchmark) {
+        CameraPath path;
+        path.keys = scene.cameraPath;
+        if (path.keys.empty())
+            path = CameraPath::Default();
+        if (!benchPath.empty() && !path.Load(benchPath))
+            return -1;
+
+        OffscreenTarget target(benchWidth, benchHeight);
+        // A replayed walk keeps the window size it was recorded with, mouse look depends on it
+        bool replaying = input.IsReplaying();
+        Camera benchCamera(replaying ? width : benchWidth, replaying ? height : benchHeight,
+            replaying ? scene.spawn : path.keys[0].position);
+
+        // Lets the textures streamed at startup arrive so the first measured frames aren't all placeholders
+        while (textureStreamer && textureStreamer->Pending() > 0) {
+            textureStreamer->Update();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // --check-allocations: draws the same gallery frame (models, model info panel and stats overlay) from the
+        // entrance and fails if a frame made any heap allocation once texture streaming has settled
+        if (checkAllocationFrames > 0) {
+            GpuPassTimers checkTimers(PassCount, 3);
+            Shader checkPanelShader("panel.vert", "panel.frag");
+            benchCamera.Position = scene.spawn;
+            showStats = true;
+            // The spawn touches no model, so the panel is given a fixed one. Kept in strings so showing it every
+            // frame copies nothing
+            const std::string checkTitle = "ALLOCATION CHECK";
+            const std::string checkText = "THE SAME FRAME IS DRAWN UNTIL IT STOPS ALLOCATING, WITH THIS PANEL AND THE STATS OVERLAY.";
+            showModelInfo(checkTitle, checkText);
+
+            int measured = 0;
+            int allocatingFrames = 0;
+            unsigned int maxAllocations = 0;
+            for (int frame = -benchWarmup; measured < checkAllocationFrames && frame < benchWarmup + 100 * checkAllocationFrames; frame++) {
+                uint64_t allocationsBefore = AllocationCounter::ThisThread();
+                if (textureStreamer)
+                    textureStreamer->Update();
+                // Collision hides the panel when no model is touched
+                benchCamera.IsColliding(benchCamera.Position);
+                showModelInfo(checkTitle, checkText);
+                benchCamera.updateMatrix(60.0f, 0.1f, 100.0f);
+                if (runtime.Update(benchCamera)) {
+                    softwareOcclusion.Reset();
+                    occlusion.Reset();
+                }
+                if (residency)
+                    residency->Update(sceneModels, benchCamera, 60.0f);
+
+                target.Bind();
+                glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                checkTimers.BeginFrame();
+                drawGallery(benchCamera, &checkTimers);
+                checkTimers.Begin(PassUI);
+                renderModelInfo(*textRenderer2, textShader, checkPanelShader, benchWidth, benchHeight);
+                renderStatsOverlay(*textRenderer, textShader, checkPanelShader, checkTimers, 16.7f, benchWidth, benchHeight);
+                checkTimers.End();
+                glFlush();
+                RenderStats::EndFrame();
+                FrameAllocator::Frame().Reset();
+
+                // Frames that stream textures in are allowed to allocate, only settled ones count
+                bool settled = (!textureStreamer || textureStreamer->Pending() == 0) && (!residency || residency->Loading() == 0) && !runtime.Loading();
+                if (frame < 0 || !settled)
+                    continue;
+                unsigned int allocations = (unsigned int)(AllocationCounter::ThisThread() - allocationsBefore);
+                measured++;
+                if (allocations > 0)
+                    allocatingFrames++;
+                maxAllocations = std::max(maxAllocations, allocations);
+            }
+            target.Unbind();
+            hideModelInfo();
+
+            std::cout << "ALLOCATIONS: " << measured << " steady frames, " << allocatingFrames << " with heap allocations (at most "
+                << maxAllocations << " in one frame)" << std::endl;
+            bool passed = measured > 0 && allocatingFrames == 0;
+            if (measured < checkAllocationFrames)
+                std::cerr << "ERROR: texture streaming never settled, only " << measured << " frames could be checked" << std::endl;
+
+            checkTimers.Delete();
+            target.Delete();
+            delete residency;
+            delete textureStreamer;
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return passed ? 0 : 1;
+        }
+
+        // --perf-suite: microbenchmarks first, the render benchmark below then adds its frame times
+        PerfSuite perf;
+        bool meshoptMatches = true;
+        if (perfSuite) {
+            std::cout << "PERF: running the suite" << std::endl;
+
+            // Load time of every asset, with textures decoded and uploaded synchronously so they count too
+            TextureStreamer* activeStreamer = TextureStreamer::active;
+            TextureResidency* activeResidency = TextureResidency::active;
+            TextureStreamer::active = nullptr;
+            TextureResidency::active = nullptr;
+            LoadReport::enabled = false;
+            std::vector<std::string> assets;
+            for (const auto& entry : std::filesystem::recursive_directory_iterator("modelos")) {
+                if (entry.path().extension() == ".gltf" || entry.path().extension() == ".glb")
+                    assets.push_back(entry.path().generic_string());
+            }
+            std::sort(assets.begin(), assets.end());
+            // Every copy is kept until the timing is done, so freeing the previous one isn't timed with the next load
+            for (const std::string& asset : assets) {
+                std::vector<std::unique_ptr<Model>> loaded;
+                perf.Add("model_load." + asset + ".ms", PerfSuite::MedianMs([&]() { loaded.push_back(std::make_unique<Model>(asset.c_str())); }, 3));
+                for (std::unique_ptr<Model>& copy : loaded)
+                    copy->Delete();
+            }
+            // The EXT_meshopt_compression copy of room2 has to decode to the same geometry as the original
+            Model original("modelos/room2/scene.gltf");
+            Model compressed("modelos/room2/scene_meshopt.gltf");
+            meshoptMatches = original.SameGeometry(compressed);
+            original.Delete();
+            compressed.Delete();
+            if (meshoptMatches)
+                std::cout << "PERF: modelos/room2/scene_meshopt.gltf decodes to the geometry of scene.gltf" << std::endl;
+            else
+                std::cerr << "ERROR: modelos/room2/scene_meshopt.gltf doesn't decode to the geometry of scene.gltf" << std::endl;
+            TextureStreamer::active = activeStreamer;
+            TextureResidency::active = activeResidency;
+            LoadReport::enabled = true;
+
+            // Collision queries against the colliders of a generated 50 room gallery
+            Scene generated = Scene::Generate(50, 10, 1);
+            Camera collisionCamera(benchWidth, benchHeight, generated.spawn);
+            for (const SceneCollider& collider : generated.colliders)
+                collisionCamera.AddCollider(collider.position, collider.radius, collider.title, collider.text);
+            std::mt19937 random(1);
+            std::uniform_real_distribution<float> probeX(generated.boundsMin.x, generated.boundsMax.x);
+            std::uniform_real_distribution<float> probeZ(generated.boundsMin.z, generated.boundsMax.z);
+            std::vector<glm::vec3> probes(100000);
+            for (glm::vec3& probe : probes)
+                probe = glm::vec3(probeX(random), 2.5f, probeZ(random));
+            int collisions = 0;
+            perf.Add("collision.generated_50_rooms.100k_queries.ms", PerfSuite::MedianMs([&]() {
+                for (const glm::vec3& probe : probes)
+                    collisions += collisionCamera.IsColliding(probe) ? 1 : 0;
+            }, 5));
+            hideModelInfo();
+
+            // View frustum test of every mesh of the scene from 1000 points along the camera path
+            std::vector<BoundingSphere> spheres;
+            for (Model* sceneModel : sceneModels) {
+                for (unsigned int i = 0; i < sceneModel->GetMeshes().size(); i++)
+                    spheres.push_back(sceneModel->GetMeshBounds(i));
+            }
+            int visible = 0;
+            perf.Add("culling.frustum.1000_views.ms", PerfSuite::MedianMs([&]() {
+                Camera viewer(benchWidth, benchHeight, path.keys[0].position);
+                for (int view = 0; view < 1000; view++) {
+                    path.Evaluate(path.Duration() * view / 1000.0f, viewer.Position, viewer.Orientation);
+                    viewer.updateMatrix(60.0f, 0.1f, 100.0f);
+                    // Planes from the rows of the view projection matrix (Gribb/Hartmann)
+                    glm::mat4 m = glm::transpose(viewer.cameraMatrix);
+                    glm::vec4 planes[6] = { m[3] + m[0], m[3] - m[0], m[3] + m[1], m[3] - m[1], m[3] + m[2], m[3] - m[2] };
+                    for (const BoundingSphere& sphere : spheres) {
+                        bool inside = true;
+                        for (const glm::vec4& plane : planes) {
+                            if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius * glm::length(glm::vec3(plane))) {
+                                inside = false;
+                                break;
+                            }
+                        }
+                        visible += inside ? 1 : 0;
+                    }
+                }
+            }, 5));
+
+            // Text layout of the help pages' lines
+            static const std::string layoutLines[] = {
+                "THE VIRTUAL GALLERY ES UN ESPACIO INMERSIVO DONDE EL ARTE COBRA VIDA",
+                "EXPLORA REPLICAS DIGITALES DE OBRAS MAESTRAS DEL RENACIMIENTO",
+                "ACERCATE A LOS MODELOS PARA VER SU INFORMACION."
+            };
+            float layoutWidth = 0.0f;
+            perf.Add("text.layout.30k_lines.ms", PerfSuite::MedianMs([&]() {
+                for (int i = 0; i < 10000; i++) {
+                    for (const std::string& line : layoutLines)
+                        layoutWidth += textRenderer->CalculateTextWidth(line, 0.4f);
+                }
+            }, 5));
+            std::cout << "PERF: " << collisions << " collisions, " << visible << " visible spheres, " << layoutWidth << " px laid out" << std::endl;
+        }
+
+        int frames = benchFrames > 0 ? benchFrames
+            : replaying ? (int)input.ReplayLength() - benchWarmup
+            : (int)std::ceil(path.Duration() / benchTimestep) + 1;
+        std::cout << "BENCHMARK: " << frames << " frames at " << benchWidth << "x" << benchHeight
+            << " on " << glGetString(GL_RENDERER) << std::endl;
+
+        glEnable(GL_DEPTH_TEST);
+        glDisable(GL_CULL_FACE);
+        glDisable(GL_BLEND);
+        FrameTimer timer;
+        for (int frame = -benchWarmup; frame < frames; frame++) {
+            PROFILE_SCOPE("Frame");
+            if (frame >= 0)
+                timer.BeginFrame();
+
+            if (textureStreamer)
+                textureStreamer->Update();
+
+            // The camera only depends on the frame number, never on how long frames took
+            if (replaying) {
+                if (!input.BeginFrame())
+                    break;
+                benchCamera.Inputs(input);
+                benchCamera.Position = glm::clamp(benchCamera.Position, limit_min, limit_max);
+            }
+            else {
+                path.Evaluate(std::max(frame, 0) * benchTimestep, benchCamera.Position, benchCamera.Orientation);
+            }
+            benchCamera.updateMatrix(60.0f, 0.1f, 100.0f);
+            if (runtime.Update(benchCamera)) {
+                softwareOcclusion.Reset();
+                occlusion.Reset();
+            }
+            if (residency)
+                residency->Update(sceneModels, benchCamera, 60.0f);
+
+            target.Bind();
+            glClearColor(0.1f, 0.1f, 0.1f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            drawGallery(benchCamera, nullptr);
+            RenderStats::EndFrame();
+            FrameAllocator::Frame().Reset();
+            glFlush();
+
+            if (frame >= 0)
+                timer.EndFrame();
+            glfwPollEvents();
+        }
+        timer.Finish();
+        target.Unbind();
+
+        nlohmann::ordered_json report;
+        report["renderer"] = (const char*)glGetString(GL_RENDERER);
+        report["gl_version"] = (const char*)glGetString(GL_VERSION);
+        report["scene"] = sceneFile.empty() ? "gallery" : sceneFile;
+        report["instances"] = scene.instances.size();
+        report["path"] = replaying ? "replay:" + replayFile : benchPath.empty() ? "scene" : benchPath;
+        report["width"] = benchWidth;
+        report["height"] = benchHeight;
+        report["timestep"] = benchTimestep;
+        report["warmup_frames"] = benchWarmup;
+        nlohmann::ordered_json results = timer.Report();
+        report.insert(results.begin(), results.end());
+
+        std::ofstream out(benchOutput);
+        out << report.dump(2) << std::endl;
+        FrameStats cpu = FrameStats::Of(timer.cpuMs);
+        FrameStats gpu = FrameStats::Of(timer.gpuMs);
+        std::cout << "BENCHMARK: CPU mean " << cpu.mean << " ms, p95 " << cpu.p95 << " ms, p99 " << cpu.p99 << " ms | GPU mean "
+            << gpu.mean << " ms, p95 " << gpu.p95 << " ms, p99 " << gpu.p99 << " ms -> " << benchOutput << std::endl;
+
+        if (Profiler::enabled)
+            Profiler::WriteChromeTrace(profileOutput);
+
+        // --perf-suite: adds the render benchmark and fails the run on a regression
+        bool passed = true;
+        if (perfSuite) {
+            perf.Add("render.cpu_ms.mean", cpu.mean);
+            perf.Add("render.cpu_ms.p95", cpu.p95);
+            // No GPU times when the driver has no timer queries
+            if (gpu.mean > 0.0) {
+                perf.Add("render.gpu_ms.mean", gpu.mean);
+                perf.Add("render.gpu_ms.p95", gpu.p95);
+            }
+            perf.Write(perfOutput);
+            passed = (perfUpdateBaseline ? perf.UpdateBaseline(perfBaseline) : perf.Compare(perfBaseline, perfCi)) && meshoptMatches;
+        }
+
+        timer.Delete();
+        target.Delete();
+        delete residency;
+        delete textureStreamer;
+        glfwDestroyWindow(window);
+        glfwTerminate();
+        return passed ? 0 : 1;
+    }
+
+    // Fixed 60 Hz simulation, the camera is rendered interpolated between its last two steps
+    SimulationClock simulationClock(1.0 / 60.0);
+    glm::vec3 previousPosition = camera.Position;
+    glm::vec3 previousOrientation = camera.Orientation;
+
+    // Vsync (default) or --fps-limit keep the loop from rendering frames nobody sees
+    glfwSwapInterval(vsync ? 1 : 0);
+    std::unique_ptr<FrameLimiter> frameLimiter;
+    if (fpsLimit > 0.0)
+        frameLimiter = std::make_unique<FrameLimiter>(fpsLimit);
+
+    // Idle rendering: a screen that didn't change since it was presented isn't drawn (nor swapped) again,
+    // the window keeps showing it while the loop sleeps until the next event
+    const double idleTimeout = 0.25;
+    bool galleryIdle = false;
+    // Whether the last presented frame showed the camera at rest (not between two different steps)
+    bool drawnAtRest = false;
+
+    double lastProfileSummary = glfwGetTime();
+
+    // Stats overlay: GL_TIME_ELAPSED per pass, read three frames late
+    GpuPassTimers passTimers(PassCount, 3);
+    double lastGalleryFrame = glfwGetTime();
+    float galleryFrameMs = 0.0f;
     while (!glfwWindowShouldClose(window)) {
+        PROFILE_SCOPE("Frame");
+        // Makes the textures that finished streaming since the last frame visible
+        bool streamed = false;
+        {
+            PROFILE_SCOPE("Texture streaming");
+            streamed = textureStreamer && textureStreamer->Update();
+        }
+        reportLoadTimes();
+        bool streaming = textureStreamer && textureStreamer->Pending() > 0;
+        bool inGallery = !menu && !showHelp && !showHelpPage2 && !showCredits;
+
+        // The menus only change on input, without events they block instead of drawing the same screen again
+        if (idleRendering && !inGallery && !redrawRequested && !streamed && !streaming) {
+            PROFILE_SCOPE("Idle wait");
+            glfwWaitEventsTimeout(idleTimeout);
+            continue;
+        }
+
         if (menu && !showHelp && !showHelpPage2 && !showCredits) {
             for (auto& btn : menuButtons) {
                 btn.Update(mousePos);
@@ -547,6 +1328,7 @@ int main() {
         static bool inEnvironment = false;
 
         if (showHelp) {
+            PROFILE_SCOPE("Menu UI");
             glDisable(GL_DEPTH_TEST);
             glEnable(GL_BLEND);
             glDisable(GL_CULL_FACE);
@@ -588,7 +1370,7 @@ int main() {
             float textScale = 0.40f;
             float leftMargin = width / 8;
 
-            std::vector<std::string> descriptionLines = {
+            static const std::vector<std::string> descriptionLines = {
                 "THE VIRTUAL GALLERY ES UN ESPACIO INMERSIVO DONDE EL ARTE COBRA VIDA",
                 "EXPLORA REPLICAS DIGITALES DE OBRAS MAESTRAS DEL RENACIMIENTO",
                 "ESCULTURAS ICONICAS Y PINTURAS LEGENDARIAS EN UN ENTORNO 3D INTERACTIVO",
@@ -621,6 +1403,7 @@ int main() {
             nextButtonHelp.RenderTextOnly(*textRenderer, textShader, 0.5f);
         }
         else if (showHelpPage2) {
+            PROFILE_SCOPE("Menu UI");
             glDisable(GL_DEPTH_TEST);
             glEnable(GL_BLEND);
             glDisable(GL_CULL_FACE);
@@ -661,7 +1444,7 @@ int main() {
             float instructionScale = 0.45f;
             float leftMargin = width / 4;
 
-            std::vector<std::string> controls = {
+            static const std::vector<std::string> controls = {
                 "W: MOVER HACIA ADELANTE",
                 "A: MOVER A LA IZQUIERDA",
                 "S: MOVER HACIA ATRAS",
@@ -697,6 +1480,7 @@ int main() {
             prevButtonHelp.RenderTextOnly(*textRenderer, textShader, 0.5f);
         }
         else if (showCredits) {
+            PROFILE_SCOPE("Menu UI");
             glDisable(GL_DEPTH_TEST);
             glEnable(GL_BLEND);
             glDisable(GL_CULL_FACE);
@@ -758,7 +1542,7 @@ int main() {
             currentY += (baseFontSize * subtitleScale) * lineSpacingFactor;
 
             float nameScale = 0.7f;
-            std::vector<std::string> names = {
+            static const std::vector<std::string> names = {
                 "ALANIZ HERRERA ROGER ANTONIO 2023-0625U",
                 "BRAN RAMOS NAZARETH DE LOS ANGELES 2023-0863U",
                 "FLORES MENDOZA LESTER NAHUM 2023-0632U"
@@ -777,12 +1561,13 @@ int main() {
 
         }
         else if (menu) {
+            PROFILE_SCOPE("Menu UI");
             glDisable(GL_DEPTH_TEST);
             glEnable(GL_BLEND);
             glDisable(GL_CULL_FACE);
             glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
             inEnvironment = false;
-            camera.Position = glm::vec3(0.0f, 2.0f, 60.0f);
+            camera.Position = scene.spawn;
 
             if (currentMusic != "Sound/MenuSound.mp3") {
                 Sound.playBackgroundMusic("Sound/MenuSound.mp3", 1.0f);
@@ -834,110 +1619,159 @@ int main() {
             glDisable(GL_CULL_FACE);
             glDisable(GL_BLEND);
 
-            if (!inEnvironment) {
+            // Audio zones of the scene play their own music, the random environment songs play everywhere else
+            const SceneAudioZone* zone = runtime.AudioZoneAt(camera.Position);
+            if (zone && currentMusic != zone->music) {
+                Sound.playBackgroundMusic(zone->music, 1.0f);
+                currentMusic = zone->music;
+            }
+            else if (!zone && currentMusic != "ENVIRONMENT") {
                 std::string randomSong = pickRandomSong(envSongs);
                 Sound.playBackgroundMusic(randomSong, 1.0f);
                 currentMusic = "ENVIRONMENT";
+            }
+            else if (!Sound.getBackgroundMusic() || Sound.getBackgroundMusic()->isFinished()) {
+                // if the song ends, starts another song (a zone starts its own again)
+                Sound.playBackgroundMusic(zone ? zone->music : pickRandomSong(envSongs), 1.0f);
+            }
+
+            if (!inEnvironment) {
                 inEnvironment = true;
+
+                // The time spent in the menu is not simulated
+                simulationClock.Reset(glfwGetTime());
+                previousPosition = camera.Position;
+                previousOrientation = camera.Orientation;
             }
-            else {
-                // if the song ends, starts another song 
-                if (!Sound.getBackgroundMusic() || Sound.getBackgroundMusic()->isFinished()) {
-                    std::string randomSong = pickRandomSong(envSongs);
-                    Sound.playBackgroundMusic(randomSong, 1.0f);
+
+            // Simulation: input, collisions, model info triggers and footsteps advance in fixed steps,
+            // so walking speed is the same at any frame rate (and replays step through their log)
+            int steps = simulationClock.BeginFrame(glfwGetTime());
+            for (int step = 0; step < steps && !menu; step++) {
+                PROFILE_SCOPE("Simulation step");
+                previousPosition = camera.Position;
+                previousOrientation = camera.Orientation;
+
+                // Reads this step's input, a replay closes the gallery once its log runs out
+                if (!input.BeginFrame()) {
+                    std::cout << "INPUT: replay finished" << std::endl;
+                    glfwSetWindowShouldClose(window, true);
+                    break;
                 }
-            }
 
-            // esc key to return to menu
-            if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS && !menu) {
-                menu = true;
-                inEnvironment = false;
-                // Opcional: detener la música actual
-                if (Sound.getBackgroundMusic()) {
-                    Sound.getBackgroundMusic()->stop();
+                // esc key to return to menu
+                if (input.Key(GLFW_KEY_ESCAPE) && !menu) {
+                    menu = true;
+                    inEnvironment = false;
+                    // An input log covers a single visit, from entering the gallery to leaving it
+                    input.StopRecording();
+                    if (input.IsReplaying())
+                        glfwSetWindowShouldClose(window, true);
+                    // Opcional: detener la música actual
+                    if (Sound.getBackgroundMusic()) {
+                        Sound.getBackgroundMusic()->stop();
+                    }
+                    break;
                 }
+
+                camera.Inputs(input);
+
+                // Limits of the Camera
+                camera.Position.x = limits(camera.Position.x, limit_min.x, limit_max.x);
+                camera.Position.y = limits(camera.Position.y, limit_min.y, limit_max.y);
+                camera.Position.z = limits(camera.Position.z, limit_min.z, limit_max.z);
             }
 
-            // Render Scen 3D
-            camera.Inputs(window);
-            camera.updateMatrix(60.0f, 0.1f, 100.0f);
+            // Idle once a whole step passed with nothing held and the camera where it was
+            if (steps > 0)
+                galleryIdle = !input.IsReplaying() && !input.AnyHeld() &&
+                    previousPosition == camera.Position && previousOrientation == camera.Orientation;
+
+            // The last presented frame already shows the camera at rest: waits for an event instead of drawing it again.
+            // Texture decodes and the levels residency still has to stream in keep it drawing, it only refines a few per frame.
+            // The clock is left one step behind, so the step after waking up sees the input that woke it
+            bool texturesRefining = LoadReport::inFlight > 0 || (residency && residency->Busy());
+            if (idleRendering && !menu && galleryIdle && drawnAtRest && !redrawRequested && !streamed && !streaming && !texturesRefining &&
+                !runtime.Loading() && !occlusion.Waiting()) {
+                PROFILE_SCOPE("Idle wait");
+                glfwWaitEventsTimeout(idleTimeout);
+                simulationClock.Reset(glfwGetTime() - simulationClock.Step());
+                continue;
+            }
 
-            // Limits of the Camera
-            camera.Position.x = limits(camera.Position.x, limit_min.x, limit_max.x);
-            camera.Position.y = limits(camera.Position.y, limit_min.y, limit_max.y);
-            camera.Position.z = limits(camera.Position.z, limit_min.z, limit_max.z);
-
-            // Add Collider to scultures and set the info
-            camera.AddCollider(glm::vec3(0.3201, 3.97696, 32.9264), 3.0f, "David", "Escultura de Miguel angel (1501-1504). Marmol blanco de 5.17 metros.");
-            camera.AddCollider(glm::vec3(-13.9183, 2.28625, 18.5213), 3.0f, "La Piedad", "Escultura de Miguel angel (1498-1499). Marmol, Basilica de San Pedro.");
-            camera.AddCollider(glm::vec3(16.4938, 3.65387, 16.5488), 2.0f, "Atenea Partenos", "Escultura de Fidias (siglo V a.C.). Replica moderna.");
-            camera.AddCollider(glm::vec3(14.8127, 3.80944, 49.5978), 2.0f, "Doriforo", "Escultura de Policleto (450-440 a.C.). Copia romana en marmol.");
-            camera.AddCollider(glm::vec3(8.51457, 2.15766, 49.942), 2.0f, "Afrodita de Cnido", "Escultura de Praxoteles (siglo IV a.C.). Copia romana.");
-            camera.AddCollider(glm::vec3(-8.46455, 1.67231, 50.2564), 2.0f, "Moises", "Escultura de Miguel angel (1513-1515). Marmol, tumba del Papa Julio II.");
-            camera.AddCollider(glm::vec3(-16.9746, 2.62017, 45.6913), 2.0f, "Torso de Belvedere", "Escultura helenestica (siglo I a.C.). Marmol, Museos Vaticanos.");
-            camera.AddCollider(glm::vec3(-5.30144, 2.5, 15.5354), 0.5f, "La Mona Lisa", "Obra maestra de Leonardo da Vinci (1503-1519). Pintura al oleo sobre tabla de alamo.");
-            camera.AddCollider(glm::vec3(-0.381448, 2.5, 15.5354), 0.5f, "Retrato de una joven", "Obra maestra de Sandro Botticelli (1480-1485). Pintura al temple sobre madera.");
-            camera.AddCollider(glm::vec3(6.81855, 2.5, 15.5354), 0.5f, "La Noche Estrellada", "Pintura de Vincent van Gogh (1889). oleo sobre lienzo.");
-            camera.AddCollider(glm::vec3(-17.1125, 2.5, 25.5523), 1.0f, "Pilares decorativos");
-            camera.AddCollider(glm::vec3(-17.1308, 2.5, 38.5671), 1.0f, "Pilares decorativos");
-            camera.AddCollider(glm::vec3(17.507, 2.5, 25.7276), 1.0f, "Pilares decorativos");
-            camera.AddCollider(glm::vec3(17.1492, 2.5, 38.6279), 1.0f, "Pilares decorativos");
-
-            // Render Skybox
-            glDepthFunc(GL_LEQUAL);
-            skyboxShader.Activate();
+            // Render Scen 3D, between the last two simulated steps
+            glm::vec3 simulatedPosition = camera.Position;
+            glm::vec3 simulatedOrientation = camera.Orientation;
+            float alpha = simulationClock.Alpha();
+            camera.Position = glm::mix(previousPosition, simulatedPosition, alpha);
+            camera.Orientation = glm::normalize(glm::mix(previousOrientation, simulatedOrientation, alpha));
+            camera.updateMatrix(60.0f, 0.1f, 100.0f);
 
-            glm::mat4 view = glm::mat4(glm::mat3(glm::lookAt(camera.Position, camera.Position + camera.Orientation, camera.Up)));
-            glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)width / height, 0.1f, 100.0f);
+            // Loads the rooms coming into reach and unloads the ones left behind
+            if (runtime.Update(camera)) {
+                softwareOcclusion.Reset();
+                occlusion.Reset();
+            }
 
-            glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "view"), 1, GL_FALSE, glm::value_ptr(view));
-            glUniformMatrix4fv(glGetUniformLocation(skyboxShader.ID, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+            // Picks the mip levels each texture needs from this frame's camera
+            if (residency) {
+                PROFILE_SCOPE("Texture residency");
+                residency->Update(sceneModels, camera, 60.0f);
+            }
 
-            glBindVertexArray(skyboxVAO);
-            glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_CUBE_MAP, cubemapTexture);
-            glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-            glBindVertexArray(0);
+            // Frame time for the overlay, waits of an idle gallery aren't frames
+            double frameTime = glfwGetTime();
+            if (frameTime - lastGalleryFrame < idleTimeout)
+                galleryFrameMs = galleryFrameMs * 0.9f + (float)((frameTime - lastGalleryFrame) * 1000.0) * 0.1f;
+            lastGalleryFrame = frameTime;
 
-            glDepthFunc(GL_LESS);
+            passTimers.BeginFrame();
+            drawGallery(camera, &passTimers);
+            drawnAtRest = previousPosition == simulatedPosition && previousOrientation == simulatedOrientation;
+            camera.Position = simulatedPosition;
+            camera.Orientation = simulatedOrientation;
 
-            // Models Render 3D
-            shaderProgram.Activate();
-            camera.Matrix(shaderProgram, "camMatrix");
-
-            model.Draw(shaderProgram, camera);
-            pit.Draw(shaderProgram, camera);
-            escul.Draw(shaderProgram, camera);
-            escul2.Draw(shaderProgram, camera);
-            escul3.Draw(shaderProgram, camera);
-            escul4.Draw(shaderProgram, camera);
-            room2.Draw(shaderProgram, camera);
-            escul5.Draw(shaderProgram, camera);
-            escul6.Draw(shaderProgram, camera);
-            escul7.Draw(shaderProgram, camera);
-            pit2.Draw(shaderProgram, camera);
-            escul8.Draw(shaderProgram, camera);
-            pilar.Draw(shaderProgram, camera);
-            pilar2.Draw(shaderProgram, camera);
-            pilar3.Draw(shaderProgram, camera);
-            pilar4.Draw(shaderProgram, camera);
-            vase.Draw(shaderProgram, camera);
-            vase2.Draw(shaderProgram, camera);
-            vase3.Draw(shaderProgram, camera);
-            vase4.Draw(shaderProgram, camera);
             // Render Info about the scultures
-            renderModelInfo(*textRenderer2, textShader, width, height);
+            PROFILE_SCOPE("Model info UI");
+            passTimers.Begin(PassUI);
+            renderModelInfo(*textRenderer2, textShader, overlayPanelShader, width, height);
+            if (showStats)
+                renderStatsOverlay(*textRenderer, textShader, overlayPanelShader, passTimers, galleryFrameMs, width, height);
+            passTimers.End();
+        }
+        if (!inGallery || menu)
+            drawnAtRest = false;
+        redrawRequested = false;
+        {
+            PROFILE_SCOPE("Swap buffers");
+            glfwSwapBuffers(window);
         }
-        glfwSwapBuffers(window);
+        RenderStats::EndFrame();
+        FrameAllocator::Frame().Reset();
         glfwPollEvents();
+        if (frameLimiter)
+            frameLimiter->Wait();
+
+        // Rolling summary of where the frame time went
+        if (Profiler::enabled && profileSummary > 0.0 && glfwGetTime() - lastProfileSummary >= profileSummary) {
+            Profiler::PrintSummary(profileSummary);
+            lastProfileSummary = glfwGetTime();
+        }
     }
+    if (Profiler::enabled)
+        Profiler::WriteChromeTrace(profileOutput);
 
     // Clean up resources
     glDeleteVertexArrays(1, &quadVAO);
     glDeleteBuffers(1, &quadVBO);
     glDeleteTextures(1, &menuTexture);
     glDeleteTextures(1, &cubemapTexture);
+    passTimers.Delete();
+    occlusion.Delete();
+    impostors.Delete();
     delete textRenderer;
+    delete residency;
+    delete textureStreamer;
     glfwDestroyWindow(window);
     glfwTerminate();
     return 0;
@@ -0,0 +1,8 @@
+#version 330 core
+out vec4 FragColor;
+
+// Color writes are off, only whether any sample passes the depth test matters
+void main()
+{
+	FragColor = vec4(1.0);
+}
@@ -0,0 +1,13 @@
+#version 330 core
+// Corner of the unit cube
+layout (location = 0) in vec3 aPos;
+
+uniform mat4 camMatrix;
+// World space box being tested
+uniform vec3 boxMin;
+uniform vec3 boxMax;
+
+void main()
+{
+	gl_Position = camMatrix * vec4(mix(boxMin, boxMax, aPos), 1.0);
+}
@@ -1,4 +1,6 @@
 #include"shaderClass.h"
+#include"Profiler.h"
+#include"RenderStats.h"
 
 // Reads a text file and outputs a string with everything in the text file
 std::string get_file_contents(const char* filename)
@@ -20,6 +22,7 @@ std::string get_file_contents(const char* filename)
 // Constructor that build the Shader Program from 2 different shaders
 Shader::Shader(const char* vertexFile, const char* fragmentFile)
 {
+	PROFILE_SCOPE("Shader compile");
 	// Read vertexFile and fragmentFile and store the strings
 	std::string vertexCode = get_file_contents(vertexFile);
 	std::string fragmentCode = get_file_contents(fragmentFile);
@@ -65,6 +68,13 @@ Shader::Shader(const char* vertexFile, const char* fragmentFile)
 // Activates the Shader Program
 void Shader::Activate()
 {
+	// Counts the program changes for the stats overlay
+	static GLuint current = 0;
+	if (ID != current)
+	{
+		RenderStats::frame.shaderSwitches++;
+		current = ID;
+	}
 	glUseProgram(ID);
 }
 